@@ -0,0 +1,152 @@
+/*
+ * BootTimeline.cpp
+ *
+ * Records the duration of the start-up phases, device set-ups and EEPROM page loads
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "BootTimeline.h"
+#include "DeviceManager.h"
+#include "Status.h"
+
+BootTimeline bootTimeline;
+
+BootTimeline::BootTimeline()
+{
+    count = 0;
+    dropped = 0;
+    currentPhase = NULL;
+    phaseStart = 0;
+    stopTime = 0;
+    recording = true;
+}
+
+/*
+ * End the running phase of setup() and start the next one (NULL = none)
+ */
+void BootTimeline::phase(const char *name)
+{
+    if (!recording) {
+        return;
+    }
+    if (currentPhase != NULL) {
+        insert(PHASE, currentPhase, 0, phaseStart);
+    }
+    currentPhase = name;
+    phaseStart = micros();
+}
+
+/*
+ * Record an event which started at "start" and ends now
+ */
+void BootTimeline::add(EventType type, uint16_t id, uint32_t start)
+{
+    if (recording) {
+        insert(type, NULL, id, start);
+    }
+}
+
+/*
+ * Stop recording, called when the system is ready (or failed to get ready)
+ */
+void BootTimeline::stop()
+{
+    if (recording) {
+        phase(NULL);
+        stopTime = micros();
+        recording = false;
+    }
+}
+
+bool BootTimeline::isRecording()
+{
+    return recording;
+}
+
+/*
+ * Insert an event sorted by its start time. Events are added when they end, so an enclosing
+ * phase is added after its nested events and must be moved in front of them.
+ */
+void BootTimeline::insert(EventType type, const char *name, uint16_t id, uint32_t start)
+{
+    if (count >= CFG_BOOT_TIMELINE_SIZE) {
+        dropped++;
+        return;
+    }
+
+    uint8_t i = count++;
+    while (i > 0 && events[i - 1].start > start) {
+        events[i] = events[i - 1];
+        i--;
+    }
+    events[i].start = start;
+    events[i].duration = micros() - start;
+    events[i].name = name;
+    events[i].id = id;
+    events[i].type = type;
+}
+
+void BootTimeline::print(Print &printer)
+{
+    printer.println("BOOT TIMELINE (start us, duration us)");
+    for (uint8_t i = 0; i < count; i++) {
+        Event *event = &events[i];
+        Device *device;
+
+        printer.print(event->start);
+        printer.print("\t");
+        printer.print(event->duration);
+        printer.print("\t");
+        switch (event->type) {
+        case PHASE:
+            printer.println(event->name);
+            break;
+        case DEVICE_SETUP:
+        case CONFIG_LOAD:
+            device = deviceManager.getDeviceByID((DeviceId) event->id);
+            printer.print(event->type == DEVICE_SETUP ? "  setup " : "    load configuration ");
+            printer.println(device != NULL ? device->getCommonName().c_str() : "");
+            break;
+        case EEPROM_PAGE:
+            printer.print("    eeprom page ");
+            printer.println(event->id);
+            break;
+        case STATE:
+            printer.print("state ");
+            printer.println(status.systemStateToStr((Status::SystemState) event->id));
+            break;
+        }
+    }
+    if (dropped > 0) {
+        printer.print(dropped);
+        printer.println(" events dropped");
+    }
+    if (recording) {
+        printer.println("system not ready yet");
+    } else {
+        printer.print(status.getSystemState() == Status::error ? "error after: " : "time to ready: ");
+        printer.print(stopTime / 1000);
+        printer.println("ms");
+    }
+}
@@ -0,0 +1,80 @@
+/*
+ * BootTimeline.h
+ *
+ * Records the duration of the start-up phases, device set-ups and EEPROM page loads
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef BOOT_TIMELINE_H_
+#define BOOT_TIMELINE_H_
+
+#include <Arduino.h>
+#include "config.h"
+
+/*
+ * Events with microsecond timestamps (since reset) are recorded in RAM from power-up until the
+ * system reaches the state ready (time to drive-ready) or an error. Afterwards the timeline can
+ * be printed to find out where the start-up time goes.
+ */
+class BootTimeline
+{
+public:
+    enum EventType {
+        PHASE,          // a step of setup(), named
+        DEVICE_SETUP,   // setup() of a device (id = DeviceId)
+        CONFIG_LOAD,    // loadConfiguration() of a device (id = DeviceId)
+        EEPROM_PAGE,    // a page was read from the EEPROM into the cache (id = page number)
+        STATE           // the system state changed (id = Status::SystemState)
+    };
+
+    struct Event {
+        uint32_t start; // micros() when the event started
+        uint32_t duration; // duration in microseconds
+        const char *name; // name of a phase (string literal), NULL for other events
+        uint16_t id; // id of the event, see EventType
+        uint8_t type; // the EventType
+    };
+
+    BootTimeline();
+    void phase(const char *name);
+    void add(EventType type, uint16_t id, uint32_t start);
+    void stop();
+    bool isRecording();
+    void print(Print &printer);
+
+private:
+    Event events[CFG_BOOT_TIMELINE_SIZE]; // the recorded events, sorted by their start time
+    uint8_t count; // number of recorded events
+    uint16_t dropped; // number of events which didn't fit
+    const char *currentPhase; // name of the running phase, NULL = none
+    uint32_t phaseStart; // micros() when the running phase started
+    uint32_t stopTime; // micros() when the recording stopped (time to ready)
+    bool recording; // events are recorded until the system is ready
+
+    void insert(EventType type, const char *name, uint16_t id, uint32_t start);
+};
+
+extern BootTimeline bootTimeline;
+
+#endif /* BOOT_TIMELINE_H_ */
@@ -167,9 +167,7 @@ void BrusaBSC6::processValues1(uint8_t data[])
     lvCurrent = (int16_t)(data[6] | (data[5] << 8)) - 280;
     mode = (data[7] & 0xF0) >> 4;
 
-    if (logger.isDebug()) {
-        logger.debug(this, "status bitfield: %#08x, ready: %d, running: %d, HV: %fV %fA, LV: %fV %dA, mode %d", bitfield, ready, running, (float) hvVoltage / 10.0F, (float) hvCurrent / 10.0F, (float) lvVoltage / 10.0F, lvCurrent, mode);
-    }
+    LOG_DEBUG(this, "status bitfield: %#08x, ready: %d, running: %d, HV: %fV %fA, LV: %fV %dA, mode %d", bitfield, ready, running, (float) hvVoltage / 10.0F, (float) hvCurrent / 10.0F, (float) lvVoltage / 10.0F, lvCurrent, mode);
 }
 
 /*
@@ -211,9 +209,7 @@ void BrusaBSC6::processValues2(uint8_t data[])
 
         logger.error(this, "error (%#08x): %s", bitfield, error.c_str());
     }
-    if (logger.isDebug()) {
-        logger.debug(this, "LV current avail: %dA, maximum Temperature: %.1fC", lvCurrentAvailable, (float) temperature / 10.0F);
-    }
+    LOG_DEBUG(this, "LV current avail: %dA, maximum Temperature: %.1fC", lvCurrentAvailable, (float) temperature / 10.0F);
 }
 
 /*
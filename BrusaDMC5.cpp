@@ -296,10 +296,8 @@ void BrusaDMC5::processStatus(uint8_t data[])
     status.limitationSlewRate = (bitfield & slewRateLimitation) ? true : false;
     status.limitationMotorTemperature = (bitfield & motorTemperatureLimitation) ? true : false;
 
-    if (logger.isDebug()) {
-        logger.debug(this, "status: %#08x, ready: %d, running: %d, torque avail: %.2fNm, actual : %.2fNm, speed actual: %drpm", bitfield,
-                ready, running, torqueAvailable / 10.0F, torqueActual / 10.0F, speedActual);
-    }
+    LOG_DEBUG(this, "status: %#08x, ready: %d, running: %d, torque avail: %.2fNm, actual : %.2fNm, speed actual: %drpm", bitfield,
+            ready, running, torqueAvailable / 10.0F, torqueActual / 10.0F, speedActual);
 }
 
 /*
@@ -315,10 +313,8 @@ void BrusaDMC5::processActualValues(uint8_t data[])
     acCurrent = (uint16_t) (data[5] | (data[4] << 8)) / 2.5;
     mechanicalPower = (int16_t) (data[7] | (data[6] << 8)) / 6.25;
 
-    if (logger.isDebug()) {
-        logger.debug(this, "DC Volts: %.1fV, DC current: %.1fA, AC current: %.1fA, mechPower: %.1fkW", dcVoltage / 10.0F,
-                dcCurrent / 10.0F, acCurrent / 10.0F, mechanicalPower / 10.0F);
-    }
+    LOG_DEBUG(this, "DC Volts: %.1fV, DC current: %.1fA, AC current: %.1fA, mechPower: %.1fkW", dcVoltage / 10.0F,
+            dcCurrent / 10.0F, acCurrent / 10.0F, mechanicalPower / 10.0F);
 }
 
 /*
@@ -424,10 +420,8 @@ void BrusaDMC5::processTorqueLimit(uint8_t data[])
     minNegativeTorque = (int16_t) (data[3] | (data[2] << 8)) / 10;
     limiterStateNumber = (uint8_t) data[4];
 
-    if (logger.isDebug()) {
-        logger.debug(this, "torque limit: max positive: %.1fNm, min negative: %.1fNm", maxPositiveTorque / 10.0F, minNegativeTorque / 10.0F,
-                limiterStateNumber);
-    }
+    LOG_DEBUG(this, "torque limit: max positive: %.1fNm, min negative: %.1fNm", maxPositiveTorque / 10.0F, minNegativeTorque / 10.0F,
+            limiterStateNumber);
 }
 
 /*
@@ -441,10 +435,8 @@ void BrusaDMC5::processTemperature(uint8_t data[])
     temperaturePowerStage = (int16_t) (data[1] | (data[0] << 8)) * 5;
     temperatureMotor = (int16_t) (data[3] | (data[2] << 8)) * 5;
     temperatureController = (int16_t) (data[4] - 50) * 10;
-    if (logger.isDebug()) {
-        logger.debug(this, "temperature: powerStage: %.1fC, motor: %.1fC, system: %.1fC", temperaturePowerStage / 10.0F, temperatureMotor / 10.0F,
-                temperatureController / 10.0F);
-    }
+    LOG_DEBUG(this, "temperature: powerStage: %.1fC, motor: %.1fC, system: %.1fC", temperaturePowerStage / 10.0F, temperatureMotor / 10.0F,
+            temperatureController / 10.0F);
     if (temperaturePowerStage > temperatureController) {
         temperatureController = temperaturePowerStage;
     }
@@ -207,9 +207,7 @@ void BrusaNLG5::processStatus(uint8_t data[])
 //    limitMaximumOutputCurrent
 //    limitMaximumMainsCurrent
 
-    if (logger.isDebug()) {
-        logger.debug(this, "status bitfield: %#08x", bitfield);
-    }
+    LOG_DEBUG(this, "status bitfield: %#08x", bitfield);
 }
 
 /*
@@ -224,9 +222,7 @@ void BrusaNLG5::processValues1(uint8_t data[])
     batteryVoltage = (uint16_t)(data[5] | (data[4] << 8));
     batteryCurrent = (uint16_t)(data[7] | (data[6] << 8));
 
-    if (logger.isDebug()) {
-        logger.debug(this, "mains: %.1fV, %.1fA, battery: %.1fV, %.1fA", (float) inputVoltage / 10.0F, (float) inputCurrent / 100.0F, (float) batteryVoltage / 10.0F, (float) batteryCurrent / 100.0F);
-    }
+    LOG_DEBUG(this, "mains: %.1fV, %.1fA, battery: %.1fV, %.1fA", (float) inputVoltage / 10.0F, (float) inputCurrent / 100.0F, (float) batteryVoltage / 10.0F, (float) batteryCurrent / 100.0F);
 }
 
 /*
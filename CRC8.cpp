@@ -26,9 +26,17 @@ static const uint8_t crc_table[] = {
 };
 
 byte CRC8::calculate(uint8_t *data, uint8_t len)
+{
+    return update(0x0, data, len);
+}
+
+/*
+ * Continue the calculation of a CRC over data which is processed in several parts.
+ */
+byte CRC8::update(uint8_t crcIn, uint8_t *data, uint8_t len)
 {
     uint16_t i;
-    uint16_t crc = 0x0;
+    uint16_t crc = crcIn;
 
     while (len--) {
         i = (crc ^ *data++) & 0xFF;
@@ -35,6 +35,7 @@ class CRC8
 {
 public:
     static byte calculate(byte *data, byte len);
+    static byte update(byte crc, byte *data, byte len);
 };
 
 #endif /* CRC8_H_ */
@@ -28,6 +28,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
 #include "CanHandler.h"
+#include "FaultHandler.h"
 
 CanHandler canHandlerEv = CanHandler(CanHandler::CAN_BUS_EV);
 CanHandler canHandlerCar = CanHandler(CanHandler::CAN_BUS_CAR);
@@ -49,6 +50,12 @@ CanHandler::CanHandler(CanBusNode canBusNode)
     for (int i = 0; i < CFG_CAN_NUM_OBSERVERS; i++) {
         observerData[i].observer = NULL;
     }
+
+    busState = CAN_STATE_ERROR_ACTIVE;
+    recoveryTime = 0;
+    recoveryDelay = CFG_CAN_BUS_OFF_RECOVERY_DELAY;
+    errorActiveTime = 0;
+    memset(&statistics, 0, sizeof(CanBusStatistics));
 }
 
 /*
@@ -56,10 +63,17 @@ CanHandler::CanHandler(CanBusNode canBusNode)
  */
 void CanHandler::setup()
 {
-    // Initialize the canbus at the specified baudrate
+    initBus();
+    logger.info("CAN%d init ok", (canBusNode == CAN_BUS_EV ? 0 : 1));
+}
+
+/*
+ * Initialize the canbus controller at the specified baudrate and assign the TX mailboxes.
+ */
+void CanHandler::initBus()
+{
     bus->begin(canBusNode == CAN_BUS_EV ? CFG_CAN0_SPEED : CFG_CAN1_SPEED, 255);
     bus->setNumTXBoxes(canBusNode == CAN_BUS_EV ? CFG_CAN0_NUM_TX_MAILBOXES : CFG_CAN1_NUM_TX_MAILBOXES);
-    logger.info("CAN%d init ok", (canBusNode == CAN_BUS_EV ? 0 : 1));
 }
 
 /*
@@ -176,11 +190,14 @@ int8_t CanHandler::findFreeObserverData()
 
 /*
  * If a message is available, read it and forward it to registered observers.
+ * Also keeps track of the controller's error state and recovers from bus-off.
  */
 void CanHandler::process()
 {
     static CAN_FRAME frame;
 
+    checkErrorState();
+
     if (bus->rx_avail()) {
         bus->get_rx_buff(frame);
 //      logFrame(frame);
@@ -196,6 +213,177 @@ void CanHandler::process()
     }
 }
 
+/*
+ * Read the error counters and the status register of the controller and
+ * update the bus state accordingly. If the controller went bus-off, schedule
+ * a recovery after a back-off delay which doubles with each consecutive bus-off
+ * (up to CFG_CAN_BUS_OFF_RECOVERY_MAX_DELAY). The delay is reset once the bus
+ * stayed error active for CFG_CAN_BUS_OFF_STABLE_TIME.
+ */
+void CanHandler::checkErrorState()
+{
+    if (recoveryTime != 0) {
+        if ((int32_t) (millis() - recoveryTime) >= 0) {
+            recoverBusOff();
+        }
+        return;
+    }
+
+    uint32_t status = bus->get_status();
+
+    statistics.txErrorCounter = bus->get_tx_error_cnt();
+    statistics.rxErrorCounter = bus->get_rx_error_cnt();
+    if (statistics.txErrorCounter > statistics.txErrorPeak) {
+        statistics.txErrorPeak = statistics.txErrorCounter;
+    }
+    if (statistics.rxErrorCounter > statistics.rxErrorPeak) {
+        statistics.rxErrorPeak = statistics.rxErrorCounter;
+    }
+
+    if (status & CAN_SR_BOFF) {
+        changeBusState(CAN_STATE_BUS_OFF);
+    } else if (status & CAN_SR_ERRP) {
+        changeBusState(CAN_STATE_ERROR_PASSIVE);
+    } else if (status & CAN_SR_WARN) {
+        changeBusState(CAN_STATE_WARNING);
+    } else {
+        changeBusState(CAN_STATE_ERROR_ACTIVE);
+    }
+
+    // consecutive bus-offs are only considered as such if the bus did not recover completely in-between
+    if (busState == CAN_STATE_ERROR_ACTIVE && recoveryDelay != CFG_CAN_BUS_OFF_RECOVERY_DELAY
+            && millis() - errorActiveTime > CFG_CAN_BUS_OFF_STABLE_TIME) {
+        recoveryDelay = CFG_CAN_BUS_OFF_RECOVERY_DELAY;
+    }
+}
+
+/*
+ * Handle a transition of the bus state, update the statistics and raise or cancel faults.
+ */
+void CanHandler::changeBusState(CanBusState newState)
+{
+    if (newState == busState) {
+        return;
+    }
+
+    uint32_t now = millis();
+
+    switch (newState) {
+    case CAN_STATE_WARNING:
+        if (busState == CAN_STATE_ERROR_ACTIVE) {
+            statistics.warningCount++;
+        }
+        break;
+    case CAN_STATE_ERROR_PASSIVE:
+        statistics.errorPassiveCount++;
+        statistics.lastErrorPassiveTime = now;
+        faultHandler.raiseFault(CANHANDLER, getFaultCode(CAN_STATE_ERROR_PASSIVE), true);
+        break;
+    case CAN_STATE_BUS_OFF:
+        statistics.busOffCount++;
+        statistics.lastBusOffTime = now;
+        faultHandler.raiseFault(CANHANDLER, getFaultCode(CAN_STATE_BUS_OFF), true);
+        bus->disable();
+        recoveryTime = now + recoveryDelay;
+        logger.error("CAN%d bus-off (TEC=%d, REC=%d), recovery in %ldms", canBusNode, statistics.txErrorCounter, statistics.rxErrorCounter,
+                recoveryDelay);
+        recoveryDelay = min(recoveryDelay * 2, CFG_CAN_BUS_OFF_RECOVERY_MAX_DELAY);
+        break;
+    case CAN_STATE_ERROR_ACTIVE:
+        errorActiveTime = now;
+        break;
+    }
+
+    if (busState == CAN_STATE_ERROR_PASSIVE && newState < CAN_STATE_ERROR_PASSIVE) {
+        faultHandler.cancelOngoingFault(CANHANDLER, getFaultCode(CAN_STATE_ERROR_PASSIVE));
+    }
+
+    if (newState != CAN_STATE_BUS_OFF) {
+        logger.warn("CAN%d state changed from %s to %s (TEC=%d, REC=%d)", canBusNode, busStateToString(busState).c_str(),
+                busStateToString(newState).c_str(), statistics.txErrorCounter, statistics.rxErrorCounter);
+    }
+    busState = newState;
+}
+
+/*
+ * Re-initialize the controller after a bus-off. All mailboxes get reset by begin(),
+ * so the RX filters of the attached observers have to be re-applied.
+ * Waiting for the controller's automatic recovery (128 x 11 recessive bits) is avoided.
+ */
+void CanHandler::recoverBusOff()
+{
+    recoveryTime = 0;
+
+    initBus();
+    for (int i = 0; i < CFG_CAN_NUM_OBSERVERS; i++) {
+        if (observerData[i].observer != NULL) {
+            bus->setRXFilter(observerData[i].mailbox, observerData[i].id, observerData[i].mask, observerData[i].extended);
+        }
+    }
+
+    statistics.recoveryCount++;
+    statistics.lastRecoveryTime = millis();
+    faultHandler.cancelOngoingFault(CANHANDLER, getFaultCode(CAN_STATE_BUS_OFF));
+    faultHandler.cancelOngoingFault(CANHANDLER, getFaultCode(CAN_STATE_ERROR_PASSIVE));
+
+    // the re-initialized controller starts error active with zeroed counters
+    changeBusState(CAN_STATE_ERROR_ACTIVE);
+}
+
+/*
+ * Get the fault code which corresponds to an error state of this bus.
+ */
+uint16_t CanHandler::getFaultCode(CanBusState state)
+{
+    if (state == CAN_STATE_BUS_OFF) {
+        return (canBusNode == CAN_BUS_EV ? FAULT_CAN_EV_BUS_OFF : FAULT_CAN_CAR_BUS_OFF);
+    }
+    return (canBusNode == CAN_BUS_EV ? FAULT_CAN_EV_ERROR_PASSIVE : FAULT_CAN_CAR_ERROR_PASSIVE);
+}
+
+/*
+ * Get the actual error state of the bus.
+ */
+CanHandler::CanBusState CanHandler::getBusState()
+{
+    return busState;
+}
+
+/*
+ * Get the error statistics of the bus.
+ */
+CanHandler::CanBusStatistics *CanHandler::getStatistics()
+{
+    return &statistics;
+}
+
+/*
+ * Print the error statistics of the bus to the console.
+ */
+void CanHandler::printStatistics()
+{
+    logger.console("CAN%d: state=%s, TEC=%d (peak %d), REC=%d (peak %d)", canBusNode, busStateToString(busState).c_str(),
+            statistics.txErrorCounter, statistics.txErrorPeak, statistics.rxErrorCounter, statistics.rxErrorPeak);
+    logger.console("    warnings=%d, error passive=%d (last at %lums), bus-off=%d (last at %lums), recoveries=%d (last at %lums)",
+            statistics.warningCount, statistics.errorPassiveCount, statistics.lastErrorPassiveTime, statistics.busOffCount,
+            statistics.lastBusOffTime, statistics.recoveryCount, statistics.lastRecoveryTime);
+}
+
+String CanHandler::busStateToString(CanBusState state)
+{
+    switch (state) {
+    case CAN_STATE_ERROR_ACTIVE:
+        return "error active";
+    case CAN_STATE_WARNING:
+        return "warning";
+    case CAN_STATE_ERROR_PASSIVE:
+        return "error passive";
+    case CAN_STATE_BUS_OFF:
+        return "bus-off";
+    }
+    return "";
+}
+
 /*
  * Prepare the CAN transmit frame.
  * Re-sets all parameters in the re-used frame.
@@ -206,6 +394,7 @@ void CanHandler::prepareOutputFrame(CAN_FRAME *frame, uint32_t id)
     frame->id = id;
     frame->extended = 0;
     frame->rtr = 0;
+    frame->priority = CAN_PRIORITY_DEFAULT;
     frame->data.value = 0;
 }
 
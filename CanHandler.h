@@ -34,6 +34,11 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <DueTimer.h>
 #include "Logger.h"
 
+// priority of a frame in the transmit mailboxes (0 = sent first, 15 = sent last)
+#define CAN_PRIORITY_HIGHEST    0
+#define CAN_PRIORITY_DEFAULT    8 // frames which don't need a specific order, set by prepareOutputFrame()
+#define CAN_PRIORITY_LOWEST     15
+
 class CanObserver // @suppress("Class has a virtual method and non-virtual destructor")
 {
 public:
@@ -48,6 +53,27 @@ public:
         CAN_BUS_CAR // CAN1 is intended to be connected to the car's high speed bus (the one with the ECU)
     };
 
+    enum CanBusState {
+        CAN_STATE_ERROR_ACTIVE, // normal operation
+        CAN_STATE_WARNING, // TEC or REC exceeded 96
+        CAN_STATE_ERROR_PASSIVE, // TEC or REC exceeded 127, no more active error frames are sent
+        CAN_STATE_BUS_OFF // TEC exceeded 255, the controller was disconnected from the bus
+    };
+
+    struct CanBusStatistics {
+        uint16_t warningCount; // number of times the warning level was reached
+        uint16_t errorPassiveCount; // number of times the controller went error passive
+        uint16_t busOffCount; // number of times the controller went bus-off
+        uint16_t recoveryCount; // number of successful bus-off recoveries
+        uint8_t txErrorCounter; // actual value of TEC
+        uint8_t rxErrorCounter; // actual value of REC
+        uint8_t txErrorPeak; // highest TEC seen since start
+        uint8_t rxErrorPeak; // highest REC seen since start
+        uint32_t lastErrorPassiveTime; // millis() when the controller went error passive the last time
+        uint32_t lastBusOffTime; // millis() when the controller went bus-off the last time
+        uint32_t lastRecoveryTime; // millis() when the last bus-off recovery was finished
+    };
+
     CanHandler(CanBusNode busNumber);
     void setup();
     void attach(CanObserver *observer, uint32_t id, uint32_t mask, bool extended);
@@ -57,6 +83,9 @@ public:
     void prepareOutputFrame(CAN_FRAME *frame, uint32_t id);
     void sendFrame(CAN_FRAME& frame);
     void logFrame(CAN_FRAME& frame);
+    CanBusState getBusState();
+    CanBusStatistics *getStatistics();
+    void printStatistics();
 protected:
 
 private:
@@ -71,8 +100,19 @@ private:
     CanBusNode canBusNode;  // indicator to which can bus this instance is assigned to
     CANRaw *bus;    // the can bus instance which this CanHandler instance is assigned to
     CanObserverData observerData[CFG_CAN_NUM_OBSERVERS];    // Can observers
+    CanBusState busState; // the last known error state of the controller
+    CanBusStatistics statistics; // error counters of the bus
+    uint32_t recoveryTime; // millis() when the next bus-off recovery attempt is due (0 = none pending)
+    uint32_t recoveryDelay; // actual back-off delay in ms, doubled with each consecutive bus-off
+    uint32_t errorActiveTime; // millis() when the bus last became error active
 
     int8_t findFreeObserverData();
+    void initBus();
+    void checkErrorState();
+    void changeBusState(CanBusState newState);
+    void recoverBusOff();
+    uint16_t getFaultCode(CanBusState state);
+    String busStateToString(CanBusState state);
 };
 
 extern CanHandler canHandlerEv;
@@ -25,6 +25,7 @@
  */
 
 #include "CanIO.h"
+#include "FaultHandler.h"
 
 CanIO::CanIO() :
         Device()
@@ -33,17 +34,31 @@ CanIO::CanIO() :
     commonName = "CAN I/O";
     motorController = NULL;
     dcdcConverter = NULL;
+    discoveryTicks = 0;
+    nodeIdsChanged = false;
+    memset(remoteNodes, 0, sizeof(remoteNodes));
 }
 
 void CanIO::setup()
 {
     Device::setup();
+
+    // nodes keep the number they had before the reboot, so their I/O channels don't move
+    CanIOConfiguration *config = (CanIOConfiguration *) getConfiguration();
+    for (int node = 0; node < CFG_REMOTE_IO_MAX_NODES; node++) {
+        remoteNodes[node].uniqueId = config->nodeIds[node];
+    }
+
     motorController = deviceManager.getMotorController();
     dcdcConverter = deviceManager.getDcDcConverter();
 
     canHandlerEv.attach(this, IO_CAN_MASKED_ID, IO_CAN_MASK, false);
+    canHandlerEv.attach(this, IO_CAN_MASKED_ID_REMOTE, IO_CAN_MASK_REMOTE, false);
     canHandlerCar.attach(this, IO_CAN_MASKED_ID_CAR, IO_CAN_MASK_CAR, false);
 
+    systemIO.setRemoteIO(this);
+    sendDiscoveryRequest();
+
     ready = true;
     running = true;
 
@@ -58,7 +73,17 @@ void CanIO::tearDown()
     Device::tearDown();
     sendIOStatus(); // so the error state is transmitted
 
+    // switch off all remote outputs before we stop refreshing them
+    systemIO.setRemoteIO(NULL);
+    for (int node = 0; node < CFG_REMOTE_IO_MAX_NODES; node++) {
+        if (remoteNodes[node].uniqueId != 0) {
+            memset(remoteNodes[node].outputs, 0, CFG_REMOTE_IO_OUTPUTS_PER_NODE);
+            sendRemoteOutputs(node);
+        }
+    }
+
     canHandlerEv.detach(this, IO_CAN_MASKED_ID, IO_CAN_MASK);
+    canHandlerEv.detach(this, IO_CAN_MASKED_ID_REMOTE, IO_CAN_MASK_REMOTE);
 }
 
 void CanIO::handleTick()
@@ -66,6 +91,15 @@ void CanIO::handleTick()
     sendIOStatus();
     sendAnalogData();
     sendMotorData();
+
+    checkRemoteNodes();
+    if (nodeIdsChanged) { // not saved from the CAN receive path as saving may wait for the EEPROM
+        nodeIdsChanged = false;
+        saveConfiguration();
+    }
+    if (++discoveryTicks >= CFG_REMOTE_IO_DISCOVERY_TICKS) {
+        sendDiscoveryRequest();
+    }
 }
 
 /*
@@ -73,6 +107,15 @@ void CanIO::handleTick()
  */
 void CanIO::handleCanFrame(CAN_FRAME *frame)
 {
+    if ((frame->id & IO_CAN_MASK_REMOTE) == IO_CAN_MASKED_ID_REMOTE) {
+        if (frame->id == IO_CAN_ID_REMOTE_ANNOUNCE) {
+            processNodeAnnouncement(frame);
+        } else {
+            processRemoteInputs(frame);
+        }
+        return;
+    }
+
     switch (frame->id) {
     case IO_CAN_ID_GEVCU_EXT_TEMPERATURE:
         processTemperature(frame->data.byte);
@@ -224,15 +267,312 @@ void CanIO::processTemperature(byte bytes[])
 {
     for (int i = 0; i < CFG_NUMBER_BATTERY_TEMPERATURE_SENSORS; i++) {
         status.temperatureBattery[i] = (bytes[i] == 0 ? CFG_NO_TEMPERATURE_DATA : (bytes[i] - CFG_CAN_TEMPERATURE_OFFSET) * 10);
-        if (logger.isDebug()) {
-            logger.debug(this, "battery temperature %d: %.1f", i, status.temperatureBattery[i] / 10.0f);
-        }
+        LOG_DEBUG(this, "battery temperature %d: %.1f", i, status.temperatureBattery[i] / 10.0f);
     }
     status.temperatureCoolant = (bytes[6] == 0 ? CFG_NO_TEMPERATURE_DATA : (bytes[6] - CFG_CAN_TEMPERATURE_OFFSET) * 10);
     status.temperatureExterior = (bytes[7] == 0 ? CFG_NO_TEMPERATURE_DATA : (bytes[7] - CFG_CAN_TEMPERATURE_OFFSET) * 10);
-    if (logger.isDebug()) {
-        logger.debug(this, "coolant temperature: %.1f, exterior temperature %.1f", status.temperatureCoolant / 10.0f,
-                status.temperatureExterior / 10.0f);
+    LOG_DEBUG(this, "coolant temperature: %.1f, exterior temperature %.1f", status.temperatureCoolant / 10.0f,
+            status.temperatureExterior / 10.0f);
+}
+
+/*
+ * Ask all extension nodes on the EV bus to announce themselves. Nodes which already
+ * have a node number re-announce too, so they get the same number confirmed.
+ */
+void CanIO::sendDiscoveryRequest()
+{
+    discoveryTicks = 0;
+    canHandlerEv.prepareOutputFrame(&outputFrame, IO_CAN_ID_REMOTE_DISCOVER);
+    outputFrame.length = 0;
+    canHandlerEv.sendFrame(outputFrame);
+}
+
+/*
+ * Tell a node (identified by its unique id) which node number it has to use
+ * for the id's of its input and output messages.
+ */
+void CanIO::sendNodeAssignment(uint8_t nodeNumber)
+{
+    canHandlerEv.prepareOutputFrame(&outputFrame, IO_CAN_ID_REMOTE_ASSIGN);
+    outputFrame.length = 5;
+    outputFrame.data.low = remoteNodes[nodeNumber].uniqueId;
+    outputFrame.data.bytes[4] = nodeNumber;
+    canHandlerEv.sendFrame(outputFrame);
+}
+
+/*
+ * Send the requested output values to a node.
+ * Called periodically and whenever an output value changes.
+ */
+void CanIO::sendRemoteOutputs(uint8_t nodeNumber)
+{
+    canHandlerEv.prepareOutputFrame(&outputFrame, IO_CAN_ID_REMOTE_OUTPUT + nodeNumber);
+    outputFrame.length = CFG_REMOTE_IO_OUTPUTS_PER_NODE;
+    memcpy(outputFrame.data.bytes, remoteNodes[nodeNumber].outputs, CFG_REMOTE_IO_OUTPUTS_PER_NODE);
+    canHandlerEv.sendFrame(outputFrame);
+}
+
+/*
+ * Find the node number of a node. A known node gets its previous number again (also
+ * across reboots as the assignment is stored in EEPROM), a new node the first free one.
+ * If all numbers are taken, the number of a node which was not seen since power-up is re-used.
+ * Returns -1 if no number is available.
+ */
+int8_t CanIO::assignNodeNumber(uint32_t uniqueId)
+{
+    int8_t free = -1, absent = -1;
+
+    for (int node = 0; node < CFG_REMOTE_IO_MAX_NODES; node++) {
+        if (remoteNodes[node].uniqueId == uniqueId) {
+            return node;
+        }
+        if (free == -1 && remoteNodes[node].uniqueId == 0) {
+            free = node;
+        }
+        if (absent == -1 && remoteNodes[node].lastSeen == 0) {
+            absent = node;
+        }
+    }
+    if (free == -1) {
+        free = absent;
+    }
+    if (free != -1) {
+        CanIOConfiguration *config = (CanIOConfiguration *) getConfiguration();
+        config->nodeIds[free] = uniqueId;
+        nodeIdsChanged = true;
+    }
+    return free;
+}
+
+/*
+ * A node announced itself with its unique id (data[0-3]), the number of digital inputs (data[4]),
+ * the number of analog inputs (data[5]) and the number of outputs (data[6]).
+ */
+void CanIO::processNodeAnnouncement(CAN_FRAME *frame)
+{
+    uint32_t uniqueId = frame->data.low;
+
+    if (uniqueId == 0) {
+        return;
+    }
+    int8_t nodeNumber = assignNodeNumber(uniqueId);
+    if (nodeNumber == -1) {
+        logger.warn(this, "no free slot for I/O node %#x, increase CFG_REMOTE_IO_MAX_NODES", uniqueId);
+        return;
+    }
+
+    RemoteNode *node = &remoteNodes[nodeNumber];
+    if (node->uniqueId != uniqueId || node->lastSeen == 0) {
+        if (node->uniqueId != uniqueId) {
+            node->uniqueId = uniqueId;
+            node->online = false;
+            memset(node->outputs, 0, CFG_REMOTE_IO_OUTPUTS_PER_NODE);
+        }
+        logger.info(this, "I/O node %#x registered as node %d (inputs: %d digital, %d analog, outputs: %d)", uniqueId, nodeNumber,
+                frame->data.bytes[4], frame->data.bytes[5], frame->data.bytes[6]);
+    }
+    node->numDigitalInputs = min(frame->data.bytes[4], CFG_REMOTE_IO_DIGITAL_INPUTS_PER_NODE);
+    node->numAnalogInputs = min(frame->data.bytes[5], CFG_REMOTE_IO_ANALOG_INPUTS_PER_NODE);
+    node->numOutputs = min(frame->data.bytes[6], CFG_REMOTE_IO_OUTPUTS_PER_NODE);
+    markNodeSeen(nodeNumber);
+
+    sendNodeAssignment(nodeNumber);
+    sendRemoteOutputs(nodeNumber);
+}
+
+/*
+ * Process the input states sent by an assigned node.
+ */
+void CanIO::processRemoteInputs(CAN_FRAME *frame)
+{
+    uint8_t nodeNumber = frame->id & 0x07;
+
+    if (nodeNumber >= CFG_REMOTE_IO_MAX_NODES || remoteNodes[nodeNumber].uniqueId == 0) {
+        return;
+    }
+
+    RemoteNode *node = &remoteNodes[nodeNumber];
+    switch (frame->id & ~0x07) {
+    case IO_CAN_ID_REMOTE_DIGITAL:
+        node->digitalInputs = frame->data.s0;
+        break;
+    case IO_CAN_ID_REMOTE_ANALOG:
+        node->analogInputs[0] = frame->data.s0;
+        node->analogInputs[1] = frame->data.s1;
+        node->analogInputs[2] = frame->data.s2;
+        node->analogInputs[3] = frame->data.s3;
+        break;
+    default:
+        return;
+    }
+
+    markNodeSeen(nodeNumber);
+}
+
+/*
+ * A frame of the node was received (inputs or announcement), mark it online
+ */
+void CanIO::markNodeSeen(uint8_t nodeNumber)
+{
+    RemoteNode *node = &remoteNodes[nodeNumber];
+
+    node->lastSeen = millis();
+    if (!node->online) {
+        node->online = true;
+        faultHandler.cancelOngoingFault(CANIO, FAULT_CANIO_COMM + nodeNumber);
+        logger.info(this, "I/O node %d is online", nodeNumber);
+    }
+}
+
+/*
+ * Time after which a node is considered offline. Nodes with inputs send them continuously, nodes
+ * with outputs only are just heard from when they answer a discovery request.
+ */
+uint32_t CanIO::getNodeTimeout(RemoteNode *node)
+{
+    if (node->numDigitalInputs > 0 || node->numAnalogInputs > 0) {
+        return CFG_REMOTE_IO_TIMEOUT;
+    }
+    return CFG_REMOTE_IO_DISCOVERY_TICKS * (CFG_TICK_INTERVAL_CAN_IO / 1000) + CFG_REMOTE_IO_TIMEOUT;
+}
+
+/*
+ * Mark nodes offline which did not send data within their timeout and
+ * refresh the outputs of all assigned nodes.
+ */
+void CanIO::checkRemoteNodes()
+{
+    for (int nodeNumber = 0; nodeNumber < CFG_REMOTE_IO_MAX_NODES; nodeNumber++) {
+        RemoteNode *node = &remoteNodes[nodeNumber];
+        if (node->uniqueId == 0) {
+            continue;
+        }
+        if (node->online && millis() - node->lastSeen > getNodeTimeout(node)) {
+            node->online = false;
+            faultHandler.raiseFault(CANIO, FAULT_CANIO_COMM + nodeNumber, true);
+            logger.error(this, "I/O node %d is offline", nodeNumber);
+        }
+        sendRemoteOutputs(nodeNumber);
+    }
+}
+
+/*
+ * Is the (SystemIO) digital input channel mapped to a remote node
+ */
+bool CanIO::isRemoteInput(uint8_t channel)
+{
+    return channel >= IO_REMOTE_FIRST_DIGITAL_INPUT
+            && channel < IO_REMOTE_FIRST_DIGITAL_INPUT + CFG_REMOTE_IO_MAX_NODES * CFG_REMOTE_IO_DIGITAL_INPUTS_PER_NODE;
+}
+
+/*
+ * Is the (SystemIO) analog input channel mapped to a remote node
+ */
+bool CanIO::isRemoteAnalogInput(uint8_t channel)
+{
+    return channel >= IO_REMOTE_FIRST_ANALOG_INPUT
+            && channel < IO_REMOTE_FIRST_ANALOG_INPUT + CFG_REMOTE_IO_MAX_NODES * CFG_REMOTE_IO_ANALOG_INPUTS_PER_NODE;
+}
+
+/*
+ * Is the (SystemIO) output channel mapped to a remote node
+ */
+bool CanIO::isRemoteOutput(uint8_t channel)
+{
+    return channel >= IO_REMOTE_FIRST_OUTPUT && channel < IO_REMOTE_FIRST_OUTPUT + CFG_REMOTE_IO_MAX_NODES * CFG_REMOTE_IO_OUTPUTS_PER_NODE;
+}
+
+/*
+ * Get the state of a remote digital input. If the node is offline or doesn't
+ * provide the input, false is returned.
+ */
+bool CanIO::getRemoteDigitalIn(uint8_t channel)
+{
+    if (!isRemoteInput(channel)) {
+        return false;
+    }
+    channel -= IO_REMOTE_FIRST_DIGITAL_INPUT;
+    RemoteNode *node = &remoteNodes[channel / CFG_REMOTE_IO_DIGITAL_INPUTS_PER_NODE];
+    uint8_t input = channel % CFG_REMOTE_IO_DIGITAL_INPUTS_PER_NODE;
+
+    if (!node->online || input >= node->numDigitalInputs) {
+        return false;
+    }
+    return node->digitalInputs & (1 << input);
+}
+
+/*
+ * Get the raw value of a remote analog input. If the node is offline or doesn't
+ * provide the input, 0 is returned.
+ */
+uint16_t CanIO::getRemoteAnalogIn(uint8_t channel)
+{
+    if (!isRemoteAnalogInput(channel)) {
+        return 0;
+    }
+    channel -= IO_REMOTE_FIRST_ANALOG_INPUT;
+    RemoteNode *node = &remoteNodes[channel / CFG_REMOTE_IO_ANALOG_INPUTS_PER_NODE];
+    uint8_t input = channel % CFG_REMOTE_IO_ANALOG_INPUTS_PER_NODE;
+
+    if (!node->online || input >= node->numAnalogInputs) {
+        return 0;
+    }
+    return node->analogInputs[input];
+}
+
+/*
+ * Set a remote output (0=off, 255=on, values in-between = PWM duty cycle).
+ * If the value changed, the node gets an update immediately.
+ */
+void CanIO::setRemoteOutput(uint8_t channel, uint8_t value)
+{
+    if (!isRemoteOutput(channel)) {
+        return;
+    }
+    channel -= IO_REMOTE_FIRST_OUTPUT;
+    uint8_t nodeNumber = channel / CFG_REMOTE_IO_OUTPUTS_PER_NODE;
+    uint8_t output = channel % CFG_REMOTE_IO_OUTPUTS_PER_NODE;
+
+    if (remoteNodes[nodeNumber].outputs[output] != value) {
+        remoteNodes[nodeNumber].outputs[output] = value;
+        if (remoteNodes[nodeNumber].uniqueId != 0) {
+            sendRemoteOutputs(nodeNumber);
+        }
+    }
+}
+
+/*
+ * Get the requested value of a remote output.
+ */
+uint8_t CanIO::getRemoteOutput(uint8_t channel)
+{
+    if (!isRemoteOutput(channel)) {
+        return 0;
+    }
+    channel -= IO_REMOTE_FIRST_OUTPUT;
+    return remoteNodes[channel / CFG_REMOTE_IO_OUTPUTS_PER_NODE].outputs[channel % CFG_REMOTE_IO_OUTPUTS_PER_NODE];
+}
+
+/*
+ * Print the list of known extension nodes and their channel mapping to the console.
+ */
+void CanIO::printRemoteNodes()
+{
+    logger.console("CAN I/O extension nodes:");
+    for (int nodeNumber = 0; nodeNumber < CFG_REMOTE_IO_MAX_NODES; nodeNumber++) {
+        RemoteNode *node = &remoteNodes[nodeNumber];
+        if (node->uniqueId == 0) {
+            continue;
+        }
+        logger.console("  node %d: id=%#x, %s, digital inputs %d-%d (%#x), analog inputs %d-%d, outputs %d-%d", nodeNumber, node->uniqueId,
+                (node->online ? "online" : "OFFLINE"),
+                IO_REMOTE_FIRST_DIGITAL_INPUT + nodeNumber * CFG_REMOTE_IO_DIGITAL_INPUTS_PER_NODE,
+                IO_REMOTE_FIRST_DIGITAL_INPUT + nodeNumber * CFG_REMOTE_IO_DIGITAL_INPUTS_PER_NODE + node->numDigitalInputs - 1,
+                node->digitalInputs,
+                IO_REMOTE_FIRST_ANALOG_INPUT + nodeNumber * CFG_REMOTE_IO_ANALOG_INPUTS_PER_NODE,
+                IO_REMOTE_FIRST_ANALOG_INPUT + nodeNumber * CFG_REMOTE_IO_ANALOG_INPUTS_PER_NODE + node->numAnalogInputs - 1,
+                IO_REMOTE_FIRST_OUTPUT + nodeNumber * CFG_REMOTE_IO_OUTPUTS_PER_NODE,
+                IO_REMOTE_FIRST_OUTPUT + nodeNumber * CFG_REMOTE_IO_OUTPUTS_PER_NODE + node->numOutputs - 1);
     }
 }
 
@@ -263,17 +603,29 @@ void CanIO::loadConfiguration()
 #else
     if (prefsHandler->checksumValid()) { //checksum is good, read in the values stored in EEPROM
 #endif
-//        prefsHandler->read(EESYS_, &config->);
+        for (int node = 0; node < CFG_REMOTE_IO_MAX_NODES; node++) {
+            prefsHandler->read(EECANIO_NODE_IDS + node * 4, &config->nodeIds[node]);
+        }
     } else {
-//        config-> = 0;
+        memset(config->nodeIds, 0, sizeof(config->nodeIds));
         saveConfiguration();
     }
-//    logger.info(getId(), "xyz: %d", config->);
+    for (int node = 0; node < CFG_REMOTE_IO_MAX_NODES; node++) {
+        if (config->nodeIds[node] != 0) {
+            logger.info(this, "I/O node %#x is assigned to node %d", config->nodeIds[node], node);
+        }
+    }
 }
 
 void CanIO::saveConfiguration()
 {
-//    prefsHandler->write(EESYS_, config->);
+    CanIOConfiguration *config = (CanIOConfiguration *) getConfiguration();
+
+    Device::saveConfiguration(); // call parent
+
+    for (int node = 0; node < CFG_REMOTE_IO_MAX_NODES; node++) {
+        prefsHandler->write(EECANIO_NODE_IDS + node * 4, config->nodeIds[node]);
+    }
     prefsHandler->saveChecksum();
 }
 
@@ -47,6 +47,16 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define IO_CAN_MASK                0x7fc // mask for above id's                     11111111100
 #define IO_CAN_MASKED_ID           0x728 // masked id for id's from 0x258 to 0x268  11100101000
 
+// remote I/O protocol on EV bus (range 0x740 - 0x77f)
+#define IO_CAN_ID_REMOTE_DISCOVER  0x740 // GEVCU -> all: request all extension nodes to announce themselves
+#define IO_CAN_ID_REMOTE_ANNOUNCE  0x741 // node -> GEVCU: unique id and number of channels of a node
+#define IO_CAN_ID_REMOTE_ASSIGN    0x742 // GEVCU -> node: assign a node number to a unique id
+#define IO_CAN_ID_REMOTE_DIGITAL   0x750 // + node number, node -> GEVCU: digital input bitmap
+#define IO_CAN_ID_REMOTE_ANALOG    0x758 // + node number, node -> GEVCU: analog input values
+#define IO_CAN_ID_REMOTE_OUTPUT    0x760 // + node number, GEVCU -> node: output values (0=off, 255=on, else PWM)
+#define IO_CAN_MASK_REMOTE         0x7c0 // mask for above id's                     11111000000
+#define IO_CAN_MASKED_ID_REMOTE    0x740 // masked id for id's from 0x740 to 0x77f  11101000000
+
 // messages to listen to on CAR bus
 #define IO_CAN_ID_CRUISE_CONTROL   0x117 // Info on cruise control buttons          00100010111
 #define IO_CAN_ID_VEHICLE_SPEED    0x000 //
@@ -54,9 +64,18 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define IO_CAN_MASKED_ID_CAR       0x117 // masked id for id's                      00100010111
 
 
+/*
+ * Remote I/O channels are mapped into SystemIO's channel numbering right after the local channels.
+ * E.g. with 8 local outputs, output 8 is the first output of remote node 0, output 16 the first of node 1.
+ */
+#define IO_REMOTE_FIRST_DIGITAL_INPUT   CFG_NUMBER_DIGITAL_INPUTS
+#define IO_REMOTE_FIRST_ANALOG_INPUT    CFG_NUMBER_ANALOG_INPUTS
+#define IO_REMOTE_FIRST_OUTPUT          CFG_NUMBER_DIGITAL_OUTPUTS
+
 class CanIOConfiguration : public DeviceConfiguration
 {
 public:
+    uint32_t nodeIds[CFG_REMOTE_IO_MAX_NODES]; // unique id of the extension node assigned to each node number (0 = unused)
 };
 
 class CanIO: public Device, public CanObserver
@@ -114,17 +133,51 @@ public:
     void loadConfiguration();
     void saveConfiguration();
 
+    bool isRemoteInput(uint8_t channel);
+    bool isRemoteAnalogInput(uint8_t channel);
+    bool isRemoteOutput(uint8_t channel);
+    bool getRemoteDigitalIn(uint8_t channel);
+    uint16_t getRemoteAnalogIn(uint8_t channel);
+    void setRemoteOutput(uint8_t channel, uint8_t value);
+    uint8_t getRemoteOutput(uint8_t channel);
+    void printRemoteNodes();
+
 protected:
 
 private:
+    struct RemoteNode {
+        uint32_t uniqueId; // unique id reported by the node, 0 = slot unused
+        uint8_t numDigitalInputs; // number of digital inputs the node reported
+        uint8_t numAnalogInputs; // number of analog inputs the node reported
+        uint8_t numOutputs; // number of outputs the node reported
+        bool online; // is the node actively sending data
+        uint32_t lastSeen; // millis() of last frame received from the node
+        uint16_t digitalInputs; // bitmap of digital input states
+        uint16_t analogInputs[CFG_REMOTE_IO_ANALOG_INPUTS_PER_NODE]; // raw analog input values
+        uint8_t outputs[CFG_REMOTE_IO_OUTPUTS_PER_NODE]; // requested output values (0=off, 255=on, else PWM duty)
+    };
+
     CAN_FRAME outputFrame; // the output CAN frame;
     MotorController *motorController;
     DcDcConverter *dcdcConverter;
+    RemoteNode remoteNodes[CFG_REMOTE_IO_MAX_NODES]; // the known extension nodes, index = node number
+    uint8_t discoveryTicks; // ticks since the last discovery request
+    bool nodeIdsChanged; // a node number was assigned, the configuration is saved in the next tick
+
+    int8_t assignNodeNumber(uint32_t uniqueId);
+    void markNodeSeen(uint8_t nodeNumber);
+    uint32_t getNodeTimeout(RemoteNode *node);
 
     void processTemperature(byte []);
     void sendIOStatus();
     void sendAnalogData();
     void sendMotorData();
+    void sendDiscoveryRequest();
+    void sendNodeAssignment(uint8_t nodeNumber);
+    void sendRemoteOutputs(uint8_t nodeNumber);
+    void processNodeAnnouncement(CAN_FRAME *frame);
+    void processRemoteInputs(CAN_FRAME *frame);
+    void checkRemoteNodes();
     MotorController::CruiseControlButton getCruiseControlButton(uint8_t data[]);
 };
 
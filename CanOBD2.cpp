@@ -41,6 +41,8 @@ CanOBD2::CanOBD2() :
 
     arrayPos = 0;
     lastRequestAnswered = true;
+    responsePos = 0;
+    responseSequence = 0;
 }
 
 void CanOBD2::setup()
@@ -103,6 +105,9 @@ void CanOBD2::handleTick()
 /**
  * /brief Process the incoming request for data and send the response back.
  *
+ * Responses which fit into 7 bytes are sent as single frame. Longer responses (multi-PID mode 0x22)
+ * are sent as ISO-TP first frame, the rest follows in consecutive frames once the tester sends a flow control frame.
+ *
  * @param frame can message with request details
  */
 void CanOBD2::processRequest(CAN_FRAME *frame)
@@ -112,10 +117,55 @@ void CanOBD2::processRequest(CAN_FRAME *frame)
 
     logger.debug(this, "received OBD2 request for GEVCU data");
     if (canHandlerRespond != NULL) {
+        responsePos = 0; // a new request aborts a pending multi-frame response
+        if (!OBD2Handler::getInstance()->processRequest(frame->data.bytes, response)) {
+            return;
+        }
+
         canHandlerRespond->prepareOutputFrame(&outputFrame, OBD2_CAN_ID_RESPONSE + config->canIdOffsetRespond);
-        if (OBD2Handler::getInstance()->processRequest(frame->data.bytes, outputFrame.data.bytes)) {
-            canHandlerRespond->sendFrame(outputFrame);
+        if (response[0] < 8) {
+            memcpy(outputFrame.data.bytes, response, response[0] + 1);
+        } else {
+            outputFrame.data.bytes[0] = OBD2_ISOTP_FIRST_FRAME;
+            outputFrame.data.bytes[1] = response[0];
+            memcpy(outputFrame.data.bytes + 2, response + 1, 6);
+            responsePos = 7;
+            responseSequence = 1;
         }
+        canHandlerRespond->sendFrame(outputFrame);
+    }
+}
+
+/**
+ * /brief Send the consecutive frames of a pending multi-frame response after the tester's flow control frame.
+ *
+ * The block size is respected (0 = send all), the separation time is not as the frames are
+ * queued in the CAN controller's TX mailboxes anyway.
+ *
+ * @param frame flow control frame from the tester
+ */
+void CanOBD2::processFlowControl(CAN_FRAME *frame)
+{
+    CanOBD2Configuration *config = (CanOBD2Configuration *) getConfiguration();
+    CAN_FRAME outputFrame;
+    uint8_t blockSize = frame->data.bytes[1];
+    uint8_t frames = 0;
+
+    if (responsePos == 0 || canHandlerRespond == NULL || (frame->data.bytes[0] & 0x0f) != OBD2_ISOTP_FLOW_CONTINUE) {
+        return;
+    }
+
+    canHandlerRespond->prepareOutputFrame(&outputFrame, OBD2_CAN_ID_RESPONSE + config->canIdOffsetRespond);
+    while (responsePos <= response[0] && (blockSize == 0 || frames < blockSize)) {
+        outputFrame.data.bytes[0] = OBD2_ISOTP_CONSECUTIVE_FRAME | (responseSequence++ & 0x0f);
+        memset(outputFrame.data.bytes + 1, 0, 7);
+        memcpy(outputFrame.data.bytes + 1, response + responsePos, min(7, response[0] + 1 - responsePos));
+        canHandlerRespond->sendFrame(outputFrame);
+        responsePos += 7;
+        frames++;
+    }
+    if (responsePos > response[0]) {
+        responsePos = 0; // all sent
     }
 }
 
@@ -158,7 +208,11 @@ void CanOBD2::handleCanFrame(CAN_FRAME *frame)
 
     // a request from CAN bus for OBD2 data (e.g. from a diagnostic tool)
     if ((frame->id == OBD2_CAN_ID_REQUEST + config->canIdOffsetRespond) || (frame->id == OBD2_CAN_ID_BROADCAST)) {
-        processRequest(frame);
+        if ((frame->data.bytes[0] & 0xf0) == OBD2_ISOTP_FLOW_CONTROL) {
+            processFlowControl(frame);
+        } else {
+            processRequest(frame);
+        }
     }
     // a response to our poll for OBD2 data (e.g. containing the vehicle speed)
     if (frame->id >= OBD2_CAN_ID_RESPONSE && frame->id < OBD2_CAN_ID_RESPONSE + 8) {
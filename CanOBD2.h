@@ -43,6 +43,12 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define OBD2_CAN_MASK_POLL_RESPONSE      0x7f0 // mask for above id's              11111110000
 #define OBD2_CAN_MASKED_ID_POLL_RESPONSE 0x7e0 // masked id for id's 0x7e8-0x7ef   11111100000
 
+#define OBD2_ISOTP_SINGLE_FRAME      0x00 // ISO-TP frame types (upper nibble of first data byte)
+#define OBD2_ISOTP_FIRST_FRAME       0x10
+#define OBD2_ISOTP_CONSECUTIVE_FRAME 0x20
+#define OBD2_ISOTP_FLOW_CONTROL      0x30
+#define OBD2_ISOTP_FLOW_CONTINUE     0x00 // flow status "continue to send"
+
 //                                 PID  LEN DESCRIPTION                MIN  MAX  UNITS  FORMULA
 #define PID_SUPPORTED_01_20       0x00 // 4 PIDs supported [01 - 20]                    Bit encoded [A7..D0] == [PID $01..PID $20
 #define PID_SUPPORTED_21_40       0x20 // 4 PIDs supported [21 - 40]                    Bit encoded [A7..D0] == [PID $21..PID $40]
@@ -101,7 +107,12 @@ private:
     uint8_t arrayPos;
     bool lastRequestAnswered;
 
+    uint8_t response[CFG_OBD2_MAX_RESPONSE_SIZE]; // response which doesn't fit into a single frame
+    uint8_t responsePos; // position of the next byte in response to send in a consecutive frame
+    uint8_t responseSequence; // sequence number of the next consecutive frame
+
     void processRequest(CAN_FRAME* frame);
+    void processFlowControl(CAN_FRAME* frame);
     void processResponse(CAN_FRAME* frame);
 };
 
@@ -0,0 +1,416 @@
+/*
+ * CanOpen.cpp
+ *
+ * Minimal CANopen master (CiA 301) for devices like inverters which are controlled
+ * via NMT, configured via SDO and exchange process data via PDO's.
+ *
+ * Only expedited SDO transfers (max 4 bytes) are supported which is sufficient to
+ * configure PDO mappings, communication and drive parameters.
+ *
+Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "CanOpen.h"
+
+CanOpen::CanOpen()
+{
+    canHandler = NULL;
+    nodeId = 0;
+    nmtState = NMT_STATE_UNKNOWN;
+    lastHeartbeat = 0;
+    emergencyCode = 0;
+    bootUp = false;
+    sdoHead = sdoTail = 0;
+    sdoTimestamp = 0;
+    sdoErrorCount = 0;
+    numReceiveMappings = numTransmitMappings = 0;
+}
+
+/*
+ * Attach to all frames of the given node (the function code part of the COB-ID is masked out).
+ * Frames with function codes which a node doesn't send are filtered in handleCanFrame().
+ */
+void CanOpen::setup(CanHandler *canHandler, uint8_t nodeId)
+{
+    this->canHandler = canHandler;
+    this->nodeId = nodeId & CANOPEN_MASK_NODE;
+    nmtState = NMT_STATE_UNKNOWN;
+    sdoHead = sdoTail = 0;
+    sdoTimestamp = 0;
+
+    canHandler->attach(this, this->nodeId, CANOPEN_MASK_NODE, false);
+}
+
+void CanOpen::tearDown()
+{
+    if (canHandler != NULL) {
+        canHandler->detach(this, nodeId, CANOPEN_MASK_NODE);
+    }
+    sdoHead = sdoTail = 0;
+    sdoTimestamp = 0;
+}
+
+void CanOpen::handleCanFrame(CAN_FRAME *frame)
+{
+    switch (frame->id & ~CANOPEN_MASK_NODE) {
+    case CANOPEN_COB_HEARTBEAT:
+        if (nmtState != (frame->data.bytes[0] & 0x7f)) {
+            logger.debug("CANopen node %d changed NMT state to %#x", nodeId, frame->data.bytes[0] & 0x7f);
+        }
+        nmtState = (NmtState) (frame->data.bytes[0] & 0x7f);
+        if (nmtState == NMT_STATE_BOOTUP) {
+            bootUp = true;
+            nmtState = NMT_STATE_PRE_OPERATIONAL; // a node enters pre-operational automatically after boot-up
+        }
+        lastHeartbeat = millis();
+        break;
+
+    case CANOPEN_COB_SDO_RESPONSE:
+        processSdoResponse(frame);
+        break;
+
+    case CANOPEN_COB_EMCY:
+        emergencyCode = frame->data.bytes[0] | (frame->data.bytes[1] << 8);
+        if (emergencyCode != 0) {
+            logger.warn("CANopen node %d reports emergency %#04x (error register %#02x)", nodeId, emergencyCode, frame->data.bytes[2]);
+        }
+        break;
+
+    case CANOPEN_COB_TPDO1:
+    case CANOPEN_COB_TPDO1 + 0x100:
+    case CANOPEN_COB_TPDO1 + 0x200:
+    case CANOPEN_COB_TPDO1 + 0x300:
+        processPdo(frame);
+        break;
+
+    default:
+        // RPDO's, SDO requests or foreign messages which happen to match the node id, not for us
+        break;
+    }
+}
+
+/*
+ * Supervise the SDO transfer in progress and the heartbeat of the node.
+ * Must be called regularly by the owner.
+ */
+void CanOpen::handleTick()
+{
+    if (sdoTimestamp != 0 && (millis() - sdoTimestamp) > CFG_CANOPEN_SDO_TIMEOUT) {
+        logger.error("CANopen node %d: SDO timeout (object %#04x/%d)", nodeId, sdoQueue[sdoTail].index, sdoQueue[sdoTail].subIndex);
+        sdoErrorCount++;
+        sdoTail = (sdoTail + 1) % CFG_CANOPEN_SDO_QUEUE_SIZE;
+        sdoTimestamp = 0;
+        sendSdoRequest();
+    }
+
+    if (nmtState != NMT_STATE_UNKNOWN && (millis() - lastHeartbeat) > CFG_CANOPEN_HEARTBEAT_TIMEOUT) {
+        logger.warn("CANopen node %d: heartbeat lost", nodeId);
+        nmtState = NMT_STATE_UNKNOWN;
+    }
+}
+
+/*
+ * Send an NMT command to the node.
+ */
+void CanOpen::sendNmt(NmtCommand command)
+{
+    canHandler->prepareOutputFrame(&outputFrame, CANOPEN_COB_NMT);
+    outputFrame.length = 2;
+    outputFrame.data.bytes[0] = command;
+    outputFrame.data.bytes[1] = nodeId;
+    canHandler->sendFrame(outputFrame);
+    logger.debug("CANopen node %d: sending NMT command %#02x", nodeId, command);
+}
+
+CanOpen::NmtState CanOpen::getNmtState()
+{
+    return nmtState;
+}
+
+/*
+ * Returns true (once) if the node sent a boot-up message since the last call, e.g. after a reset.
+ */
+bool CanOpen::checkBootUp()
+{
+    bool ret = bootUp;
+    bootUp = false;
+    return ret;
+}
+
+uint16_t CanOpen::getEmergencyCode()
+{
+    return emergencyCode;
+}
+
+/*
+ * Queue an expedited SDO download (write a value of 1-4 bytes into the node's object dictionary).
+ * Returns false if the queue is full.
+ */
+bool CanOpen::sdoDownload(uint16_t index, uint8_t subIndex, uint32_t value, uint8_t size)
+{
+    uint8_t next = (sdoHead + 1) % CFG_CANOPEN_SDO_QUEUE_SIZE;
+
+    if (next == sdoTail || size == 0 || size > 4) {
+        return false;
+    }
+    sdoQueue[sdoHead].index = index;
+    sdoQueue[sdoHead].subIndex = subIndex;
+    sdoQueue[sdoHead].value = value;
+    sdoQueue[sdoHead].size = size;
+    sdoQueue[sdoHead].variable = NULL;
+    sdoHead = next;
+
+    if (sdoTimestamp == 0) {
+        sendSdoRequest();
+    }
+    return true;
+}
+
+/*
+ * Queue an expedited SDO upload (read a value of 1-4 bytes from the node's object dictionary).
+ * The value is stored in the variable once the response is received.
+ * Returns false if the queue is full.
+ */
+bool CanOpen::sdoUpload(uint16_t index, uint8_t subIndex, void *variable, uint8_t size)
+{
+    uint8_t next = (sdoHead + 1) % CFG_CANOPEN_SDO_QUEUE_SIZE;
+
+    if (next == sdoTail || variable == NULL || size == 0 || size > 4) {
+        return false;
+    }
+    sdoQueue[sdoHead].index = index;
+    sdoQueue[sdoHead].subIndex = subIndex;
+    sdoQueue[sdoHead].value = 0;
+    sdoQueue[sdoHead].size = size;
+    sdoQueue[sdoHead].variable = variable;
+    sdoHead = next;
+
+    if (sdoTimestamp == 0) {
+        sendSdoRequest();
+    }
+    return true;
+}
+
+/*
+ * Are all queued SDO transfers finished ?
+ */
+bool CanOpen::isSdoIdle()
+{
+    return (sdoHead == sdoTail);
+}
+
+uint16_t CanOpen::getSdoErrorCount()
+{
+    return sdoErrorCount;
+}
+
+uint8_t CanOpen::getNodeId()
+{
+    return nodeId;
+}
+
+/*
+ * Send the SDO request at the tail of the queue (if any)
+ */
+void CanOpen::sendSdoRequest()
+{
+    if (sdoHead == sdoTail) {
+        return;
+    }
+    SdoRequest *request = &sdoQueue[sdoTail];
+
+    canHandler->prepareOutputFrame(&outputFrame, CANOPEN_COB_SDO_REQUEST + nodeId);
+    if (request->variable == NULL) {
+        outputFrame.data.bytes[0] = CANOPEN_SDO_DOWNLOAD | ((4 - request->size) << 2);
+        outputFrame.data.high = request->value; // bytes 4-7, little endian
+    } else {
+        outputFrame.data.bytes[0] = CANOPEN_SDO_UPLOAD;
+    }
+    outputFrame.data.bytes[1] = request->index & 0xff;
+    outputFrame.data.bytes[2] = request->index >> 8;
+    outputFrame.data.bytes[3] = request->subIndex;
+    canHandler->sendFrame(outputFrame);
+    sdoTimestamp = max(millis(), 1); // 0 is used as "no request pending"
+}
+
+void CanOpen::processSdoResponse(CAN_FRAME *frame)
+{
+    uint8_t *bytes = frame->data.bytes;
+
+    if (sdoTimestamp == 0 || sdoHead == sdoTail) {
+        return; // unsolicited response
+    }
+    SdoRequest *request = &sdoQueue[sdoTail];
+    if ((bytes[1] | (bytes[2] << 8)) != request->index || bytes[3] != request->subIndex) {
+        return; // not the response to our request
+    }
+
+    if (bytes[0] == CANOPEN_SDO_ABORT) {
+        logger.error("CANopen node %d: SDO transfer of object %#04x/%d aborted, code %#08x", nodeId, request->index, request->subIndex,
+                frame->data.high);
+        sdoErrorCount++;
+    } else if (request->variable != NULL && (bytes[0] & 0xf3) == CANOPEN_SDO_UPLOAD_ACK) {
+        memcpy(request->variable, bytes + 4, min(request->size, 4 - ((bytes[0] >> 2) & 0x03)));
+    } else if (request->variable != NULL || bytes[0] != CANOPEN_SDO_DOWNLOAD_ACK) {
+        logger.error("CANopen node %d: unexpected SDO response %#02x for object %#04x/%d", nodeId, bytes[0], request->index, request->subIndex);
+        sdoErrorCount++;
+    }
+
+    sdoTail = (sdoTail + 1) % CFG_CANOPEN_SDO_QUEUE_SIZE;
+    sdoTimestamp = 0;
+    sendSdoRequest();
+}
+
+/*
+ * Map a value of a PDO sent by the node to a variable.
+ */
+bool CanOpen::mapReceivePdo(uint16_t cobId, uint8_t offset, uint8_t size, bool isSigned, void *variable, uint8_t variableSize, int32_t factor,
+        int32_t divisor)
+{
+    return addMapping(receiveMappings, &numReceiveMappings, cobId, offset, size, isSigned, variable, variableSize, factor, divisor);
+}
+
+/*
+ * Map a variable to a value of a PDO sent to the node. All mappings of the same PDO must be added one after the other.
+ */
+bool CanOpen::mapTransmitPdo(uint16_t cobId, uint8_t offset, uint8_t size, void *variable, uint8_t variableSize, int32_t factor, int32_t divisor)
+{
+    return addMapping(transmitMappings, &numTransmitMappings, cobId, offset, size, true, variable, variableSize, factor, divisor);
+}
+
+void CanOpen::clearPdoMappings()
+{
+    numReceiveMappings = numTransmitMappings = 0;
+}
+
+bool CanOpen::addMapping(PdoMapping *mappings, uint8_t *count, uint16_t cobId, uint8_t offset, uint8_t size, bool isSigned, void *variable,
+        uint8_t variableSize, int32_t factor, int32_t divisor)
+{
+    if (*count >= CFG_CANOPEN_MAX_PDO_MAPPINGS || offset + size > 8 || divisor == 0) {
+        logger.error("CANopen node %d: unable to map PDO %#03x offset %d", nodeId, cobId, offset);
+        return false;
+    }
+    PdoMapping *mapping = &mappings[(*count)++];
+    mapping->cobId = cobId;
+    mapping->offset = offset;
+    mapping->size = size;
+    mapping->isSigned = isSigned;
+    mapping->variable = variable;
+    mapping->variableSize = variableSize;
+    mapping->factor = factor;
+    mapping->divisor = divisor;
+    return true;
+}
+
+/*
+ * Decode a received PDO into the mapped variables. Values which need no conversion are
+ * copied directly from the frame into the variable.
+ */
+void CanOpen::processPdo(CAN_FRAME *frame)
+{
+    for (uint8_t i = 0; i < numReceiveMappings; i++) {
+        PdoMapping *mapping = &receiveMappings[i];
+        if (mapping->cobId != frame->id || mapping->offset + mapping->size > frame->length) {
+            continue;
+        }
+
+        if (mapping->factor == 1 && mapping->divisor == 1 && mapping->size == mapping->variableSize) {
+            memcpy(mapping->variable, frame->data.bytes + mapping->offset, mapping->size);
+        } else {
+            int32_t value = readVariable(frame->data.bytes + mapping->offset, mapping->size, mapping->isSigned);
+            writeVariable(mapping->variable, mapping->variableSize, value * mapping->factor / mapping->divisor);
+        }
+    }
+}
+
+/*
+ * Send all mapped PDO's followed by a SYNC message. A node applies synchronous RPDO's
+ * received before the SYNC with that SYNC, so the new values (e.g. a torque command)
+ * take effect in this sync cycle and not only in the next one.
+ */
+void CanOpen::sendSync()
+{
+    if (nmtState == NMT_STATE_OPERATIONAL) { // PDO's are only processed by the node in operational state
+        for (uint8_t i = 0; i < numTransmitMappings; i++) {
+            PdoMapping *mapping = &transmitMappings[i];
+
+            if (i == 0 || mapping->cobId != transmitMappings[i - 1].cobId) {
+                canHandler->prepareOutputFrame(&outputFrame, mapping->cobId);
+                outputFrame.length = 0;
+                outputFrame.priority = CAN_PRIORITY_HIGHEST;
+            }
+            if (mapping->factor == 1 && mapping->divisor == 1 && mapping->size == mapping->variableSize) {
+                memcpy(outputFrame.data.bytes + mapping->offset, mapping->variable, mapping->size);
+            } else {
+                int32_t value = readVariable(mapping->variable, mapping->variableSize, true) * mapping->factor / mapping->divisor;
+                memcpy(outputFrame.data.bytes + mapping->offset, &value, mapping->size); // little endian -> lowest bytes
+            }
+            outputFrame.length = max(outputFrame.length, mapping->offset + mapping->size);
+
+            if (i == numTransmitMappings - 1 || transmitMappings[i + 1].cobId != mapping->cobId) {
+                canHandler->sendFrame(outputFrame);
+            }
+        }
+    }
+
+    canHandler->prepareOutputFrame(&outputFrame, CANOPEN_COB_SYNC);
+    outputFrame.length = 0;
+    outputFrame.priority = CAN_PRIORITY_LOWEST; // so the SYNC can't overtake a PDO still waiting in a TX mailbox
+    canHandler->sendFrame(outputFrame);
+}
+
+/*
+ * Read a little endian value of 1, 2 or 4 bytes and sign extend it if required.
+ */
+int32_t CanOpen::readVariable(void *variable, uint8_t size, bool isSigned)
+{
+    switch (size) {
+    case 1:
+        return (isSigned ? *(int8_t *) variable : *(uint8_t *) variable);
+    case 2: {
+        uint16_t value;
+        memcpy(&value, variable, 2); // PDO data may not be aligned
+        return (isSigned ? (int16_t) value : value);
+    }
+    default: {
+        int32_t value;
+        memcpy(&value, variable, 4);
+        return value;
+    }
+    }
+}
+
+void CanOpen::writeVariable(void *variable, uint8_t size, int32_t value)
+{
+    switch (size) {
+    case 1:
+        *(uint8_t *) variable = value;
+        break;
+    case 2:
+        *(int16_t *) variable = value;
+        break;
+    default:
+        *(int32_t *) variable = value;
+        break;
+    }
+}
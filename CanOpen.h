@@ -0,0 +1,149 @@
+/*
+ * CanOpen.h
+ *
+ * Minimal CANopen master (CiA 301) for devices like inverters which are controlled
+ * via NMT, configured via SDO and exchange process data via PDO's.
+ *
+Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef CANOPEN_H_
+#define CANOPEN_H_
+
+#include <Arduino.h>
+#include "config.h"
+#include "CanHandler.h"
+#include "Logger.h"
+
+// function codes of the pre-defined connection set (COB-ID = function code + node id)
+#define CANOPEN_COB_NMT             0x000 // NMT command, master -> nodes (no node id)
+#define CANOPEN_COB_SYNC            0x080 // SYNC, master -> nodes (no node id)
+#define CANOPEN_COB_EMCY            0x080 // emergency message, node -> master
+#define CANOPEN_COB_TPDO1           0x180 // transmit PDO 1-4 of the node (0x180, 0x280, 0x380, 0x480)
+#define CANOPEN_COB_RPDO1           0x200 // receive PDO 1-4 of the node (0x200, 0x300, 0x400, 0x500)
+#define CANOPEN_COB_SDO_RESPONSE    0x580 // SDO server -> client
+#define CANOPEN_COB_SDO_REQUEST     0x600 // SDO client -> server
+#define CANOPEN_COB_HEARTBEAT       0x700 // heartbeat / boot-up message of the node
+#define CANOPEN_COB_ID_INVALID      0x80000000 // bit 31 of a PDO's COB-ID object: PDO disabled, required while its mapping is changed
+#define CANOPEN_MASK_NODE           0x07f // mask for all frames of one node (the function code is ignored)
+
+// SDO command specifiers (expedited transfers only)
+#define CANOPEN_SDO_DOWNLOAD        0x23 // initiate expedited download, bits 2-3 = 4 - size
+#define CANOPEN_SDO_DOWNLOAD_ACK    0x60 // download response
+#define CANOPEN_SDO_UPLOAD          0x40 // initiate upload
+#define CANOPEN_SDO_UPLOAD_ACK      0x43 // expedited upload response, bits 2-3 = 4 - size
+#define CANOPEN_SDO_ABORT           0x80 // abort transfer
+
+class CanOpen: public CanObserver
+{
+public:
+    enum NmtCommand {
+        NMT_START = 0x01,
+        NMT_STOP = 0x02,
+        NMT_ENTER_PRE_OPERATIONAL = 0x80,
+        NMT_RESET_NODE = 0x81,
+        NMT_RESET_COMMUNICATION = 0x82
+    };
+
+    enum NmtState {
+        NMT_STATE_BOOTUP = 0x00,
+        NMT_STATE_STOPPED = 0x04,
+        NMT_STATE_OPERATIONAL = 0x05,
+        NMT_STATE_PRE_OPERATIONAL = 0x7f,
+        NMT_STATE_UNKNOWN = 0xff // no heartbeat received (yet or anymore)
+    };
+
+    /*
+     * Maps a part of a PDO to a variable. Received PDO's are decoded directly into the variable,
+     * transmitted PDO's are encoded directly from it (CANopen and the SAM3X are both little endian).
+     * If factor and divisor are 1, the bytes are copied without any conversion.
+     */
+    struct PdoMapping {
+        uint16_t cobId; // the COB-ID of the PDO (incl. node id)
+        uint8_t offset; // offset of the value within the PDO
+        uint8_t size; // size of the value in the PDO in bytes (1, 2 or 4)
+        bool isSigned; // must the value be sign extended
+        int32_t factor; // conversion factor to GEVCU units (value * factor / divisor)
+        int32_t divisor; // conversion divisor
+        void *variable; // the variable the value is copied from/to
+        uint8_t variableSize; // size of the variable in bytes (1, 2 or 4)
+    };
+
+    CanOpen();
+    void setup(CanHandler *canHandler, uint8_t nodeId);
+    void tearDown();
+    void handleCanFrame(CAN_FRAME *frame);
+    void handleTick();
+
+    void sendNmt(NmtCommand command);
+    NmtState getNmtState();
+    bool checkBootUp();
+    uint16_t getEmergencyCode();
+
+    bool sdoDownload(uint16_t index, uint8_t subIndex, uint32_t value, uint8_t size);
+    bool sdoUpload(uint16_t index, uint8_t subIndex, void *variable, uint8_t size);
+    bool isSdoIdle();
+    uint16_t getSdoErrorCount();
+    uint8_t getNodeId();
+
+    bool mapReceivePdo(uint16_t cobId, uint8_t offset, uint8_t size, bool isSigned, void *variable, uint8_t variableSize, int32_t factor = 1, int32_t divisor = 1);
+    bool mapTransmitPdo(uint16_t cobId, uint8_t offset, uint8_t size, void *variable, uint8_t variableSize, int32_t factor = 1, int32_t divisor = 1);
+    void clearPdoMappings();
+    void sendSync();
+
+private:
+    struct SdoRequest {
+        uint16_t index; // index of the object
+        uint8_t subIndex; // sub-index of the object
+        uint8_t size; // size of the value in bytes (1-4)
+        uint32_t value; // value to download (write)
+        void *variable; // variable to store an uploaded (read) value, NULL for downloads
+    };
+
+    CanHandler *canHandler; // the bus the node is connected to
+    uint8_t nodeId; // node id of the slave (1-127)
+    NmtState nmtState; // the last reported NMT state of the node
+    uint32_t lastHeartbeat; // millis() of the last heartbeat of the node
+    uint16_t emergencyCode; // the last reported emergency error code (0 = no error)
+    bool bootUp; // a boot-up message was received
+
+    SdoRequest sdoQueue[CFG_CANOPEN_SDO_QUEUE_SIZE]; // pending SDO transfers, processed one at a time
+    uint8_t sdoHead, sdoTail; // ring buffer pointers of sdoQueue
+    uint32_t sdoTimestamp; // millis() when the actual SDO request was sent, 0 = none in progress
+    uint16_t sdoErrorCount; // number of aborted or timed out SDO transfers
+
+    PdoMapping receiveMappings[CFG_CANOPEN_MAX_PDO_MAPPINGS]; // mappings of PDO's sent by the node
+    PdoMapping transmitMappings[CFG_CANOPEN_MAX_PDO_MAPPINGS]; // mappings of PDO's sent to the node
+    uint8_t numReceiveMappings, numTransmitMappings;
+    CAN_FRAME outputFrame;
+
+    void sendSdoRequest();
+    void processSdoResponse(CAN_FRAME *frame);
+    void processPdo(CAN_FRAME *frame);
+    bool addMapping(PdoMapping *mappings, uint8_t *count, uint16_t cobId, uint8_t offset, uint8_t size, bool isSigned, void *variable,
+            uint8_t variableSize, int32_t factor, int32_t divisor);
+    int32_t readVariable(void *variable, uint8_t size, bool isSigned);
+    void writeVariable(void *variable, uint8_t size, int32_t value);
+};
+
+#endif /* CANOPEN_H_ */
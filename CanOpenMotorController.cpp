@@ -0,0 +1,367 @@
+/*
+ * CanOpenMotorController.cpp
+ *
+ * Generic motor controller for inverters which implement the CANopen drive profile (CiA 402).
+ *
+ * To adapt it to a specific inverter, modify the object dictionary description below:
+ * objectDescription lists the objects which are written via SDO at start-up (e.g. PDO mapping,
+ * transmission types, heartbeat), pdoDescription defines how the mapped PDO's are decoded into
+ * (or encoded from) the MotorController fields.
+ *
+Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "CanOpenMotorController.h"
+
+/*
+ * Objects written to the drive while it's pre-operational. The PDO's are switched to
+ * synchronous transmission so the drive sends its values and applies our commands with every SYNC.
+ * A PDO is invalidated (CiA 301) while its mapping is changed. The COB-ID's (sub-index 1 of
+ * 0x1400/0x1800) are listed without the node id, it's added by configureNode().
+ */
+const CanOpenMotorController::ObjectDescription objectDescription[] = {
+        { 0x1017, 0, 2, CFG_CANOPEN_HEARTBEAT_TIME },   // heartbeat producer time in ms
+
+        { 0x1800, 1, 4, CANOPEN_COB_ID_INVALID | CANOPEN_COB_TPDO1 }, // TPDO1: invalidate
+        { 0x1A00, 0, 1, 0 },                            //   mapping: disable
+        { 0x1A00, 1, 4, 0x60410010 },                   //   status word, 16 bit
+        { 0x1A00, 2, 4, 0x606C0020 },                   //   velocity actual value, 32 bit
+        { 0x1A00, 3, 4, 0x60770010 },                   //   torque actual value, 16 bit
+        { 0x1A00, 0, 1, 3 },                            //   enable with 3 entries
+        { 0x1800, 2, 1, 1 },                            //   transmission type: every SYNC
+        { 0x1800, 1, 4, CANOPEN_COB_TPDO1 },            //   re-enable
+
+        { 0x1801, 1, 4, CANOPEN_COB_ID_INVALID | (CANOPEN_COB_TPDO1 + 0x100) }, // TPDO2: invalidate
+        { 0x1A01, 0, 1, 0 },                            //   mapping: disable
+        { 0x1A01, 1, 4, 0x60790020 },                   //   DC link circuit voltage, 32 bit
+        { 0x1A01, 0, 1, 1 },                            //   enable with 1 entry
+        { 0x1801, 2, 1, 1 },                            //   transmission type: every SYNC
+        { 0x1801, 1, 4, CANOPEN_COB_TPDO1 + 0x100 },    //   re-enable
+
+        { 0x1400, 1, 4, CANOPEN_COB_ID_INVALID | CANOPEN_COB_RPDO1 }, // RPDO1: invalidate
+        { 0x1600, 0, 1, 0 },                            //   mapping: disable
+        { 0x1600, 1, 4, 0x60400010 },                   //   control word, 16 bit
+        { 0x1600, 2, 4, 0x60710010 },                   //   target torque, 16 bit
+        { 0x1600, 3, 4, 0x60FF0020 },                   //   target velocity, 32 bit
+        { 0x1600, 0, 1, 3 },                            //   enable with 3 entries
+        { 0x1400, 2, 1, 1 },                            //   transmission type: synchronous
+        { 0x1400, 1, 4, CANOPEN_COB_RPDO1 }             //   re-enable
+};
+
+/*
+ * Decoding of the PDO's configured above. The velocity is an INT32 but only its lower 16 bits are
+ * mapped (little endian) so it's copied directly into speedActual. Mappings of the same PDO must
+ * be listed one after the other.
+ */
+const CanOpenMotorController::PdoDescription pdoDescription[] = {
+        { CANOPEN_COB_TPDO1, 0, 2, false, CanOpenMotorController::PV_STATUS_WORD, 1, 1 },
+        { CANOPEN_COB_TPDO1, 2, 2, true, CanOpenMotorController::PV_SPEED_ACTUAL, 1, 1 },
+        { CANOPEN_COB_TPDO1, 6, 2, true, CanOpenMotorController::PV_TORQUE_ACTUAL, 1, 1 },
+        { CANOPEN_COB_TPDO1 + 0x100, 0, 4, false, CanOpenMotorController::PV_DC_VOLTAGE, 1, 100 }, // mV -> 0.1V
+
+        { CANOPEN_COB_RPDO1, 0, 2, false, CanOpenMotorController::PV_CONTROL_WORD, 1, 1 },
+        { CANOPEN_COB_RPDO1, 2, 2, true, CanOpenMotorController::PV_TARGET_TORQUE, 1, 1 },
+        { CANOPEN_COB_RPDO1, 4, 4, true, CanOpenMotorController::PV_TARGET_VELOCITY, 1, 1 }
+};
+
+CanOpenMotorController::CanOpenMotorController() : MotorController()
+{
+    prefsHandler = new PrefHandler(CANOPEN_MC);
+    configuring = false;
+    configured = false;
+    configureFailed = false;
+    sdoErrorsBefore = 0;
+    faulted = false;
+    statusWord = 0;
+    controlWord = shutdown;
+    torqueActualRelative = 0;
+    targetTorque = 0;
+    targetVelocity = 0;
+    ratedTorque = 0;
+
+    commonName = "CANopen (CiA 402) Inverter";
+}
+
+void CanOpenMotorController::setup()
+{
+    MotorController::setup(); // run the parent class version of this function
+
+    CanOpenMotorControllerConfiguration *config = (CanOpenMotorControllerConfiguration *) getConfiguration();
+    canOpen.setup(&canHandlerEv, config->nodeId);
+    mapProcessData();
+    // reset the communication so the node sends a boot-up message and we configure it
+    canOpen.sendNmt(CanOpen::NMT_RESET_COMMUNICATION);
+
+    tickHandler.attach(this, CFG_TICK_INTERVAL_MOTOR_CONTROLLER_CANOPEN);
+}
+
+/**
+ * Tear down the controller in a safe way.
+ */
+void CanOpenMotorController::tearDown()
+{
+    MotorController::tearDown();
+
+    // request zero torque and disable the power stage before stopping the communication
+    targetTorque = 0;
+    targetVelocity = 0;
+    controlWord = shutdown;
+    canOpen.sendSync();
+    canOpen.sendNmt(CanOpen::NMT_ENTER_PRE_OPERATIONAL);
+    canOpen.tearDown();
+}
+
+/*
+ * Process event from the tick handler.
+ *
+ * The tick interval is the SYNC period: after the super-class calculated the requested torque,
+ * the SYNC message is sent together with the new command so the drive applies it with the next cycle.
+ */
+void CanOpenMotorController::handleTick()
+{
+    MotorController::handleTick(); // call parent
+    canOpen.handleTick();
+
+    CanOpen::NmtState nmtState = canOpen.getNmtState();
+    if (canOpen.checkBootUp() || nmtState == CanOpen::NMT_STATE_UNKNOWN) {
+        configured = false; // node lost or re-booted, it must be configured again
+    }
+    if (nmtState == CanOpen::NMT_STATE_UNKNOWN) {
+        ready = running = false;
+        configuring = false;
+        return;
+    }
+    reportActivity();
+
+    if (!configured && !configuring && nmtState == CanOpen::NMT_STATE_PRE_OPERATIONAL) {
+        configureNode();
+    }
+    if (configuring && canOpen.isSdoIdle()) {
+        configuring = false;
+        configured = true; // not retried until the node re-boots
+        uint16_t errors = canOpen.getSdoErrorCount() - sdoErrorsBefore;
+        if (errors > 0 || configureFailed) {
+            // a node with an incomplete mapping would interpret the PDO's wrongly, leave it pre-operational
+            logger.error(this, "configuration of CANopen node failed (%d SDO errors), not starting it", errors);
+            faultHandler.raiseFault(getId(), FAULT_MOTORCTRL_COMM, true);
+        } else {
+            faultHandler.cancelOngoingFault(getId(), FAULT_MOTORCTRL_COMM);
+            canOpen.sendNmt(CanOpen::NMT_START);
+        }
+    }
+
+    ready = (nmtState == CanOpen::NMT_STATE_OPERATIONAL);
+    running = ready && (statusWord & operationEnabled);
+
+    if (ratedTorque > 0) {
+        torqueActual = (int32_t) torqueActualRelative * (int32_t) ratedTorque / 100000; // per mille of mNm -> 0.1Nm
+    }
+    updateControlWord();
+    updateTargetValues();
+    canOpen.sendSync();
+}
+
+/*
+ * Write the object dictionary description to the node and read the rated torque which is
+ * required to convert between per mille and Nm.
+ */
+void CanOpenMotorController::configureNode()
+{
+    MotorControllerConfiguration *config = (MotorControllerConfiguration *) getConfiguration();
+
+    logger.info(this, "configuring CANopen node");
+    configuring = true;
+    sdoErrorsBefore = canOpen.getSdoErrorCount();
+    configureFailed = false;
+    for (uint8_t i = 0; i < sizeof(objectDescription) / sizeof(ObjectDescription); i++) {
+        const ObjectDescription *object = &objectDescription[i];
+        uint32_t value = object->value;
+        if (object->subIndex == 1 && ((object->index & 0xFE00) == 0x1400 || (object->index & 0xFE00) == 0x1800)) {
+            value += canOpen.getNodeId(); // PDO COB-ID
+        }
+        configureFailed |= !canOpen.sdoDownload(object->index, object->subIndex, value, object->size);
+    }
+    configureFailed |= !canOpen.sdoDownload(CANOPEN_OBJ_MODES_OF_OPERATION, 0,
+            (config->powerMode == modeSpeed ? CANOPEN_MODE_PROFILE_VELOCITY : CANOPEN_MODE_PROFILE_TORQUE), 1);
+    configureFailed |= !canOpen.sdoUpload(CANOPEN_OBJ_RATED_TORQUE, 0, &ratedTorque, 4);
+}
+
+/*
+ * Register the PDO description with the CANopen master, resolving the process values to
+ * the actual variables.
+ */
+void CanOpenMotorController::mapProcessData()
+{
+    CanOpenMotorControllerConfiguration *config = (CanOpenMotorControllerConfiguration *) getConfiguration();
+
+    canOpen.clearPdoMappings();
+    for (uint8_t i = 0; i < sizeof(pdoDescription) / sizeof(PdoDescription); i++) {
+        const PdoDescription *pdo = &pdoDescription[i];
+        uint8_t size;
+        void *variable = getProcessValue(pdo->value, &size);
+
+        if ((pdo->functionCode & 0xff) == 0) { // RPDO's of the drive are at 0x200, 0x300, 0x400 and 0x500
+            canOpen.mapTransmitPdo(pdo->functionCode + config->nodeId, pdo->offset, pdo->size, variable, size, pdo->factor, pdo->divisor);
+        } else {
+            canOpen.mapReceivePdo(pdo->functionCode + config->nodeId, pdo->offset, pdo->size, pdo->isSigned, variable, size, pdo->factor,
+                    pdo->divisor);
+        }
+    }
+}
+
+/*
+ * Walk through the CiA 402 state machine of the drive depending on its status word
+ * and the power state requested by GEVCU.
+ */
+void CanOpenMotorController::updateControlWord()
+{
+    if (statusWord & fault) {
+        if (!faulted) {
+            logger.error(this, "drive reports fault (emergency code %#04x)", canOpen.getEmergencyCode());
+            faultHandler.raiseFault(getId(), FAULT_MOTORCTRL_MISC, true);
+            faulted = true;
+        }
+        controlWord = (controlWord == faultReset ? shutdown : faultReset); // fault reset is triggered by a rising edge
+        return;
+    }
+    if (faulted) {
+        faultHandler.cancelOngoingFault(getId(), FAULT_MOTORCTRL_MISC);
+        faulted = false;
+    }
+
+    if (!powerOn || !ready) {
+        controlWord = shutdown;
+    } else if ((statusWord & 0x6f) == (readyToSwitchOn | switchedOn | operationEnabled | quickStop)
+            || (statusWord & 0x6f) == (readyToSwitchOn | switchedOn | quickStop)) {
+        controlWord = enableOperation;
+    } else if ((statusWord & 0x6f) == (readyToSwitchOn | quickStop)) {
+        controlWord = switchOn;
+    } else {
+        controlWord = shutdown; // switch on disabled -> ready to switch on
+    }
+}
+
+/*
+ * Convert the torque and speed requested by the super-class into the drive's units.
+ */
+void CanOpenMotorController::updateTargetValues()
+{
+    MotorControllerConfiguration *config = (MotorControllerConfiguration *) getConfiguration();
+    int32_t torqueCommand = 0;
+    int32_t speedCommand = 0;
+
+    if (powerOn && running) {
+        torqueCommand = getTorqueRequested();
+        speedCommand = getSpeedRequested();
+        if (config->invertDirection ^ (getGear() == GEAR_REVERSE)) { // reverse the motor direction if specified
+            torqueCommand *= -1;
+            speedCommand *= -1;
+        }
+    }
+
+    if (ratedTorque > 0) {
+        targetTorque = constrain(torqueCommand * 100000 / (int32_t) ratedTorque, -1000, 1000); // 0.1Nm -> per mille of rated torque (mNm)
+    } else if (config->torqueMax > 0) {
+        targetTorque = constrain(torqueCommand * 1000 / config->torqueMax, -1000, 1000); // rated torque unknown, use configured max torque
+    } else {
+        targetTorque = 0;
+    }
+    targetVelocity = (config->powerMode == modeSpeed ? speedCommand : 0);
+}
+
+/*
+ * Get the address and size of the variable which holds a process value.
+ */
+void *CanOpenMotorController::getProcessValue(ProcessValue value, uint8_t *size)
+{
+    *size = 2;
+    switch (value) {
+    case PV_STATUS_WORD:
+        return &statusWord;
+    case PV_SPEED_ACTUAL:
+        return &speedActual;
+    case PV_TORQUE_ACTUAL:
+        return &torqueActualRelative;
+    case PV_DC_VOLTAGE:
+        return &dcVoltage;
+    case PV_DC_CURRENT:
+        return &dcCurrent;
+    case PV_AC_CURRENT:
+        return &acCurrent;
+    case PV_TEMPERATURE_MOTOR:
+        return &temperatureMotor;
+    case PV_TEMPERATURE_CONTROLLER:
+        return &temperatureController;
+    case PV_CONTROL_WORD:
+        return &controlWord;
+    case PV_TARGET_TORQUE:
+        return &targetTorque;
+    case PV_TARGET_VELOCITY:
+        *size = 4;
+        return &targetVelocity;
+    }
+    return NULL;
+}
+
+DeviceId CanOpenMotorController::getId()
+{
+    return (CANOPEN_MC);
+}
+
+void CanOpenMotorController::loadConfiguration()
+{
+    CanOpenMotorControllerConfiguration *config = (CanOpenMotorControllerConfiguration *) getConfiguration();
+
+    if (!config) { // as lowest sub-class make sure we have a config object
+        config = new CanOpenMotorControllerConfiguration();
+        setConfiguration(config);
+    }
+
+    MotorController::loadConfiguration(); // call parent
+
+#ifdef USE_HARD_CODED
+
+    if (false) {
+#else
+    if (prefsHandler->checksumValid()) { //checksum is good, read in the values stored in EEPROM
+#endif
+        prefsHandler->read(EEMC_CANOPEN_NODE_ID, &config->nodeId);
+    } else { //checksum invalid. Reinitialize values and store to EEPROM
+        config->nodeId = 1;
+        saveConfiguration();
+    }
+    logger.info(this, "CANopen node id: %d", config->nodeId);
+}
+
+/*
+ * Store the current configuration parameters to EEPROM.
+ */
+void CanOpenMotorController::saveConfiguration()
+{
+    CanOpenMotorControllerConfiguration *config = (CanOpenMotorControllerConfiguration *) getConfiguration();
+
+    MotorController::saveConfiguration(); // call parent
+
+    prefsHandler->write(EEMC_CANOPEN_NODE_ID, config->nodeId);
+    prefsHandler->saveChecksum();
+}
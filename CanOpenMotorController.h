@@ -0,0 +1,147 @@
+/*
+ * CanOpenMotorController.h
+ *
+ * Generic motor controller for inverters which implement the CANopen drive profile (CiA 402).
+ * The inverter is configured at start-up via SDO's according to an object dictionary
+ * description, afterwards the process data is exchanged via synchronous PDO's.
+ *
+Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef CANOPENMOTORCONTROLLER_H_
+#define CANOPENMOTORCONTROLLER_H_
+
+#include <Arduino.h>
+#include "config.h"
+#include "MotorController.h"
+#include "CanOpen.h"
+#include "TickHandler.h"
+#include "FaultHandler.h"
+
+// CiA 402 objects
+#define CANOPEN_OBJ_CONTROL_WORD        0x6040
+#define CANOPEN_OBJ_STATUS_WORD         0x6041
+#define CANOPEN_OBJ_MODES_OF_OPERATION  0x6060
+#define CANOPEN_OBJ_VELOCITY_ACTUAL     0x606C
+#define CANOPEN_OBJ_TARGET_TORQUE       0x6071
+#define CANOPEN_OBJ_RATED_TORQUE        0x6076
+#define CANOPEN_OBJ_TORQUE_ACTUAL       0x6077
+#define CANOPEN_OBJ_DC_LINK_VOLTAGE     0x6079
+#define CANOPEN_OBJ_TARGET_VELOCITY     0x60FF
+
+#define CANOPEN_MODE_PROFILE_VELOCITY   3
+#define CANOPEN_MODE_PROFILE_TORQUE     4
+
+class CanOpenMotorControllerConfiguration: public MotorControllerConfiguration
+{
+public:
+    uint8_t nodeId; // CANopen node id of the inverter (1-127)
+};
+
+class CanOpenMotorController: public MotorController
+{
+public:
+    // CiA 402 control word commands
+    enum ControlWord {
+        shutdown            = 0x06,
+        switchOn            = 0x07,
+        enableOperation     = 0x0f,
+        faultReset          = 0x80
+    };
+
+    // CiA 402 status word bits
+    enum StatusWord {
+        readyToSwitchOn     = 1 << 0,
+        switchedOn          = 1 << 1,
+        operationEnabled    = 1 << 2,
+        fault               = 1 << 3,
+        voltageEnabled      = 1 << 4,
+        quickStop           = 1 << 5,
+        switchOnDisabled    = 1 << 6,
+        warning             = 1 << 7
+    };
+
+    // the process values which can be mapped into PDO's
+    enum ProcessValue {
+        PV_STATUS_WORD,             // uint16, status word of the drive
+        PV_SPEED_ACTUAL,            // int16, rpm -> MotorController::speedActual
+        PV_TORQUE_ACTUAL,           // int16, per mille of rated torque
+        PV_DC_VOLTAGE,              // uint16, 0.1V -> MotorController::dcVoltage
+        PV_DC_CURRENT,              // int16, 0.1A -> MotorController::dcCurrent
+        PV_AC_CURRENT,              // uint16, 0.1A -> MotorController::acCurrent
+        PV_TEMPERATURE_MOTOR,       // int16, 0.1C -> MotorController::temperatureMotor
+        PV_TEMPERATURE_CONTROLLER,  // int16, 0.1C -> MotorController::temperatureController
+        PV_CONTROL_WORD,            // uint16, control word sent to the drive
+        PV_TARGET_TORQUE,           // int16, per mille of rated torque
+        PV_TARGET_VELOCITY          // int32, rpm
+    };
+
+    // an object which is written via SDO at start-up (object dictionary description)
+    struct ObjectDescription {
+        uint16_t index;
+        uint8_t subIndex;
+        uint8_t size; // 1, 2 or 4 bytes
+        uint32_t value;
+    };
+
+    // a process value which is sent/received via PDO (COB-ID = function code + node id)
+    struct PdoDescription {
+        uint16_t functionCode; // CANOPEN_COB_TPDO1 (+0x100 per PDO) for data from the drive, CANOPEN_COB_RPDO1 (+0x100 per PDO) to the drive
+        uint8_t offset; // offset in the PDO
+        uint8_t size; // size in the PDO (1, 2 or 4 bytes)
+        bool isSigned;
+        ProcessValue value; // the process value the data is copied from/to
+        int32_t factor, divisor; // conversion to GEVCU units, use 1/1 to copy without conversion
+    };
+
+    CanOpenMotorController();
+    void setup();
+    void tearDown();
+    void handleTick();
+    DeviceId getId();
+
+    void loadConfiguration();
+    void saveConfiguration();
+
+private:
+    CanOpen canOpen; // the CANopen master for the inverter node
+    bool configuring; // true while the start-up SDO's are being transferred
+    bool configured; // true after the start-up SDO's were transferred and the node was started
+    bool configureFailed; // a start-up SDO couldn't be queued
+    uint16_t sdoErrorsBefore; // SDO error count of the CANopen master when the configuration started
+    bool faulted; // true while the drive reports a fault
+    uint16_t statusWord; // CiA 402 status word received from the drive
+    uint16_t controlWord; // CiA 402 control word sent to the drive
+    int16_t torqueActualRelative; // actual torque in per mille of rated torque
+    int16_t targetTorque; // requested torque in per mille of rated torque
+    int32_t targetVelocity; // requested speed in rpm
+    uint32_t ratedTorque; // rated torque of the motor in mNm (read via SDO, 0 = unknown)
+
+    void configureNode();
+    void mapProcessData();
+    void updateControlWord();
+    void updateTargetValues();
+    void *getProcessValue(ProcessValue value, uint8_t *size);
+};
+
+#endif /* CANOPENMOTORCONTROLLER_H_ */
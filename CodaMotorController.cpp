@@ -66,10 +66,8 @@ void CodaMotorController::handleCanFrame(CAN_FRAME *frame) {
     //TODO: running should only be set to true if the controller reports that its power-stageis up and running.
     running = true;
 
-    if (logger.isDebug()) {
-        logger.debug(this, "msg: %#02x   %#02x   %#02x   %#02x   %#02x   %#02x   %#02x   %#02x  %#02x", frame->id, frame->data.bytes[0], frame->data.bytes[1],
-            frame->data.bytes[2], frame->data.bytes[3], frame->data.bytes[4], frame->data.bytes[5], frame->data.bytes[6], frame->data.bytes[7]);
-    }
+    LOG_DEBUG(this, "msg: %#02x   %#02x   %#02x   %#02x   %#02x   %#02x   %#02x   %#02x  %#02x", frame->id, frame->data.bytes[0], frame->data.bytes[1],
+        frame->data.bytes[2], frame->data.bytes[3], frame->data.bytes[4], frame->data.bytes[5], frame->data.bytes[6], frame->data.bytes[7]);
 
     switch (frame->id) {
 
@@ -78,9 +76,7 @@ void CodaMotorController::handleCanFrame(CAN_FRAME *frame) {
         dcVoltage = (((frame->data.bytes[3] * 256) + frame->data.bytes[2]) - 32128);
         dcCurrent = (((frame->data.bytes[5] * 256) + frame->data.bytes[4]) - 32128);
         speedActual = abs((((frame->data.bytes[7] * 256) + frame->data.bytes[6]) - 32128) / 2);
-        if (logger.isDebug()) {
-            logger.debug(this, "Actual Torque: %d DC Voltage: %d Amps: %d RPM: %d", torqueActual / 10, dcVoltage / 10, dcCurrent / 10, speedActual);
-        }
+        LOG_DEBUG(this, "Actual Torque: %d DC Voltage: %d Amps: %d RPM: %d", torqueActual / 10, dcVoltage / 10, dcCurrent / 10, speedActual);
         reportActivity();
         break;
 
@@ -110,9 +106,7 @@ void CodaMotorController::handleCanFrame(CAN_FRAME *frame) {
         statorTemp = frame->data.bytes[4];
         temperatureController = (invTemp - 40) * 10;
         temperatureMotor = (max(rotorTemp, statorTemp) - 40) * 10;
-        if (logger.isDebug()) {
-            logger.debug(this, "Inverter temp: %d Motor temp: %d", temperatureController, temperatureMotor);
-        }
+        LOG_DEBUG(this, "Inverter temp: %d Motor temp: %d", temperatureController, temperatureMotor);
         reportActivity();
         break;
 
@@ -196,10 +190,8 @@ void CodaMotorController::sendCmd1() {
 
     canHandlerEv.sendFrame(output);  //Mail it.
 
-    if (logger.isDebug()) {
-        logger.debug(this, "Torque command: %#x   %#x  ControlByte: %#x  LSB %#x  MSB: %#x  CRC: %#x", output.id, output.data.bytes[0],
-            output.data.bytes[1], output.data.bytes[2], output.data.bytes[3], output.data.bytes[4]);
-    }
+    LOG_DEBUG(this, "Torque command: %#x   %#x  ControlByte: %#x  LSB %#x  MSB: %#x  CRC: %#x", output.id, output.data.bytes[0],
+        output.data.bytes[1], output.data.bytes[2], output.data.bytes[3], output.data.bytes[4]);
 
 }
 
@@ -218,9 +210,7 @@ void CodaMotorController::sendCmd2() {
     output.data.bytes[2] = 0x5a;
 
     canHandlerEv.sendFrame(output);
-    if (logger.isDebug()) {
-        logger.debug(this, "Watchdog reset: %#x  %#x  %#x", output.data.bytes[0], output.data.bytes[1], output.data.bytes[2]);
-    }
+    LOG_DEBUG(this, "Watchdog reset: %#x  %#x  %#x", output.data.bytes[0], output.data.bytes[1], output.data.bytes[2]);
 
     status.warning = false;
 }
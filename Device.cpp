@@ -26,6 +26,7 @@
 
 #include "Device.h"
 #include "DeviceManager.h"
+#include "BootTimeline.h"
 
 /**
  * Constructor - initialize class variables
@@ -40,6 +41,7 @@ Device::Device()
     ready = false;
     running = false;
     powerOn = false;
+    logLevel = CFG_DEFAULT_LOGLEVEL;
 }
 
 /**
@@ -62,7 +64,9 @@ void Device::setup()
     running = false;
     powerOn = false;
 
+    uint32_t start = micros();
     loadConfiguration();
+    bootTimeline.add(BootTimeline::CONFIG_LOAD, getId(), start);
 
     logger.info(this, "device started");
 }
@@ -81,10 +85,18 @@ void Device::tearDown()
     logger.info(this, "device stopped");
 }
 
+/**
+ * Set the log level of the device, messages below it are omitted.
+ */
+void Device::setLogLevel(Logger::LogLevel level)
+{
+    logLevel = level;
+}
+
 /**
  * Retrieve the common name of the device.
  */
-String Device::getCommonName()
+const String &Device::getCommonName()
 {
     return commonName;
 }
@@ -190,9 +202,12 @@ void Device::handleMessage(uint32_t msgType, void* message)
 void Device::handleStateChange(Status::SystemState oldState, Status::SystemState newState)
 {
     switch (newState) {
-    case Status::init:
+    case Status::init: {
+        uint32_t start = micros();
         this->setup();
+        bootTimeline.add(BootTimeline::DEVICE_SETUP, getId(), start);
         break;
+    }
     case Status::error: // stop all devices in case of an error
         this->tearDown();
         break;
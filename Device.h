@@ -35,6 +35,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "PrefHandler.h"
 #include "Sys_Messages.h"
 #include "SystemIO.h"
+#include "Logger.h"
 
 class DeviceManager;
 
@@ -65,7 +66,9 @@ public:
 
     virtual DeviceType getType();
     virtual DeviceId getId();
-    String getCommonName();
+    const String &getCommonName();
+    Logger::LogLevel getLogLevel() { return logLevel; } // inline, it's checked before every log message of the device
+    void setLogLevel(Logger::LogLevel);
 
     void enable();
     void disable();
@@ -85,6 +88,7 @@ protected:
     bool ready; /*!> set if the device itself reports that it's ready for operation */
     bool running; /*!> set if the device itself reports that it's running / active */
     bool powerOn; /*!> set if the device has to be powered on - e.g. the power stage of a motor controller or DC-DC converter, may be ignored by various devices */
+    Logger::LogLevel logLevel; /*!> the log level of the device */
 
     void appendMessage(String &error, uint32_t bitfield, uint32_t flag, String message);
 
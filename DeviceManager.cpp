@@ -65,6 +65,7 @@ void DeviceManager::addDevice(Device *device)
 
         if (i != -1) {
             devices[i] = device;
+            device->setLogLevel(logger.getLogLevel());
         } else {
             logger.error(device, "unable to register device, max number of devices reached.");
         }
@@ -272,3 +273,28 @@ void DeviceManager::printDeviceList()
         }
     }
 }
+
+/*
+ * Set the log level of all registered devices
+ */
+void DeviceManager::setLogLevel(Logger::LogLevel level)
+{
+    for (int i = 0; i < CFG_DEV_MGR_MAX_DEVICES; i++) {
+        if (devices[i]) {
+            devices[i]->setLogLevel(level);
+        }
+    }
+}
+
+/*
+ * Check if any registered device has a certain log level
+ */
+bool DeviceManager::isAnyDeviceAtLogLevel(Logger::LogLevel level)
+{
+    for (int i = 0; i < CFG_DEV_MGR_MAX_DEVICES; i++) {
+        if (devices[i] && devices[i]->getLogLevel() == level) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -57,6 +57,8 @@ public:
     Device *getDeviceByID(DeviceId);
     Device *getDeviceByType(DeviceType);
     void printDeviceList();
+    void setLogLevel(Logger::LogLevel);
+    bool isAnyDeviceAtLogLevel(Logger::LogLevel);
 
 protected:
 
@@ -49,6 +49,7 @@ enum DeviceId {
     DMOC645 = 0x1000,
     BRUSA_DMC5 = 0x1001,
     CODAUQM = 0x1002,
+    CANOPEN_MC = 0x1003,
     BRUSA_NLG5 = 0x1010,
     TCCHCHARGE = 0x1020,
     LEARCHARGE = 0x1022,
@@ -66,6 +67,7 @@ enum DeviceId {
     HEARTBEAT = 0x5001,
     MEMCACHE = 0x5002,
     CANIO = 0x5003,
+    CANHANDLER = 0x5004,
     STATUSINDICATOR = 0x5010,
     CANOBD2= 0x6000,
     ELM327EMU = 0x6500,
@@ -77,6 +79,7 @@ const DeviceId deviceIds[] = {
         DMOC645,
         BRUSA_DMC5,
         CODAUQM,
+        CANOPEN_MC,
         BRUSA_NLG5,
         TCCHCHARGE,
         LEARCHARGE,
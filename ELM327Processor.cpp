@@ -12,7 +12,7 @@ String ELM327Processor::generateUpdate()
     return "";
 }
 
-String ELM327Processor::generateLogEntry(String logLevel, String deviceName, String message)
+String ELM327Processor::generateLogEntry(const char *logLevel, const char *deviceName, const char *message)
 {
     return "";
 }
@@ -85,32 +85,58 @@ String ELM327Processor::processInput(char *cmd)
             retString.concat("OK");
         }
     } else { //if no AT then assume it is a PID request. This takes the form of four bytes which form the alpha hex digit encoding for two bytes
-        //there should be four or six characters here forming the ascii representation of the PID request. Easiest for now is to turn the ascii into
-        //a 16 bit number and mask off to get the bytes
-        if (strlen(cmd) == 4) {
-            uint32_t valu = strtol((char *) cmd, NULL, 16);   //the pid format is always in hex
-            byte in[] = { 2, ((valu >> 8) & 0xFF), (valu & 0xFF) };
-            byte out[7];
+        //there should be two or more characters here forming the ascii representation of the request (e.g. "03", "010C" or "22E005E009" for
+        //multiple extended PIDs). Each pair of characters is converted into one byte of the request.
+        int length = strlen(cmd);
+        if (length >= 2 && (length % 2) == 0 && length <= 16) {
+            byte in[9];
+            byte out[CFG_OBD2_MAX_RESPONSE_SIZE];
             char buff[10];
 
-            if (obd2Handler->processRequest(in, out)) {
-                if (bHeader) {
-                    retString.concat("7E8");
-                    out[0] += 2; //not sending only data bits but mode and pid too
+            in[0] = length / 2;
+            for (int i = 0; i < in[0]; i++) {
+                char hex[] = { cmd[i * 2], cmd[i * 2 + 1], 0 };
+                in[i + 1] = strtol(hex, NULL, 16);   //the pid format is always in hex
+            }
 
-                    for (int i = 0; i <= out[0]; i++) {
-                        sprintf(buff, "%02X", out[i]);
+            if (obd2Handler->processRequest(in, out)) {
+                if (out[0] < 8) {
+                    if (bHeader) {
+                        retString.concat("7E8");
+                        for (int i = 0; i <= out[0]; i++) {
+                            sprintf(buff, "%02X", out[i]);
+                            retString.concat(buff);
+                        }
+                    } else {
+                        for (int i = 1; i <= out[0]; i++) {
+                            sprintf(buff, "%02X", out[i]);
+                            retString.concat(buff);
+                        }
+                    }
+                } else { // multi-frame response, use the same format as a real ELM327
+                    if (!bHeader) {
+                        sprintf(buff, "%03X", out[0]);
                         retString.concat(buff);
                     }
-                } else {
-                    sprintf(buff, "%02X", out[1]);
-                    retString.concat(buff);
-                    sprintf(buff, "%02X", out[2]);
-                    retString.concat(buff);
-
-                    for (int i = 1; i <= out[0]; i++) {
-                        sprintf(buff, "%02X", out[i + 2]);
+                    for (int pos = 1, frame = 0; pos <= out[0]; frame++) {
+                        if (frame > 0 || !bHeader) {
+                            retString.concat(lineEnding);
+                        }
+                        if (bHeader) {
+                            retString.concat("7E8");
+                            if (frame == 0) {
+                                sprintf(buff, "10%02X", out[0]);
+                            } else {
+                                sprintf(buff, "%02X", 0x20 | (frame & 0x0f));
+                            }
+                        } else {
+                            sprintf(buff, "%X:", frame & 0x0f);
+                        }
                         retString.concat(buff);
+                        for (int i = 0; i < (frame == 0 ? 6 : 7) && pos <= out[0]; i++, pos++) {
+                            sprintf(buff, "%02X", out[pos]);
+                            retString.concat(buff);
+                        }
                     }
                 }
             }
@@ -13,7 +13,7 @@ class ELM327Processor : public SocketProcessor
 public:
     ELM327Processor();
     String generateUpdate();
-    String generateLogEntry(String logLevel, String deviceName, String message);
+    String generateLogEntry(const char *logLevel, const char *deviceName, const char *message);
     String processInput(char *input);
 
 private:
@@ -125,9 +125,7 @@ void ELM327Emu::loop()
                 incomingBuffer[ibWritePtr] = 0; //null terminate the string
                 ibWritePtr = 0; //reset the write pointer
 
-                if (logger.isDebug()) {
-                    logger.debug(this, incomingBuffer);
-                }
+                LOG_DEBUG(this, incomingBuffer);
 
                 processCmd();
 
@@ -0,0 +1,103 @@
+/*
+ * EepromBackend.cpp
+ *
+Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "EepromBackend.h"
+
+I2cEepromBackend i2cEepromBackend;
+
+I2cEepromBackend::I2cEepromBackend()
+{
+    writeI2cId = 0;
+}
+
+void I2cEepromBackend::setup()
+{
+    Wire.begin();
+
+    //digital pin 18 (GEVCU 2) 19 (GEVCU>=3) is connected to the write protect function of the EEPROM. It is active high so set it low to enable writes
+    pinMode(CFG_EEPROM_WRITE_PROTECT, OUTPUT);
+    digitalWrite(CFG_EEPROM_WRITE_PROTECT, LOW);
+}
+
+/*
+ * Read a page from the EEPROM
+ */
+bool I2cEepromBackend::readPage(uint32_t address, uint8_t *data)
+{
+    uint8_t buffer[2];
+    uint8_t i2c_id = getI2cId(address);
+    uint16_t e;
+
+    buffer[0] = ((address & 0xFF00) >> 8);
+    buffer[1] = 0; //the pages are 256 bytes so the start of a page is always 00 for the LSB
+    Wire.beginTransmission(i2c_id);
+    Wire.write(buffer, 2);
+    Wire.endTransmission(false);  //do NOT generate stop
+    Wire.requestFrom(i2c_id, 256);  //this will generate stop though.
+
+    for (e = 0; e < 256; e++) {
+        if (!Wire.available()) {
+            return false;
+        }
+        data[e] = Wire.read();
+    }
+    return true;
+}
+
+/*
+ * Send data to the EEPROM. The chip starts its internal write cycle after the stop condition,
+ * completion must be polled with isWriteComplete().
+ */
+void I2cEepromBackend::write(uint32_t address, uint8_t *data, uint16_t length)
+{
+    uint8_t buffer[CFG_MEMCACHE_WRITE_CHUNK_SIZE + 2];
+
+    if (length > CFG_MEMCACHE_WRITE_CHUNK_SIZE) {
+        length = CFG_MEMCACHE_WRITE_CHUNK_SIZE;
+    }
+    buffer[0] = ((address & 0xFF00) >> 8);
+    buffer[1] = (address & 0x00FF);
+    memcpy(buffer + 2, data, length);
+    writeI2cId = getI2cId(address);
+
+    Wire.beginTransmission(writeI2cId);
+    Wire.write(buffer, length + 2);
+    Wire.endTransmission(true);
+}
+
+/*
+ * The chip does not acknowledge its address as long as it is busy writing.
+ */
+bool I2cEepromBackend::isWriteComplete()
+{
+    Wire.beginTransmission(writeI2cId);
+    return (Wire.endTransmission(true) == 0);
+}
+
+uint8_t I2cEepromBackend::getI2cId(uint32_t address)
+{
+    return 0b01010000 + ((address >> 16) & 0x03);  //10100 is the chip ID then the two upper bits of the address
+}
@@ -0,0 +1,69 @@
+/*
+ * EepromBackend.h
+ *
+ * Storage backends for the MemCache (the medium the cached pages are read from and written to)
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef EEPROM_BACKEND_H_
+#define EEPROM_BACKEND_H_
+
+#include <Arduino.h>
+#include "config.h"
+#include <due_wire.h>
+
+/*
+ * Interface of a storage medium for the MemCache.
+ * Addresses are byte addresses, pages are 256 bytes.
+ */
+class EepromBackend
+{
+public:
+    virtual void setup() = 0;
+    virtual bool readPage(uint32_t address, uint8_t *data) = 0; // read a whole 256 byte page, address must be page aligned
+    virtual void write(uint32_t address, uint8_t *data, uint16_t length) = 0; // start writing data which must not cross a page boundary
+    virtual bool isWriteComplete() = 0; // poll if the last write finished (no read or write may be started before)
+};
+
+/*
+ * The I2C EEPROM of the GEVCU (256kB). The two upper address bits select the chip id.
+ */
+class I2cEepromBackend: public EepromBackend
+{
+public:
+    I2cEepromBackend();
+    void setup();
+    bool readPage(uint32_t address, uint8_t *data);
+    void write(uint32_t address, uint8_t *data, uint16_t length);
+    bool isWriteComplete();
+
+private:
+    uint8_t writeI2cId; // i2c id of the chip the last write was sent to
+
+    uint8_t getI2cId(uint32_t address);
+};
+
+extern I2cEepromBackend i2cEepromBackend;
+
+#endif /* EEPROM_BACKEND_H_ */
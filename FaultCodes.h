@@ -132,6 +132,21 @@ enum FAULTCODE {
 	
 	//There was a general fault at the BMS
 	FAULT_BMS_MISC = 0xCC40, //U0C40
+
+	//The CAN controller of the EV bus went error passive (too many transmit or receive errors)
+	FAULT_CAN_EV_ERROR_PASSIVE = 0xCA01, //U0A01
+
+	//The CAN controller of the EV bus went bus-off and had to be re-initialized
+	FAULT_CAN_EV_BUS_OFF = 0xCA02, //U0A02
+
+	//The CAN controller of the car bus went error passive (too many transmit or receive errors)
+	FAULT_CAN_CAR_ERROR_PASSIVE = 0xCA11, //U0A11
+
+	//The CAN controller of the car bus went bus-off and had to be re-initialized
+	FAULT_CAN_CAR_BUS_OFF = 0xCA12, //U0A12
+
+	//There was a problem communicating with a CAN I/O extension node (+ node number, U0E60 - U0E67)
+	FAULT_CANIO_COMM = 0xCE60, //U0E60
 	
 	//The motor is too hot
 	FAULT_MOTOR_OVERTEMP = 0x0D50, //P0D50 
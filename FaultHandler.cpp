@@ -26,6 +26,11 @@
 
 #include "FaultHandler.h"
 #include "eeprom_layout.h"
+#include "DeviceManager.h"
+#include "Status.h"
+#include "SignalRecorder.h"
+
+const FreezeFrameValue FaultHandler::freezeFrameValues[CFG_FREEZE_FRAME_SIZE] = { CFG_FREEZE_FRAME_VALUES };
 
 FaultHandler::FaultHandler()
 {
@@ -33,6 +38,9 @@ FaultHandler::FaultHandler()
     globalTime = 0;
     faultReadPointer = 0;
     faultWritePointer = 0;
+    dirtyFaults = false;
+    memset(dirty, 0, sizeof(dirty));
+    memset(indexHead, FAULT_INDEX_NONE, sizeof(indexHead));
 }
 
 FaultHandler::~FaultHandler()
@@ -52,63 +60,254 @@ void FaultHandler::setup()
     tickHandler.attach(this, CFG_TICK_INTERVAL_HEARTBEAT);
 }
 
-//Every tick update the global time and save it to EEPROM (delayed saving)
+//Every tick update the global time and save it to the wear-levelled record store (delayed saving).
+//Faults modified since the last tick are written to the cache in one go, so a chattering fault
+//causes at most one EEPROM write per tick interval.
 void FaultHandler::handleTick()
 {
     globalTime = baseTime + (millis() / 100);
-//    memCache.Write(EE_FAULT_LOG + EEFAULT_RUNTIME, globalTime);
+    recordStore.put(RECORD_RUNTIME, globalTime);
+    writeDirtyFaults();
 }
 
+/*
+ * Register a fault. If the same device already raised the same code and it wasn't acknowledged yet,
+ * only its occurrence counter, last time stamp and ongoing flag are updated (looked up via the index).
+ * The record is written to the EEPROM with the next tick.
+ */
 void FaultHandler::raiseFault(uint16_t device, uint16_t code, bool ongoing = false)
 {
-    bool incPtr = false;
     globalTime = baseTime + (millis() / 100);
 
-    //first try to see if this fault is already registered as ongoing. If so don't update the time but set ongoing status if necessary
-    bool found = false;
-    for (int j = 0; j < CFG_FAULT_HISTORY_SIZE; j++) {
-        if (faultList[j].ongoing && faultList[j].device == device && faultList[j].faultCode == code) {
-            found = true;
-            //faultList[j].timeStamp = globalTime;
-            faultList[j].ongoing = ongoing;
-            break; //quit searching
+    int faultnum = findFault(device, code);
+    if (faultnum != -1) {
+        FAULT *fault = &faultList[faultnum];
+        if (fault->occurrences < 0xFFFF) {
+            fault->occurrences++;
         }
+        fault->lastTimeStamp = globalTime;
+        fault->ongoing = ongoing;
+        writeFaultToEEPROM(faultnum);
+        return;
     }
 
-    //nothing ongoing to register a new one
-    if (!found) {
-        faultList[faultWritePointer].timeStamp = globalTime;
-        faultList[faultWritePointer].ack = false;
-        faultList[faultWritePointer].device = device;
-        faultList[faultWritePointer].faultCode = code;
-        faultList[faultWritePointer].ongoing = ongoing;
-        incPtr = true;
+    //nothing un-ack'd found, register a new one (replacing the oldest)
+    FAULT *fault = &faultList[faultWritePointer];
+    if (!fault->ack) {
+        removeFromIndex(faultWritePointer);
     }
+    fault->timeStamp = globalTime;
+    fault->lastTimeStamp = globalTime;
+    fault->occurrences = 1;
+    fault->ack = false;
+    fault->device = device;
+    fault->faultCode = code;
+    fault->ongoing = ongoing;
+    captureFreezeFrame(&fault->freezeFrame);
+    signalRecorder.triggerFault(code);
+    addToIndex(faultWritePointer);
+    writeFaultToEEPROM(faultWritePointer);
 
-    //write back to EEPROM cache
-    memCache.Write(EE_FAULT_LOG + EEFAULT_FAULTS_START + sizeof(FAULT) * faultWritePointer, &faultList[faultWritePointer], sizeof(FAULT));
+    faultWritePointer = (faultWritePointer + 1) % CFG_FAULT_HISTORY_SIZE;
+    //Also announce fault on the console
+    logger.error("Fault %#x raised by device %#x at uptime %i", code, device, globalTime);
+}
 
-    if (incPtr) {
-        //Cause the memory caching system to immediately write the page but only if incPtr is set (only if this is a new fault)
-        memCache.InvalidateAddress(EE_FAULT_LOG + EEFAULT_FAULTS_START + sizeof(FAULT) * faultWritePointer);
-        faultWritePointer = (faultWritePointer + 1) % CFG_FAULT_HISTORY_SIZE;
-        memCache.Write(EE_FAULT_LOG + EEFAULT_WRITEPTR, faultWritePointer);
-        //Cause the page to be immediately fully aged so that it is written very soon.
-        memCache.AgeFullyAddress(EE_FAULT_LOG + EEFAULT_WRITEPTR);
-        //Also announce fault on the console
-        logger.error("Fault %#x raised by device %#x at uptime %i", code, device, globalTime);
+void FaultHandler::cancelOngoingFault(uint16_t device, uint16_t code)
+{
+    int faultnum = findFault(device, code);
+    if (faultnum != -1 && faultList[faultnum].ongoing) {
+        setFaultOngoing(faultnum, false);
     }
 }
 
-void FaultHandler::cancelOngoingFault(uint16_t device, uint16_t code)
+/*
+ * Take a snapshot of the configured values. As this runs in error paths, it only copies values
+ * the devices already have in memory (no allocation, no bus access).
+ */
+void FaultHandler::captureFreezeFrame(FREEZE_FRAME *frame)
+{
+    MotorController *motorController = deviceManager.getMotorController();
+    BatteryManager *batteryManager = deviceManager.getBatteryManager();
+
+    for (uint8_t i = 0; i < CFG_FREEZE_FRAME_SIZE; i++) {
+        int16_t value = 0;
+
+        switch (freezeFrameValues[i]) {
+        case FF_SYSTEM_STATE:
+            value = status.getSystemState();
+            break;
+        case FF_THROTTLE:
+            value = (motorController ? motorController->getThrottleLevel() : 0);
+            break;
+        case FF_TORQUE_REQUESTED:
+            value = (motorController ? motorController->getTorqueRequested() : 0);
+            break;
+        case FF_TORQUE_ACTUAL:
+            value = (motorController ? motorController->getTorqueActual() : 0);
+            break;
+        case FF_SPEED_ACTUAL:
+            value = (motorController ? motorController->getSpeedActual() : 0);
+            break;
+        case FF_DC_VOLTAGE:
+            if (batteryManager && batteryManager->hasPackVoltage()) {
+                value = batteryManager->getPackVoltage();
+            } else if (motorController) {
+                value = motorController->getDcVoltage();
+            }
+            break;
+        case FF_DC_CURRENT:
+            if (batteryManager && batteryManager->hasPackCurrent()) {
+                value = batteryManager->getPackCurrent();
+            } else if (motorController) {
+                value = motorController->getDcCurrent();
+            }
+            break;
+        case FF_AC_CURRENT:
+            value = (motorController ? motorController->getAcCurrent() : 0);
+            break;
+        case FF_TEMPERATURE_MOTOR:
+            value = (motorController ? motorController->getTemperatureMotor() : 0);
+            break;
+        case FF_TEMPERATURE_CONTROLLER:
+            value = (motorController ? motorController->getTemperatureController() : 0);
+            break;
+        case FF_TEMPERATURE_COOLANT:
+            value = status.temperatureCoolant;
+            break;
+        case FF_SOC:
+            value = (batteryManager && batteryManager->hasSoc() ? batteryManager->getSoc() : 0);
+            break;
+        case FF_LOWEST_CELL_VOLTS:
+            value = (batteryManager && batteryManager->hasCellVoltages() ? batteryManager->getLowestCellVolts() : 0);
+            break;
+        case FF_HIGHEST_CELL_VOLTS:
+            value = (batteryManager && batteryManager->hasCellVoltages() ? batteryManager->getHighestCellVolts() : 0);
+            break;
+        }
+        frame->values[i] = value;
+    }
+}
+
+FreezeFrameValue FaultHandler::getFreezeFrameValue(uint8_t index)
+{
+    return freezeFrameValues[index % CFG_FREEZE_FRAME_SIZE];
+}
+
+const char *FaultHandler::getFreezeFrameValueName(FreezeFrameValue value)
+{
+    switch (value) {
+    case FF_SYSTEM_STATE:
+        return "systemState";
+    case FF_THROTTLE:
+        return "throttle";
+    case FF_TORQUE_REQUESTED:
+        return "torqueRequested";
+    case FF_TORQUE_ACTUAL:
+        return "torqueActual";
+    case FF_SPEED_ACTUAL:
+        return "speedActual";
+    case FF_DC_VOLTAGE:
+        return "dcVoltage";
+    case FF_DC_CURRENT:
+        return "dcCurrent";
+    case FF_AC_CURRENT:
+        return "acCurrent";
+    case FF_TEMPERATURE_MOTOR:
+        return "temperatureMotor";
+    case FF_TEMPERATURE_CONTROLLER:
+        return "temperatureController";
+    case FF_TEMPERATURE_COOLANT:
+        return "temperatureCoolant";
+    case FF_SOC:
+        return "soc";
+    case FF_LOWEST_CELL_VOLTS:
+        return "lowestCellVolts";
+    case FF_HIGHEST_CELL_VOLTS:
+        return "highestCellVolts";
+    }
+    return "unknown";
+}
+
+/*
+ * Write all modified faults and the write pointer to the cache and queue the page(s) for writing
+ */
+void FaultHandler::writeDirtyFaults()
+{
+    if (!dirtyFaults) {
+        return;
+    }
+    for (int i = 0; i < CFG_FAULT_HISTORY_SIZE; i++) {
+        if (dirty[i / 8] & (1 << (i % 8))) {
+            uint32_t address = EE_FAULT_LOG + EEFAULT_FAULTS_START + sizeof(FAULT) * i;
+            memCache.Write(address, &faultList[i], sizeof(FAULT));
+            memCache.FlushAddress(address);
+        }
+    }
+    memCache.Write(EE_FAULT_LOG + EEFAULT_WRITEPTR, faultWritePointer);
+    memCache.FlushAddress(EE_FAULT_LOG + EEFAULT_WRITEPTR);
+    memset(dirty, 0, sizeof(dirty));
+    dirtyFaults = false;
+}
+
+/*
+ * Calculate the index bucket of a device/code combination
+ */
+uint8_t FaultHandler::getIndexSlot(uint16_t device, uint16_t code)
+{
+    return (device * 31 + code) & (CFG_FAULT_INDEX_SIZE - 1);
+}
+
+/*
+ * Find the un-ack'd fault of a device with the given code, returns -1 if there is none
+ */
+int FaultHandler::findFault(uint16_t device, uint16_t code)
+{
+    for (uint8_t i = indexHead[getIndexSlot(device, code)]; i != FAULT_INDEX_NONE; i = indexNext[i]) {
+        if (faultList[i].device == device && faultList[i].faultCode == code) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void FaultHandler::addToIndex(uint8_t faultnum)
+{
+    uint8_t slot = getIndexSlot(faultList[faultnum].device, faultList[faultnum].faultCode);
+    indexNext[faultnum] = indexHead[slot];
+    indexHead[slot] = faultnum;
+}
+
+void FaultHandler::removeFromIndex(uint8_t faultnum)
+{
+    uint8_t *link = &indexHead[getIndexSlot(faultList[faultnum].device, faultList[faultnum].faultCode)];
+    while (*link != FAULT_INDEX_NONE) {
+        if (*link == faultnum) {
+            *link = indexNext[faultnum];
+            return;
+        }
+        link = &indexNext[*link];
+    }
+}
+
+/*
+ * Create the index of all un-ack'd faults (after loading the faults from the EEPROM)
+ */
+void FaultHandler::rebuildIndex()
 {
+    memset(indexHead, FAULT_INDEX_NONE, sizeof(indexHead));
     for (int i = 0; i < CFG_FAULT_HISTORY_SIZE; i++) {
-        if (faultList[i].ongoing && faultList[i].device == device && faultList[i].faultCode == code) {
-            setFaultOngoing(i, false);
+        if (!faultList[i].ack && faultList[i].device != 0xFFFF) {
+            addToIndex(i);
         }
     }
 }
 
+uint32_t FaultHandler::getRuntime()
+{
+    return baseTime + (millis() / 100);
+}
+
 uint16_t FaultHandler::getFaultCount()
 {
     int count = 0;
@@ -126,22 +325,31 @@ void FaultHandler::loadFromEEPROM()
 {
     uint8_t validByte;
     memCache.Read(EE_FAULT_LOG, &validByte);
-    if (validByte == 0xB2) //magic byte value for a valid fault cache
+    if (validByte == 0xB4) //magic byte value for a valid fault cache
             {
         memCache.Read(EE_FAULT_LOG + EEFAULT_READPTR, &faultReadPointer);
         memCache.Read(EE_FAULT_LOG + EEFAULT_WRITEPTR, &faultWritePointer);
         memCache.Read(EE_FAULT_LOG + EEFAULT_RUNTIME, &globalTime);
+        recordStore.get(RECORD_RUNTIME, &globalTime); // more recent than the value in the fault log (if available)
         baseTime = globalTime;
         for (int i = 0; i < CFG_FAULT_HISTORY_SIZE; i++) {
             memCache.Read(EE_FAULT_LOG + EEFAULT_FAULTS_START + sizeof(FAULT) * i, &faultList[i], sizeof(FAULT));
         }
+        rebuildIndex();
     } else //reinitialize the fault cache storage
     {
-        validByte = 0xB2;
+        // keep the runtime of a fault log with a previous record format
+        globalTime = 0;
+        if (validByte == 0xB2 || validByte == 0xB3) {
+            memCache.Read(EE_FAULT_LOG + EEFAULT_RUNTIME, &globalTime);
+        }
+        recordStore.get(RECORD_RUNTIME, &globalTime);
+        baseTime = globalTime;
+
+        validByte = 0xB4;
         memCache.Write(EE_FAULT_LOG, validByte);
         memCache.Write(EE_FAULT_LOG + EEFAULT_READPTR, (uint16_t) 0);
         memCache.Write(EE_FAULT_LOG + EEFAULT_WRITEPTR, (uint16_t) 0);
-        globalTime = baseTime = millis() / 100;
         memCache.Write(EE_FAULT_LOG + EEFAULT_RUNTIME, globalTime);
 
         FAULT tempFault;
@@ -150,6 +358,9 @@ void FaultHandler::loadFromEEPROM()
         tempFault.faultCode = 0xFFFF;
         tempFault.ongoing = false;
         tempFault.timeStamp = 0;
+        tempFault.lastTimeStamp = 0;
+        tempFault.occurrences = 0;
+        memset(&tempFault.freezeFrame, 0, sizeof(FREEZE_FRAME));
         for (int i = 0; i < CFG_FAULT_HISTORY_SIZE; i++) {
             faultList[i] = tempFault;
         }
@@ -167,10 +378,14 @@ void FaultHandler::saveToEEPROM()
     }
 }
 
+/*
+ * Mark a fault as modified, it's written to the cache with the next tick
+ */
 void FaultHandler::writeFaultToEEPROM(int faultnum)
 {
-    if (faultnum > 0 && faultnum < CFG_FAULT_HISTORY_SIZE) {
-        memCache.Write(EE_FAULT_LOG + EEFAULT_FAULTS_START + sizeof(FAULT) * faultnum, &faultList[faultnum], sizeof(FAULT));
+    if (faultnum >= 0 && faultnum < CFG_FAULT_HISTORY_SIZE) {
+        dirty[faultnum / 8] |= 1 << (faultnum % 8);
+        dirtyFaults = true;
     }
 }
 
@@ -190,16 +405,31 @@ bool FaultHandler::getNextFault(FAULT *fault)
 
 bool FaultHandler::getFault(uint16_t fault, FAULT *outFault)
 {
-    if (fault > 0 && fault < CFG_FAULT_HISTORY_SIZE) {
-        outFault = &faultList[fault];
+    if (fault < CFG_FAULT_HISTORY_SIZE) {
+        *outFault = faultList[fault];
         return true;
     }
     return false;
 }
 
+/*
+ * Find the n-th most recent un-acknowledged fault (0 = the most recent one, as used for OBD2 freeze frame numbers)
+ */
+int FaultHandler::getRecentFault(uint8_t number)
+{
+    for (int i = 0; i < CFG_FAULT_HISTORY_SIZE; i++) {
+        int faultnum = (faultWritePointer + CFG_FAULT_HISTORY_SIZE - 1 - i) % CFG_FAULT_HISTORY_SIZE;
+        if (!faultList[faultnum].ack && faultList[faultnum].device != 0xFFFF && number-- == 0) {
+            return faultnum;
+        }
+    }
+    return -1;
+}
+
 void FaultHandler::setFaultACK(uint16_t fault)
 {
-    if (fault > 0 && fault < CFG_FAULT_HISTORY_SIZE) {
+    if (fault < CFG_FAULT_HISTORY_SIZE && !faultList[fault].ack) {
+        removeFromIndex(fault);
         faultList[fault].ack = 1;
         writeFaultToEEPROM(fault);
     }
@@ -207,10 +437,94 @@ void FaultHandler::setFaultACK(uint16_t fault)
 
 void FaultHandler::setFaultOngoing(uint16_t fault, bool ongoing)
 {
-    if (fault > 0 && fault < CFG_FAULT_HISTORY_SIZE) {
+    if (fault < CFG_FAULT_HISTORY_SIZE) {
         faultList[fault].ongoing = ongoing;
         writeFaultToEEPROM(fault);
     }
 }
 
+/*
+ * Collect the codes of all un-acknowledged faults (or only the ongoing ones) starting with the most recent.
+ * The fault codes are already in SAE DTC format (see FaultCodes.h) so they can be reported via OBD2 as they are.
+ * A code raised several times (or by several devices) is reported only once.
+ * Returns the number of codes stored in the array.
+ */
+uint8_t FaultHandler::getDiagnosticTroubleCodes(uint16_t *codes, uint8_t maxCodes, bool ongoingOnly)
+{
+    uint8_t count = 0;
+
+    for (int i = 0; i < CFG_FAULT_HISTORY_SIZE && count < maxCodes; i++) {
+        FAULT *fault = &faultList[(faultWritePointer + CFG_FAULT_HISTORY_SIZE - 1 - i) % CFG_FAULT_HISTORY_SIZE];
+        if (fault->ack || fault->device == 0xFFFF || fault->faultCode == FAULT_NONE || (ongoingOnly && !fault->ongoing)) {
+            continue;
+        }
+
+        bool duplicate = false;
+        for (int j = 0; j < count; j++) {
+            if (codes[j] == fault->faultCode) {
+                duplicate = true;
+                break;
+            }
+        }
+        if (!duplicate) {
+            codes[count++] = fault->faultCode;
+        }
+    }
+    return count;
+}
+
+bool FaultHandler::isFaultOngoing()
+{
+    for (int i = 0; i < CFG_FAULT_HISTORY_SIZE; i++) {
+        if (faultList[i].ongoing && !faultList[i].ack && faultList[i].device != 0xFFFF) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Acknowledge all faults. Instead of writing each modified record separately, the whole list
+ * is written to the cache in one go and the pages are aged so they're flushed with the next tick.
+ */
+void FaultHandler::clearFaults()
+{
+    for (int i = 0; i < CFG_FAULT_HISTORY_SIZE; i++) {
+        faultList[i].ack = true;
+        faultList[i].ongoing = false;
+    }
+    faultReadPointer = faultWritePointer;
+    memset(indexHead, FAULT_INDEX_NONE, sizeof(indexHead));
+    memset(dirty, 0, sizeof(dirty));
+    dirtyFaults = false;
+
+    memCache.Write(EE_FAULT_LOG + EEFAULT_READPTR, faultReadPointer);
+    memCache.Write(EE_FAULT_LOG + EEFAULT_WRITEPTR, faultWritePointer);
+    memCache.Write(EE_FAULT_LOG + EEFAULT_FAULTS_START, faultList, sizeof(faultList));
+    for (uint32_t address = EE_FAULT_LOG; address < EE_FAULT_LOG + EEFAULT_FAULTS_START + sizeof(faultList); address += 256) {
+        memCache.AgeFullyAddress(address);
+    }
+    logger.info("All faults cleared");
+}
+
+void FaultHandler::printFaults()
+{
+    char buffer[LOG_BUFFER_SIZE];
+    int faultnum;
+
+    logger.console("Un-acknowledged faults (most recent first):");
+    for (uint8_t number = 0; (faultnum = getRecentFault(number)) != -1; number++) {
+        FAULT *fault = &faultList[faultnum];
+        logger.console("#%d: fault %#x by device %#x, %d times, first at %d, last at %d%s", faultnum, fault->faultCode, fault->device,
+                fault->occurrences, fault->timeStamp, fault->lastTimeStamp, (fault->ongoing ? ", ongoing" : ""));
+
+        int length = 0;
+        for (uint8_t i = 0; i < CFG_FREEZE_FRAME_SIZE && length < LOG_BUFFER_SIZE; i++) {
+            length += snprintf(buffer + length, LOG_BUFFER_SIZE - length, " %s=%d", getFreezeFrameValueName(freezeFrameValues[i]),
+                    fault->freezeFrame.values[i]);
+        }
+        logger.console("   %s", buffer);
+    }
+}
+
 FaultHandler faultHandler;
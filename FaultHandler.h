@@ -37,16 +37,45 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Logger.h"
 #include "FaultCodes.h"
 #include "MemCache.h"
+#include "RecordStore.h"
+
+#define FAULT_INDEX_NONE 0xFF //end of a chain in the fault index
+
+//values which can be captured in a freeze frame (the selection is defined by CFG_FREEZE_FRAME_VALUES)
+enum FreezeFrameValue {
+  FF_SYSTEM_STATE, //Status::SystemState
+  FF_THROTTLE, //0.1%
+  FF_TORQUE_REQUESTED, //0.1Nm
+  FF_TORQUE_ACTUAL, //0.1Nm
+  FF_SPEED_ACTUAL, //rpm
+  FF_DC_VOLTAGE, //0.1V (from BMS if available)
+  FF_DC_CURRENT, //0.1A (from BMS if available)
+  FF_AC_CURRENT, //0.1A
+  FF_TEMPERATURE_MOTOR, //0.1C
+  FF_TEMPERATURE_CONTROLLER, //0.1C
+  FF_TEMPERATURE_COOLANT, //0.1C
+  FF_SOC, //0.5%
+  FF_LOWEST_CELL_VOLTS, //mV
+  FF_HIGHEST_CELL_VOLTS //mV
+};
+
+//snapshot of the system values at the time a fault was raised first
+typedef struct {
+  int16_t values[CFG_FREEZE_FRAME_SIZE]; //in the order of CFG_FREEZE_FRAME_VALUES
+} FREEZE_FRAME;
 
 //structure to use for storing and retrieving faults.
 //Stores the info a fault record will contain.
 typedef struct {
-  uint32_t timeStamp; //number of 
+  uint32_t timeStamp; //runtime (in tenths of seconds) when the fault occurred first
   uint16_t device; //which device is generating this fault
   uint16_t faultCode; //set by the device itself. There is a universal list of codes
+  uint32_t lastTimeStamp; //runtime (in tenths of seconds) when the fault was raised the last time
+  uint16_t occurrences; //how many times the fault was raised while it was un-ack'd (saturates at 0xFFFF)
   uint8_t ack : 1; ////whether this fault has been acknowledged or not 1 = ack'd 
   uint8_t ongoing : 1; //whether fault still seems to be happening currently 1 = still going on
-} FAULT; //should be 9 bytes because the bottom two are bit fields in a single byte
+  FREEZE_FRAME freezeFrame; //values at the time of the first occurrence
+} FAULT; //16 bytes incl. padding + freeze frame
 
 
 class FaultHandler : public TickObserver {
@@ -58,23 +87,44 @@ class FaultHandler : public TickObserver {
   void cancelOngoingFault(uint16_t device, uint16_t code); //if this fault was registered as ongoing then cancel it (set not ongoing) otherwise do nothing
   bool getNextFault(FAULT*); //get the next un-ack'd fault. Will also get first fault if the first call and you forgot to call getFirstFault
   bool getFault(uint16_t fault, FAULT*);
+  int getRecentFault(uint8_t number); //get the fault # of the n-th most recent un-ack'd fault, -1 if there is none
   uint16_t getFaultCount();
+  uint32_t getRuntime(); //total runtime of the system in 0.1s (across all start ups)
   void handleTick();
   void setup();
 
   void setFaultACK(uint16_t fault); //acknowledge the fault # - returns fault # if successful (0xFFFF otherwise)
   void setFaultOngoing(uint16_t fault, bool ongoing); //set value of ongoing flag - returns fault # on success
+  uint8_t getDiagnosticTroubleCodes(uint16_t *codes, uint8_t maxCodes, bool ongoingOnly); //get the distinct codes of un-ack'd faults (OBD2 mode 03/07)
+  bool isFaultOngoing(); //is any un-ack'd fault still going on (used for the malfunction indicator)
+  void clearFaults(); //acknowledge all faults with a single write of the fault list (OBD2 mode 04)
+  void printFaults(); //list the un-ack'd faults with their freeze frames on the console
+  static FreezeFrameValue getFreezeFrameValue(uint8_t index); //which value is stored at an index of the freeze frame
+  static const char *getFreezeFrameValueName(FreezeFrameValue value);
   
   private:
   void loadFromEEPROM();
   void saveToEEPROM();
   void writeFaultToEEPROM(int faultnum);
+  void writeDirtyFaults();
+  uint8_t getIndexSlot(uint16_t device, uint16_t code);
+  int findFault(uint16_t device, uint16_t code);
+  void addToIndex(uint8_t faultnum);
+  void removeFromIndex(uint8_t faultnum);
+  void rebuildIndex();
+  void captureFreezeFrame(FREEZE_FRAME *frame);
+
+  static const FreezeFrameValue freezeFrameValues[CFG_FREEZE_FRAME_SIZE];
 
   uint16_t  faultWritePointer; //fault # we're up to for writing. Location in EEPROM is start + (fault_ptr * sizeof(FAULT))
   uint16_t  faultReadPointer;  //fault # we're at when reading.
   FAULT faultList[CFG_FAULT_HISTORY_SIZE]; //store up to 50 faults for a long history. 50*9 = 450 bytes of EEPROM
   uint32_t globalTime; //how long the unit has been running in total (across all start ups).
   uint32_t baseTime; //the time loaded at system start up. millis() / 100 is added to this to get the above time
+  uint8_t indexHead[CFG_FAULT_INDEX_SIZE]; //first un-ack'd fault per hash of (device, code), FAULT_INDEX_NONE = empty
+  uint8_t indexNext[CFG_FAULT_HISTORY_SIZE]; //next un-ack'd fault with the same hash
+  uint8_t dirty[(CFG_FAULT_HISTORY_SIZE + 7) / 8]; //bitmask of faults which were modified but not written to the cache yet
+  bool dirtyFaults; //at least one bit in dirty is set
 };
 
 extern FaultHandler faultHandler;
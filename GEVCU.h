@@ -48,13 +48,19 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "SystemIO.h"
 #include "CanHandler.h"
 #include "MemCache.h"
+#include "RecordStore.h"
+#include "SystemLog.h"
 #include "ThrottleDetector.h"
 #include "DeviceManager.h"
 #include "SerialConsole.h"
+#include "SerialBuffer.h"
 #include "ELM327_Emu.h"
 #include "Sys_Messages.h"
 #include "PerfTimer.h"
+#include "BootTimeline.h"
+#include "MemoryMonitor.h"
 #include "CodaMotorController.h"
+#include "CanOpenMotorController.h"
 #include "FaultHandler.h"
 #include "CanIO.h"
 #include "CanOBD2.h"
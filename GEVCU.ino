@@ -50,6 +50,7 @@ void createDevices()
     deviceManager.addDevice(new DmocMotorController());
     deviceManager.addDevice(new CodaMotorController());
     deviceManager.addDevice(new BrusaDMC5());
+    deviceManager.addDevice(new CanOpenMotorController());
     deviceManager.addDevice(new BrusaBSC6());
     deviceManager.addDevice(new BrusaNLG5());
     deviceManager.addDevice(new ThinkBatteryManager());
@@ -62,6 +63,28 @@ void createDevices()
     deviceManager.addDevice(new StatusIndicator());
 }
 
+/*
+ * Load the device table, the fault log and the configuration of all enabled devices
+ * into the cache in sequential bursts before the fault handler and the devices read them.
+ */
+void prefetchConfiguration()
+{
+    uint32_t start = micros();
+    uint16_t id;
+    uint8_t count;
+
+    count = memCache.Prefetch(EE_DEVICE_TABLE, (EE_NUM_DEVICES + 1) * 2);
+    count += memCache.Prefetch(EE_FAULT_LOG, EEFAULT_FAULTS_START + sizeof(FAULT) * CFG_FAULT_HISTORY_SIZE);
+
+    for (int pos = 1; pos <= EE_NUM_DEVICES; pos++) {
+        memCache.Read(EE_DEVICE_TABLE + (2 * pos), &id);
+        if (id & 0x8000) { // only enabled devices load their configuration
+            count += PrefHandler::prefetch(pos);
+        }
+    }
+    logger.info("startup: prefetched %d EEPROM pages in %dus", count, micros() - start);
+}
+
 void delayStart(uint8_t seconds) {
     for (int i = seconds; i > 0; i--) {
         SerialUSB.println(i);
@@ -78,12 +101,24 @@ void setup()
     // resets CPU when power drops below 2.8V --> give the EEPROM enough time to finish an ongoing write at power-down
     SUPC->SUPC_SMMR = 0xA | (1<<8) | (1<<12);
 
+    memoryMonitor.setup(); // early, so the stack usage of the start-up is measured
+    bootTimeline.phase("memCache.setup");
     memCache.setup();
+    bootTimeline.phase("recordStore.setup");
+    recordStore.setup();
+    bootTimeline.phase("systemLog.setup");
+    systemLog.setup();
+    bootTimeline.phase("prefetchConfiguration");
+    prefetchConfiguration();
+    bootTimeline.phase("faultHandler.setup");
     faultHandler.setup();
+    bootTimeline.phase("systemIO.setup");
     systemIO.setup();
+    bootTimeline.phase("canHandler.setup");
     canHandlerEv.setup();
     canHandlerCar.setup();
 
+    bootTimeline.phase("createDevices");
     createDevices();
     /*
      *  We defer setting up the devices until here. This allows all objects to be instantiated
@@ -91,7 +126,12 @@ void setup()
      *  out there as they initialize. For instance, a motor controller could see if a BMS
      *  exists and supports a function that the motor controller wants to access.
      */
+    bootTimeline.phase("init devices");
     status.setSystemState(Status::init);
+    OBD2Handler::getInstance()->setup();
+    bootTimeline.phase(NULL);
+    logger.info("startup: %dms from reset to init (%d EEPROM pages read, %dus stalled by EEPROM access)", millis(),
+            memCache.getByteReadCount() / 256, memCache.getStallTime());
 
     // if no dcdc converter is enabled, set status to true to keep high power devices running
     if (deviceManager.getDcDcConverter() == NULL) {
@@ -103,7 +143,9 @@ void setup()
     wifiDevice = deviceManager.getDeviceByType(DEVICE_WIFI);
     btDevice = deviceManager.getDeviceByID(ELM327EMU);
 
+    bootTimeline.phase("preCharge");
     status.setSystemState(Status::preCharge);
+    bootTimeline.phase(NULL);
 
 #ifdef CFG_EFFICIENCY_CALCS
 	mainLoopTimer = new PerfTimer();
@@ -128,6 +170,10 @@ void loop()
     canHandlerCar.process();
 
     serialConsole.loop();
+    logger.process();
+    if (SerialUSB) { // only send if a host opened the port, otherwise the buffer just overwrites its oldest output
+        serialOutput.process();
+    }
 
     //TODO: this is dumb... shouldn't have to manually do this. Devices should be able to register loop functions
     if (wifiDevice != NULL) {
@@ -60,10 +60,10 @@ bool Heartbeat::getThrottleDebug()
 
 void Heartbeat::handleTick()
 {
-    SerialUSB.print('.');
+    serialOutput.print('.');
 
     if ((++dotCount % 80) == 0) {
-        SerialUSB.println();
+        serialOutput.println();
     }
 
     lastTickTime = millis();
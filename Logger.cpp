@@ -27,16 +27,29 @@
 #include "Logger.h"
 #include "Device.h"
 #include "DeviceManager.h"
+#include "SystemLog.h"
 
 Logger logger;
 
 Logger::Logger() {
     logLevel = CFG_DEFAULT_LOGLEVEL;
     debugging = false;
-    deviceLoglevel = new Logger::LogLevel[deviceIdsSize];
     lastMsgRepeated = 0;
     repeatStart = 0;
-    historyPtr = 0;
+    historyHead = 0;
+    historyTail = 0;
+    historyLast = 0;
+    historyCount = 0;
+    deferred = CFG_LOG_DEFERRED;
+    deferredHead = 0;
+    deferredTail = 0;
+    deferredDropped = 0;
+    deferredTextHead = 0;
+    deferredTextTail = 0;
+    memset(formatCache, 0, sizeof(formatCache));
+    memset(rateLimits, 0, sizeof(rateLimits));
+    rateSuppressed = 0;
+    lastRateSummary = 0;
 }
 
 /*
@@ -44,15 +57,15 @@ Logger::Logger() {
  * printf() style, see Logger::log()
  *
  */
-void Logger::debug(String message, ...)
+void Logger::debug(const char *message, ...)
 {
-    if (logLevel > Debug) {
+    if (CFG_LOG_MIN_LEVEL > Debug || logLevel > Debug) {
         return;
     }
 
     va_list args;
     va_start(args, message);
-    log("", Debug, message, args);
+    log(NULL, Debug, message, args);
     va_end(args);
 }
 
@@ -60,15 +73,15 @@ void Logger::debug(String message, ...)
  * Output a debug message with the name of a device appended before the message
  * printf() style, see Logger::log()
  */
-void Logger::debug(Device *device, String message, ...)
+void Logger::debug(Device *device, const char *message, ...)
 {
-    if (getLogLevel(device) > Debug) {
+    if (CFG_LOG_MIN_LEVEL > Debug || getLogLevel(device) > Debug) {
         return;
     }
 
     va_list args;
     va_start(args, message);
-    log(device->getCommonName(), Debug, message, args);
+    log(device, Debug, message, args);
     va_end(args);
 }
 
@@ -76,15 +89,15 @@ void Logger::debug(Device *device, String message, ...)
  * Output a info message with a variable amount of parameters
  * printf() style, see Logger::log()
  */
-void Logger::info(String message, ...)
+void Logger::info(const char *message, ...)
 {
-    if (logLevel > Info) {
+    if (CFG_LOG_MIN_LEVEL > Info || logLevel > Info) {
         return;
     }
 
     va_list args;
     va_start(args, message);
-    log("", Info, message, args);
+    log(NULL, Info, message, args);
     va_end(args);
 }
 
@@ -92,15 +105,15 @@ void Logger::info(String message, ...)
  * Output a info message with the name of a device appended before the message
  * printf() style, see Logger::log()
  */
-void Logger::info(Device *device, String message, ...)
+void Logger::info(Device *device, const char *message, ...)
 {
-    if (getLogLevel(device) > Info) {
+    if (CFG_LOG_MIN_LEVEL > Info || getLogLevel(device) > Info) {
         return;
     }
 
     va_list args;
     va_start(args, message);
-    Logger::log(device->getCommonName(), Info, message, args);
+    log(device, Info, message, args);
     va_end(args);
 }
 
@@ -108,15 +121,15 @@ void Logger::info(Device *device, String message, ...)
  * Output a warning message with a variable amount of parameters
  * printf() style, see Logger::log()
  */
-void Logger::warn(String message, ...)
+void Logger::warn(const char *message, ...)
 {
-    if (logLevel > Warn) {
+    if (CFG_LOG_MIN_LEVEL > Warn || logLevel > Warn) {
         return;
     }
 
     va_list args;
     va_start(args, message);
-    log("", Warn, message, args);
+    log(NULL, Warn, message, args);
     va_end(args);
 }
 
@@ -124,15 +137,15 @@ void Logger::warn(String message, ...)
  * Output a warning message with the name of a device appended before the message
  * printf() style, see Logger::log()
  */
-void Logger::warn(Device *device, String message, ...)
+void Logger::warn(Device *device, const char *message, ...)
 {
-    if (getLogLevel(device) > Warn) {
+    if (CFG_LOG_MIN_LEVEL > Warn || getLogLevel(device) > Warn) {
         return;
     }
 
     va_list args;
     va_start(args, message);
-    log(device->getCommonName(), Warn, message, args);
+    log(device, Warn, message, args);
     va_end(args);
 }
 
@@ -140,15 +153,15 @@ void Logger::warn(Device *device, String message, ...)
  * Output a error message with a variable amount of parameters
  * printf() style, see Logger::log()
  */
-void Logger::error(String message, ...)
+void Logger::error(const char *message, ...)
 {
-    if (logLevel > Error) {
+    if (CFG_LOG_MIN_LEVEL > Error || logLevel > Error) {
         return;
     }
 
     va_list args;
     va_start(args, message);
-    log("", Error, message, args);
+    log(NULL, Error, message, args);
     va_end(args);
 }
 
@@ -156,15 +169,15 @@ void Logger::error(String message, ...)
  * Output a error message with the name of a device appended before the message
  * printf() style, see Logger::log()
  */
-void Logger::error(Device *device, String message, ...)
+void Logger::error(Device *device, const char *message, ...)
 {
-    if (getLogLevel(device) > Error) {
+    if (CFG_LOG_MIN_LEVEL > Error || getLogLevel(device) > Error) {
         return;
     }
 
     va_list args;
     va_start(args, message);
-    log(device->getCommonName(), Error, message, args);
+    log(device, Error, message, args);
     va_end(args);
 }
 
@@ -177,7 +190,7 @@ void Logger::console(String message, ...)
     va_list args;
     va_start(args, message);
     vsnprintf(msgBuffer, LOG_BUFFER_SIZE, message.c_str(), args);
-    SerialUSB.println(msgBuffer);
+    serialOutput.println(msgBuffer);
     va_end(args);
 }
 
@@ -188,27 +201,18 @@ void Logger::console(String message, ...)
 void Logger::setLoglevel(LogLevel level)
 {
     logLevel = level;
-    for (int deviceEntry = 0; deviceEntry < deviceIdsSize; deviceEntry ++) {
-		deviceLoglevel[deviceEntry] = level;
-    }
+    deviceManager.setLogLevel(level);
     debugging = (level == Debug);
 }
 
 /*
- * Set the log level for a specific device. If one device has Debugging loglevel set, also set the
- * debugging flag (for faster evaluation in isDebug()).
+ * Set the log level for a specific device. The debugging flag (for faster evaluation in isDebug())
+ * stays set as long as the global level or any device is at Debug.
  */
 void Logger::setLoglevel(Device *device, LogLevel level)
 {
-	debugging = false;
-    for (int deviceEntry = 0; deviceEntry < deviceIdsSize; deviceEntry ++) {
-    	if (deviceIds[deviceEntry] == device->getId()) {
-    		deviceLoglevel[deviceEntry] = level;
-    	}
-    	if (deviceLoglevel[deviceEntry] == Debug) {
-    		debugging = true;
-    	}
-    }
+    device->setLogLevel(level);
+    debugging = (level == Debug || logLevel == Debug || deviceManager.isAnyDeviceAtLogLevel(Debug));
 }
 /*
  * Retrieve the current log level.
@@ -223,12 +227,7 @@ Logger::LogLevel Logger::getLogLevel()
  */
 Logger::LogLevel Logger::getLogLevel(Device *device)
 {
-    for (int deviceEntry = 0; deviceEntry < deviceIdsSize; deviceEntry ++) {
-    	if (deviceIds[deviceEntry] == device->getId()) {
-    		return deviceLoglevel[deviceEntry];
-    	}
-    }
-    return logLevel;
+    return (device ? device->getLogLevel() : logLevel);
 }
 
 /*
@@ -247,34 +246,410 @@ boolean Logger::isDebug()
 }
 
 /*
- * Output a log message (called by debug(), info(), warn(), error(), console())
+ * Output a log message (called by debug(), info(), warn(), error())
+ * In deferred mode the message is queued unformatted if possible and output later by process().
+ * Messages which have to be formatted right away are queued as text while others are pending.
+ */
+void Logger::log(Device *device, LogLevel level, const char *format, va_list args)
+{
+    if (isRateLimited(format)) {
+        return;
+    }
+    if (level >= CFG_SYSLOG_LEVEL) {
+        va_list copy;
+        va_copy(copy, args);
+        systemLog.add((device ? device->getId() : NEW), level, format, (LOG_IS_CONSTANT(format) ? getArgCount(format) : LOG_NOT_DEFERRABLE), copy);
+        va_end(copy);
+    }
+    if (deferred && defer(device, level, format, args)) {
+        return;
+    }
+
+    vsnprintf(msgBuffer, LOG_BUFFER_SIZE, format, args);
+    if (deferredTail != deferredHead) { // queue it behind the pending messages to keep the order
+        deferText(device, level, msgBuffer);
+        return;
+    }
+    output(device, level, msgBuffer, millis());
+}
+
+/*
+ * Token bucket rate limiting per call site: each format string may log CFG_LOG_RATE_BURST messages
+ * in a row, afterwards one message per CFG_LOG_RATE_REFILL_TIME. This is checked before anything is
+ * formatted so a flood of messages can't eat the loop time. Formats in the RAM (e.g. buffers)
+ * don't identify a call site and are never limited.
+ */
+bool Logger::isRateLimited(const char *format)
+{
+    if (!LOG_IS_CONSTANT(format)) {
+        return false;
+    }
+
+    uint32_t now = millis();
+    RateLimit *rate = findRateLimit(format, now);
+    rate->lastUsed = now;
+
+    uint32_t refill = (now - rate->lastRefill) / CFG_LOG_RATE_REFILL_TIME;
+    if (refill > 0) {
+        rate->tokens = min(rate->tokens + refill, (uint32_t) CFG_LOG_RATE_BURST);
+        rate->lastRefill += refill * CFG_LOG_RATE_REFILL_TIME;
+    }
+
+    if (rate->tokens == 0) {
+        rate->suppressed++;
+        return true;
+    }
+    rate->tokens--;
+    return false;
+}
+
+/*
+ * Find the bucket of a call site in its set. If it's not there, an unused or the least recently
+ * used bucket of the set is taken over. The tokens of the evicted call site are kept (and refilled
+ * by the elapsed time), so call sites which push each other out can't log a fresh burst every time.
+ */
+Logger::RateLimit *Logger::findRateLimit(const char *format, uint32_t now)
+{
+    RateLimit *set = &rateLimits[(((uintptr_t) format >> 2) * CFG_LOG_RATE_WAYS) & (CFG_LOG_RATE_SLOTS - 1)];
+    RateLimit *victim = set;
+
+    for (uint8_t i = 0; i < CFG_LOG_RATE_WAYS; i++) {
+        if (set[i].format == format) {
+            return &set[i];
+        }
+        if (set[i].format == NULL) {
+            victim = &set[i];
+            victim->lastRefill = now;
+            victim->tokens = CFG_LOG_RATE_BURST;
+            break; // the slots of a set are filled in order, the call site can't come after an empty one
+        }
+        if ((now - set[i].lastUsed) > (now - victim->lastUsed)) {
+            victim = &set[i];
+        }
+    }
+
+    rateSuppressed += victim->suppressed; // keep the count of the evicted call site for the summary
+    victim->format = format;
+    victim->suppressed = 0;
+    return victim;
+}
+
+/*
+ * Output how many messages were suppressed per call site since the last summary
+ */
+void Logger::summarizeSuppressed()
+{
+    lastRateSummary = millis();
+    for (uint8_t i = 0; i < CFG_LOG_RATE_SLOTS; i++) {
+        if (rateLimits[i].suppressed > 0) {
+            snprintf(msgBuffer, LOG_BUFFER_SIZE, "%d messages suppressed: %s", rateLimits[i].suppressed, rateLimits[i].format);
+            rateLimits[i].suppressed = 0;
+            output(NULL, Warn, msgBuffer, lastRateSummary);
+        }
+    }
+    if (rateSuppressed > 0) {
+        snprintf(msgBuffer, LOG_BUFFER_SIZE, "%d messages suppressed", rateSuppressed);
+        rateSuppressed = 0;
+        output(NULL, Warn, msgBuffer, lastRateSummary);
+    }
+}
+
+/*
+ * Queue a message with the format pointer and the raw argument words. This only works for
+ * formats which are string literals and contain only integer/char/pointer conversions (no %s
+ * whose argument might be gone when the message is formatted, no %f which takes two words with
+ * alignment), otherwise false is returned and the message has to be formatted right away.
  */
-void Logger::log(String deviceName, LogLevel level, String format, va_list args)
+bool Logger::defer(Device *device, LogLevel level, const char *format, va_list args)
 {
-    vsnprintf(msgBuffer, LOG_BUFFER_SIZE, format.c_str(), args);
-    LogEntry logEntry = createLogEntry(level, deviceName, String(msgBuffer));
+    if (!LOG_IS_CONSTANT(format)) {
+        return false;
+    }
+    uint8_t argCount = getArgCount(format);
+    if (argCount == LOG_NOT_DEFERRABLE) {
+        return false;
+    }
 
-    logToPrinter(SerialUSB, logEntry);
-    logToWifi(logEntry);
+    DeferredEntry *entry = allocateEntry();
+    if (entry == NULL) {
+        return true;
+    }
+    entry->format = format;
+    entry->device = device;
+    entry->level = level;
+    for (uint8_t i = 0; i < argCount; i++) {
+        entry->args[i] = va_arg(args, uint32_t);
+    }
+    deferredHead = (deferredHead + 1) % CFG_LOG_DEFERRED_SIZE;
+    return true;
 }
 
-Logger::LogEntry &Logger::createLogEntry(Logger::LogLevel level, String deviceName, String message)
+/*
+ * Queue an already formatted message behind the pending deferred ones. The text is stored in
+ * one piece in deferredText, if it doesn't fit at the end, it's written at the beginning.
+ * Returns false if the message was dropped because the queue or the text buffer is full.
+ */
+bool Logger::deferText(Device *device, LogLevel level, const char *message)
 {
-    LogEntry &entry = history[historyPtr++];
+    uint16_t length = strlen(message) + 1;
 
-    if (historyPtr > HISTORY_SIZE - 1) {
-        historyPtr = 0;
+    if (deferredTextHead == deferredTextTail) {
+        deferredTextHead = deferredTextTail = 0; // no text queued, start at the beginning
+    }
+    uint16_t start = deferredTextHead;
+
+    if (deferredTextHead >= deferredTextTail) {
+        if (start + length >= CFG_LOG_DEFERRED_TEXT_SIZE) {
+            start = 0; // the rest at the end is skipped when the entry is processed
+            if (length >= deferredTextTail) {
+                deferredDropped++;
+                return false;
+            }
+        }
+    } else if (start + length >= deferredTextTail) {
+        deferredDropped++;
+        return false;
     }
 
-    entry.time = millis();
-    entry.level = level;
-    entry.deviceName = deviceName;
-    entry.message = message;
+    DeferredEntry *entry = allocateEntry();
+    if (entry == NULL) {
+        return false;
+    }
+    memcpy(&deferredText[start], message, length);
+    entry->format = NULL;
+    entry->device = device;
+    entry->level = level;
+    entry->args[0] = start;
+    entry->args[1] = start + length;
+    deferredTextHead = start + length;
+    deferredHead = (deferredHead + 1) % CFG_LOG_DEFERRED_SIZE;
+    return true;
+}
 
+/*
+ * Get the next free entry of the deferred queue with the time set or NULL (and count the
+ * dropped message) if the queue is full. The entry is only added by advancing deferredHead.
+ */
+Logger::DeferredEntry *Logger::allocateEntry()
+{
+    if ((deferredHead + 1) % CFG_LOG_DEFERRED_SIZE == deferredTail) {
+        deferredDropped++;
+        return NULL;
+    }
+    DeferredEntry *entry = &deferredQueue[deferredHead];
+    entry->time = millis();
     return entry;
 }
 
-String Logger::logLevelToString(Logger::LogLevel level)
+/*
+ * Get the number of argument words of a format from the cache or analyze it
+ */
+uint8_t Logger::getArgCount(const char *format)
+{
+    uint8_t index = ((uintptr_t) format >> 2) & (CFG_LOG_FORMAT_CACHE_SIZE - 1);
+
+    if (formatCache[index] != format) {
+        formatArgCount[index] = analyzeFormat(format);
+        formatCache[index] = format;
+    }
+    return formatArgCount[index];
+}
+
+/*
+ * Count the argument words of a format string, returns LOG_NOT_DEFERRABLE if it contains
+ * conversions which can't be deferred or too many arguments.
+ */
+uint8_t Logger::analyzeFormat(const char *format)
+{
+    uint8_t count = 0;
+
+    while ((format = strchr(format, '%')) != NULL) {
+        format++;
+        if (*format == '%') {
+            format++;
+            continue;
+        }
+        while (*format != 0 && strchr("-+ #0123456789.*hlzjt", *format) != NULL) {
+            if (*format == '*') {
+                count++;
+            }
+            if (*format == 'l' && format[1] == 'l') {
+                return LOG_NOT_DEFERRABLE; // 64 bit values
+            }
+            format++;
+        }
+        if (*format == 0 || strchr("diouxXcp", *format) == NULL) {
+            return LOG_NOT_DEFERRABLE;
+        }
+        count++;
+    }
+    return (count > CFG_LOG_DEFERRED_MAX_ARGS ? LOG_NOT_DEFERRABLE : count);
+}
+
+/*
+ * Format and output queued messages, called from the main loop. Only a few messages are processed
+ * per call so the loop isn't blocked by the serial output.
+ */
+void Logger::process()
+{
+    for (uint8_t i = 0; i < CFG_LOG_DEFERRED_PER_LOOP && deferredTail != deferredHead; i++) {
+        DeferredEntry *entry = &deferredQueue[deferredTail];
+        if (entry->format == NULL) {
+            output(entry->device, entry->level, &deferredText[entry->args[0]], entry->time);
+            deferredTextTail = entry->args[1];
+        } else {
+            snprintf(msgBuffer, LOG_BUFFER_SIZE, entry->format, entry->args[0], entry->args[1], entry->args[2], entry->args[3],
+                    entry->args[4], entry->args[5]);
+            output(entry->device, entry->level, msgBuffer, entry->time);
+        }
+        deferredTail = (deferredTail + 1) % CFG_LOG_DEFERRED_SIZE;
+    }
+    if (deferredDropped > 0 && deferredTail == deferredHead) {
+        snprintf(msgBuffer, LOG_BUFFER_SIZE, "%d log messages dropped", deferredDropped);
+        deferredDropped = 0;
+        output(NULL, Warn, msgBuffer, millis());
+    }
+    if (deferredTail == deferredHead && (millis() - lastRateSummary) > CFG_LOG_RATE_SUMMARY_TIME) {
+        summarizeSuppressed();
+    }
+}
+
+/*
+ * Output all queued messages
+ */
+void Logger::outputDeferred()
+{
+    while (deferredTail != deferredHead || deferredDropped > 0) {
+        process();
+    }
+}
+
+/*
+ * Store a formatted message in the history and send it to the serial port and wifi
+ */
+void Logger::output(Device *device, LogLevel level, const char *message, uint32_t time)
+{
+    bool repeated = isRepeated(message); // compare before the new record becomes the newest one
+    LogRecord *record = addRecord((device ? device->getId() : NEW), level, message, time);
+
+    logToPrinter(serialOutput, record);
+    if (level > Debug) {
+        if (repeated && (repeatStart == 0 || (repeatStart + CFG_LOG_REPEAT_MSG_TIME) > millis())) {
+            if (lastMsgRepeated == 0) {
+                repeatStart = millis();
+            }
+            lastMsgRepeated++;
+        } else {
+            logToWifi(record);
+        }
+    }
+}
+
+/*
+ * Enable/disable the deferred formatting of log messages
+ */
+void Logger::setDeferred(bool enable)
+{
+    if (!enable) {
+        outputDeferred();
+    }
+    deferred = enable;
+}
+
+bool Logger::isDeferred()
+{
+    return deferred;
+}
+
+/*
+ * Append a message to the history arena, the oldest records are evicted until there is enough
+ * space. A record is never split: if it doesn't fit at the end of the arena, the rest of the arena
+ * is marked with a wrap record and the message is written at the beginning.
+ */
+Logger::LogRecord *Logger::addRecord(DeviceId deviceId, LogLevel level, const char *message, uint32_t time)
+{
+    uint16_t length = min(strlen(message) + 1, (size_t) LOG_BUFFER_SIZE);
+    uint16_t size = (sizeof(LogRecord) + length + 3) & ~3;
+
+    if (historyHead + size > CFG_LOG_HISTORY_ARENA_SIZE) {
+        while (historyCount > 0 && historyTail >= historyHead) { // the records behind the head are lost
+            evictRecord();
+        }
+        if (historyHead + sizeof(LogRecord) <= CFG_LOG_HISTORY_ARENA_SIZE) {
+            ((LogRecord *) &historyArena[historyHead])->level = LOG_RECORD_WRAP;
+        }
+        historyHead = 0;
+    }
+    while (historyCount > 0 && historyTail >= historyHead && historyTail < historyHead + size) {
+        evictRecord();
+    }
+    if (historyCount == 0) {
+        historyTail = historyHead;
+    }
+
+    LogRecord *record = (LogRecord *) &historyArena[historyHead];
+    record->time = time;
+    record->level = level;
+    record->length = length;
+    record->deviceId = deviceId;
+    memcpy(record + 1, message, length - 1);
+    ((char *) (record + 1))[length - 1] = 0;
+
+    historyLast = historyHead;
+    historyHead += size;
+    historyCount++;
+    return record;
+}
+
+/*
+ * Remove the oldest record from the history arena
+ */
+void Logger::evictRecord()
+{
+    LogRecord *record = (LogRecord *) &historyArena[historyTail];
+    historyTail = wrapOffset(historyTail + ((sizeof(LogRecord) + record->length + 3) & ~3));
+    historyCount--;
+}
+
+/*
+ * Returns the offset of the next record, wraps to the beginning if the end of
+ * the arena or a wrap record is reached
+ */
+uint16_t Logger::wrapOffset(uint16_t offset)
+{
+    if (offset + sizeof(LogRecord) > CFG_LOG_HISTORY_ARENA_SIZE || ((LogRecord *) &historyArena[offset])->level == LOG_RECORD_WRAP) {
+        return 0;
+    }
+    return offset;
+}
+
+/*
+ * Is the message identical to the newest message in the history
+ */
+bool Logger::isRepeated(const char *message)
+{
+    if (historyCount == 0) {
+        return false;
+    }
+    LogRecord *record = (LogRecord *) &historyArena[historyLast];
+    return strncmp((char *) (record + 1), message, LOG_BUFFER_SIZE - 1) == 0;
+}
+
+/*
+ * Find the common name of a device, NEW or an unknown device result in an empty string
+ */
+const char *Logger::getDeviceName(uint16_t deviceId)
+{
+    if (deviceId != NEW) {
+        Device *device = deviceManager.getDeviceByID((DeviceId) deviceId);
+        if (device) {
+            return device->getCommonName().c_str();
+        }
+    }
+    return "";
+}
+
+const char *Logger::logLevelToString(Logger::LogLevel level)
 {
     switch (level) {
         case Info:
@@ -289,53 +664,47 @@ String Logger::logLevelToString(Logger::LogLevel level)
     return "";
 }
 
-void Logger::logToPrinter(Print &printer, LogEntry &logEntry)
+void Logger::logToPrinter(Print &printer, LogRecord *record)
 {
-    printer.print(logEntry.time);
+    const char *deviceName = getDeviceName(record->deviceId);
+
+    printer.print(record->time);
     printer.print(" - ");
-    printer.print(logLevelToString(logEntry.level));
+    printer.print(logLevelToString((LogLevel) record->level));
     printer.print(": ");
-    if (logEntry.deviceName.length() > 0) {
-        printer.print(logEntry.deviceName);
+    if (deviceName[0] != 0) {
+        printer.print(deviceName);
         printer.print(" - ");
     }
-    printer.println(logEntry.message);
+    printer.println((char *) (record + 1));
 }
 
-void Logger::logToWifi(LogEntry &logEntry)
+void Logger::logToWifi(LogRecord *record)
 {
-    if (logEntry.level > Debug) {
-        LogEntry lastEntry = history[(historyPtr == 0 ? HISTORY_SIZE - 1 : historyPtr - 1)];
-        if (logEntry.message.equals(lastEntry.message) && (repeatStart == 0 || (repeatStart + CFG_LOG_REPEAT_MSG_TIME) > millis())) {
-            if (lastMsgRepeated == 0) {
-                repeatStart = millis();
-            }
-            lastMsgRepeated++;
-        } else {
-            if (lastMsgRepeated > 1) {
-                String info = String("Last message repeated ");
-                info.concat(lastMsgRepeated);
-                info.concat(" times");
-                String params[] = { "INFO", "", info };
-                deviceManager.sendMessage(DEVICE_WIFI, INVALID, MSG_LOG, params);
-                lastMsgRepeated = 0;
-                repeatStart = 0;
-            }
-
-            String params[] = { logLevelToString(logEntry.level), logEntry.deviceName, logEntry.message };
-            deviceManager.sendMessage(DEVICE_WIFI, INVALID, MSG_LOG, params);
-        }
+    if (lastMsgRepeated > 1) {
+        char info[40];
+        snprintf(info, sizeof(info), "Last message repeated %d times", lastMsgRepeated);
+        const char *params[] = { "INFO", "", info };
+        deviceManager.sendMessage(DEVICE_WIFI, INVALID, MSG_LOG, params);
     }
+    lastMsgRepeated = 0;
+    repeatStart = 0;
+
+    const char *params[] = { logLevelToString((LogLevel) record->level), getDeviceName(record->deviceId), (char *) (record + 1) };
+    deviceManager.sendMessage(DEVICE_WIFI, INVALID, MSG_LOG, params);
 }
 
+/*
+ * Print all messages of the history arena, oldest first
+ */
 void Logger::printHistory(Print &printer) {
     printer.println("LOG START");
-    for (uint16_t i = historyPtr; i < HISTORY_SIZE - 1 && history[i].time > 0; i++) {
-        logToPrinter(printer, history[i]);
-        handOff();
-    }
-    for (uint16_t i = 0; i < historyPtr; i++) {
-        logToPrinter(printer, history[i]);
+    uint16_t offset = historyTail;
+    for (uint16_t i = 0; i < historyCount; i++) {
+        offset = wrapOffset(offset);
+        LogRecord *record = (LogRecord *) &historyArena[offset];
+        logToPrinter(printer, record);
+        offset += (sizeof(LogRecord) + record->length + 3) & ~3;
         handOff();
     }
     printer.println("LOG END");
@@ -30,8 +30,24 @@
 #include <Arduino.h>
 #include "config.h"
 #include "DeviceTypes.h"
+#include "SerialBuffer.h"
 
-#define HISTORY_SIZE 100
+#define LOG_RECORD_WRAP 0xFF // level of a record which marks the end of the used part of the history arena
+#define LOG_NOT_DEFERRABLE 0xFF // argCount of a format which must be formatted right away (%s, %f, ...)
+
+/*
+ * Log a message of a device only if its log level is enabled. Below CFG_LOG_MIN_LEVEL the call is removed by
+ * the compiler, otherwise the arguments are only evaluated if the device's level permits the message.
+ * The device must not be NULL.
+ */
+#define LOG_ENABLED(device, level) ((level) >= CFG_LOG_MIN_LEVEL && (device)->getLogLevel() <= (level))
+#define LOG_DEBUG(device, ...) do { if (LOG_ENABLED(device, Logger::Debug)) logger.debug(device, __VA_ARGS__); } while (0)
+#define LOG_INFO(device, ...) do { if (LOG_ENABLED(device, Logger::Info)) logger.info(device, __VA_ARGS__); } while (0)
+#define LOG_WARN(device, ...) do { if (LOG_ENABLED(device, Logger::Warn)) logger.warn(device, __VA_ARGS__); } while (0)
+#define LOG_ERROR(device, ...) do { if (LOG_ENABLED(device, Logger::Error)) logger.error(device, __VA_ARGS__); } while (0)
+
+// string literals are located in the flash (below the SRAM at 0x20000000), their address stays valid
+#define LOG_IS_CONSTANT(pointer) ((uintptr_t) (pointer) < 0x20000000)
 
 class Device;
 
@@ -46,44 +62,100 @@ public:
         Error = 3,
         Off = 4
     };
-    struct LogEntry {
-        uint32_t time;
+    /*
+     * Header of a message in the history arena, followed by the message incl. the terminating zero.
+     * Records are padded to a multiple of 4 bytes so the header is always aligned.
+     */
+    struct LogRecord {
+        uint32_t time; // millis() when the message was logged
+        uint8_t level; // the LogLevel or LOG_RECORD_WRAP
+        uint8_t length; // length of the message incl. the terminating zero
+        uint16_t deviceId; // the DeviceId of the device which logged the message, NEW = none
+    };
+    /*
+     * A message which is stored unformatted, the format string and the raw argument words are
+     * only formatted later in process(). If format is NULL, the message was formatted right away
+     * and args[0]/args[1] hold its start/end offset in deferredText.
+     */
+    struct DeferredEntry {
+        uint32_t time; // millis() when the message was logged
+        const char *format; // the format string (a literal in the flash)
+        Device *device; // the device which logged the message, NULL = none
         LogLevel level;
-        String deviceName;
-        String message;
+        uint32_t args[CFG_LOG_DEFERRED_MAX_ARGS]; // the raw argument words
+    };
+    /*
+     * Token bucket of a call site, identified by the address of its format string
+     */
+    struct RateLimit {
+        const char *format; // the format string of the call site, NULL = unused
+        uint32_t lastRefill; // millis() when the last token was added
+        uint32_t lastUsed; // millis() of the last message, the least recently used bucket of a set is taken over
+        uint8_t tokens; // number of messages which may still be logged
+        uint16_t suppressed; // number of messages suppressed since the last summary
     };
     Logger();
-    void debug(String, ...);
-    void debug(Device *, String, ...);
-    void info(String, ...);
-    void info(Device *, String, ...);
-    void warn(String, ...);
-    void warn(Device *, String, ...);
-    void error(String, ...);
-    void error(Device *, String, ...);
+    void debug(const char *, ...);
+    void debug(Device *, const char *, ...);
+    void info(const char *, ...);
+    void info(Device *, const char *, ...);
+    void warn(const char *, ...);
+    void warn(Device *, const char *, ...);
+    void error(const char *, ...);
+    void error(Device *, const char *, ...);
     void console(String, ...);
+    void process();
+    void setDeferred(bool);
+    bool isDeferred();
     void setLoglevel(LogLevel);
     void setLoglevel(Device *, LogLevel);
     LogLevel getLogLevel();
     LogLevel getLogLevel(Device *);
-    LogEntry &createLogEntry(LogLevel level, String deviceName, String message);
-    String logLevelToString(LogLevel level);
+    const char *logLevelToString(LogLevel level);
     boolean isDebug();
     void printHistory(Print &printer);
+    void handOff();
 private:
     LogLevel logLevel;
     bool debugging;
-    LogLevel *deviceLoglevel;
     char msgBuffer[LOG_BUFFER_SIZE];
     uint16_t lastMsgRepeated;
     uint32_t repeatStart;
-    LogEntry history[HISTORY_SIZE];
-    uint16_t historyPtr;
+    uint8_t historyArena[CFG_LOG_HISTORY_ARENA_SIZE] __attribute__((aligned(4))); // ring buffer of variable length LogRecords
+    uint16_t historyHead; // offset where the next record is written
+    uint16_t historyTail; // offset of the oldest record
+    uint16_t historyLast; // offset of the newest record
+    uint16_t historyCount; // number of records in the arena
+    bool deferred; // store messages unformatted and output them in process()
+    DeferredEntry deferredQueue[CFG_LOG_DEFERRED_SIZE]; // ring buffer of unformatted messages
+    uint16_t deferredHead, deferredTail; // write and read index of deferredQueue
+    uint16_t deferredDropped; // number of messages dropped because deferredQueue was full
+    char deferredText[CFG_LOG_DEFERRED_TEXT_SIZE]; // ring buffer of the formatted messages in deferredQueue
+    uint16_t deferredTextHead, deferredTextTail; // write and read offset of deferredText
+    const char *formatCache[CFG_LOG_FORMAT_CACHE_SIZE]; // recently analyzed format strings (direct mapped by address)
+    uint8_t formatArgCount[CFG_LOG_FORMAT_CACHE_SIZE]; // number of argument words of the cached formats or LOG_NOT_DEFERRABLE
+    RateLimit rateLimits[CFG_LOG_RATE_SLOTS]; // token buckets of the call sites (sets of CFG_LOG_RATE_WAYS selected by address)
+    uint16_t rateSuppressed; // suppressed messages of call sites whose bucket was taken over by another one
+    uint32_t lastRateSummary; // millis() of the last summary of suppressed messages
 
-    void log(String, LogLevel, String format, va_list);
-    void logToPrinter(Print &printer, LogEntry &logEntry);
-    void logToWifi(LogEntry &logEntry);
-    void handOff();
+    void log(Device *, LogLevel, const char *format, va_list);
+    bool isRateLimited(const char *format);
+    RateLimit *findRateLimit(const char *format, uint32_t now);
+    void summarizeSuppressed();
+    bool defer(Device *, LogLevel, const char *format, va_list);
+    bool deferText(Device *, LogLevel, const char *message);
+    DeferredEntry *allocateEntry();
+    uint8_t getArgCount(const char *format);
+    uint8_t analyzeFormat(const char *format);
+    void outputDeferred();
+    void output(Device *, LogLevel, const char *message, uint32_t time);
+    LogRecord *addRecord(DeviceId, LogLevel, const char *message, uint32_t time);
+    void evictRecord();
+    uint16_t wrapOffset(uint16_t offset);
+    bool isRepeated(const char *message);
+    const char *getDeviceName(uint16_t deviceId);
+    void logToPrinter(Print &printer, LogRecord *record);
+    void logToWifi(LogRecord *record);
 };
 
 extern Logger logger;
@@ -25,17 +25,36 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
 #include "MemCache.h"
+#include "BootTimeline.h"
 
 MemCache memCache;
 
 MemCache::MemCache()
 {
+    backend = &i2cEepromBackend;
+    hitCount = 0;
+    missCount = 0;
+    evictionCount = 0;
+    forcedFlushCount = 0;
+    byteReadCount = 0;
+    stallTime = 0;
+    pageWriteCount = 0;
+    byteWriteCount = 0;
+    writeTimeoutCount = 0;
 }
 
 MemCache::~MemCache()
 {
 }
 
+/*
+ * Replace the storage medium (the I2C EEPROM by default). Must be called before setup().
+ */
+void MemCache::setBackend(EepromBackend *backend)
+{
+    this->backend = backend;
+}
+
 /*
  * Initialize the memory cache (note, this is only a TickListener, not a device !)
  */
@@ -45,59 +64,69 @@ void MemCache::setup()
 
     logger.debug("add MemCache (id: %#x, %#x)", MEMCACHE, &memCache);
 
-    Wire.begin();
+    backend->setup();
     for (U8 c = 0; c < NUM_CACHED_PAGES; c++) {
         pages[c].address = 0xFFFFFF; //maximum number. This is way over what our chip will actually support so it signals unused
         pages[c].age = 0;
-        pages[c].dirty = false;
+        pages[c].dirtyBlocks = 0;
+        pages[c].queued = false;
+        pages[c].referenced = false;
     }
-
-    //WriteTimer = 0;
-
-    //digital pin 18 (GEVCU 2) 19 (GEVCU>=3) is connected to the write protect function of the EEPROM. It is active high so set it low to enable writes
-    pinMode(CFG_EEPROM_WRITE_PROTECT, OUTPUT);
-    digitalWrite(CFG_EEPROM_WRITE_PROTECT, LOW);
+    clockHand = 0;
+    memset(pageIndex, NOT_CACHED, sizeof(pageIndex));
+    memset(deferredWrites, 0, sizeof(deferredWrites));
+    writeHead = writeTail = 0;
+    writeStarted = false;
+    writeBlocks = 0;
+    writeBusy = false;
+    agingTicks = 0;
 
     tickHandler.attach(this, CFG_TICK_INTERVAL_MEM_CACHE);
 }
 
 /*
- * Handle aging of dirty pages and flushing of aged out dirty pages
+ * Handle aging of dirty pages, queueing of aged out dirty pages and
+ * the write-back of queued pages to the EEPROM.
  */
 void MemCache::handleTick()
 {
     U8 c;
-    cache_age();
 
-    for (c = 0; c < NUM_CACHED_PAGES; c++) {
-        if ((pages[c].age == MAX_AGE) && (pages[c].dirty)) {
-            logger.debug("flushing page %X", c);
-            FlushPage(c);
-            return;
+    if (++agingTicks >= AGING_PERIOD) {
+        agingTicks = 0;
+        cache_age();
+
+        for (c = 0; c < NUM_CACHED_PAGES; c++) {
+            if ((pages[c].age == MAX_AGE) && (pages[c].dirtyBlocks)) {
+                FlushPage(c);
+            }
         }
     }
+
+    cache_deferredwrites();
+    cache_flushahead();
+    cache_writeback();
 }
 
 /*
- * Flush the first dirty page to the EEPROM.
+ * Queue the first dirty page for write-back to the EEPROM.
  */
 void MemCache::FlushSinglePage()
 {
     U8 c;
 
     for (c = 0; c < NUM_CACHED_PAGES; c++) {
-        if (pages[c].dirty) {
-            cache_writepage(c);
-            pages[c].dirty = false;
-            pages[c].age = 0; //freshly flushed!
+        if (pages[c].dirtyBlocks && !pages[c].queued) {
+            cache_queuepage(c);
             return;
         }
     }
 }
 
 /*
- * Flush every dirty page.
- * It will block for 10ms per page so maybe things will be blocked for a long, long time
+ * Flush every dirty page and wait until all of them are written.
+ * It polls the EEPROM until each write cycle is complete (up to 5ms per chunk)
+ * so things will be blocked for a long time.
  *
  * NOTE: DO NOT USE THIS FUNCTION UNLESS YOU CAN ACCEPT THAT!
  */
@@ -106,30 +135,61 @@ void MemCache::FlushAllPages()
     U8 c;
 
     for (c = 0; c < NUM_CACHED_PAGES; c++) {
-        if (pages[c].dirty) { //found a dirty page so flush it
-            cache_writepage(c);
-            pages[c].dirty = false;
-            delay(10);  //10ms is longest it would take to write a page according to datasheet
+        if (pages[c].dirtyBlocks) { //found a dirty page so flush it
+            cache_queuepage(c);
+        }
+    }
+    cache_waitforpage(NOT_CACHED);
+
+    //now the deferred writes are due, write them too
+    for (c = 0; c < CFG_MEMCACHE_DEFERRED_WRITES; c++) {
+        if (deferredWrites[c].length) {
+            cache_deferredwrites();
+            cache_waitforpage(NOT_CACHED);
+            break;
         }
     }
 }
 
 /*
- * Flush a given page by the page ID.
+ * Queue a given page by the page ID for write-back.
  * This is NOT by address so act accordingly.
  */
 void MemCache::FlushPage(uint8_t page)
 {
-    if (pages[page].dirty) {
-        cache_writepage(page);
-        pages[page].dirty = false;
-        pages[page].age = 0; //freshly flushed!
+    if (page < NUM_CACHED_PAGES && pages[page].dirtyBlocks) {
+        cache_queuepage(page);
+    }
+}
+
+/*
+ * Queue the page containing the given address for write-back.
+ */
+void MemCache::FlushAddress(uint32_t address)
+{
+    uint8_t c = cache_hit(address >> 8);
+
+    if (c != NOT_CACHED) {
+        FlushPage(c);
+    }
+}
+
+/*
+ * Block until the page containing the given address is written to the EEPROM (if it is queued).
+ */
+void MemCache::WaitForAddress(uint32_t address)
+{
+    uint8_t c = cache_hit(address >> 8);
+
+    if (c != NOT_CACHED) {
+        cache_waitforpage(c);
     }
 }
 
 /*
  * Like FlushPage but also marks the page invalid (unused).
  * So if another read request comes it it'll have to be re-read from EEPROM
+ * As the page has to be written first, this blocks until its write-back is complete.
  */
 void MemCache::InvalidatePage(uint8_t page)
 {
@@ -137,15 +197,154 @@ void MemCache::InvalidatePage(uint8_t page)
         return;    //invalid page, buddy!
     }
 
-    if (pages[page].dirty) {
-        cache_writepage(page);
-    }
+    FlushPage(page);
+    cache_waitforpage(page);
 
-    pages[page].dirty = false;
-    pages[page].address = 0xFFFFFF;
+    cache_unmap(page);
+    pages[page].dirtyBlocks = 0;
     pages[page].age = 0;
 }
 
+/*
+ * Write data once a range it depends on is in the EEPROM (no page of the range is dirty or queued
+ * anymore). The range must have been flushed (FlushAddress()) before, so its write-back is on its way.
+ * This way a commit marker can't reach the EEPROM before the data it validates without blocking.
+ * Returns false if the data is too long or all entries are in use.
+ */
+boolean MemCache::WriteDeferred(uint32_t address, void* data, uint8_t len, uint32_t start, uint16_t length)
+{
+    if (len > DEFERRED_WRITE_SIZE || length == 0) {
+        return false;
+    }
+    CancelDeferredWrite(address);
+    for (uint8_t i = 0; i < CFG_MEMCACHE_DEFERRED_WRITES; i++) {
+        DeferredWrite *deferred = &deferredWrites[i];
+        if (deferred->length == 0) {
+            deferred->address = address;
+            deferred->start = start;
+            deferred->length = length;
+            deferred->size = len;
+            memcpy(deferred->data, data, len);
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Is a deferred write to the given address still waiting
+ */
+boolean MemCache::IsWriteDeferred(uint32_t address)
+{
+    for (uint8_t i = 0; i < CFG_MEMCACHE_DEFERRED_WRITES; i++) {
+        if (deferredWrites[i].length && deferredWrites[i].address == address) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Drop a deferred write to the given address. Returns false if there was none (anymore).
+ */
+boolean MemCache::CancelDeferredWrite(uint32_t address)
+{
+    for (uint8_t i = 0; i < CFG_MEMCACHE_DEFERRED_WRITES; i++) {
+        if (deferredWrites[i].length && deferredWrites[i].address == address) {
+            deferredWrites[i].length = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Number of pages waiting to be written to the EEPROM (incl. the one being written)
+ */
+uint8_t MemCache::getWriteQueueDepth()
+{
+    return (writeHead + WRITE_QUEUE_SIZE - writeTail) % WRITE_QUEUE_SIZE;
+}
+
+/*
+ * Number of deferred writes waiting for their range to reach the EEPROM
+ */
+uint8_t MemCache::getDeferredWriteCount()
+{
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < CFG_MEMCACHE_DEFERRED_WRITES; i++) {
+        if (deferredWrites[i].length) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/*
+ * Number of pages written to the EEPROM since start-up
+ */
+uint32_t MemCache::getPageWriteCount()
+{
+    return pageWriteCount;
+}
+
+/*
+ * Number of bytes written to the EEPROM since start-up (only the modified blocks of a page are written)
+ */
+uint32_t MemCache::getByteWriteCount()
+{
+    return byteWriteCount;
+}
+
+/*
+ * Average number of bytes written per page flush
+ */
+uint16_t MemCache::getBytesPerFlush()
+{
+    return (pageWriteCount == 0 ? 0 : byteWriteCount / pageWriteCount);
+}
+
+/*
+ * Number of bytes read from the EEPROM since start-up
+ */
+uint32_t MemCache::getByteReadCount()
+{
+    return byteReadCount;
+}
+
+/*
+ * Number of accesses which were served from a cached page
+ */
+uint32_t MemCache::getHitCount()
+{
+    return hitCount;
+}
+
+/*
+ * Number of accesses which required to read a page from the EEPROM
+ */
+uint32_t MemCache::getMissCount()
+{
+    return missCount;
+}
+
+/*
+ * Total time in microseconds the cache blocked the caller while reading pages or waiting for write-backs
+ */
+uint32_t MemCache::getStallTime()
+{
+    return stallTime;
+}
+
+/*
+ * Number of write cycles which were not acknowledged by the EEPROM in time
+ */
+uint32_t MemCache::getWriteTimeoutCount()
+{
+    return writeTimeoutCount;
+}
+
 /*
  * Mark a given page unused given an address within that page.
  * Will write the page out if it was dirty.
@@ -158,7 +357,7 @@ void MemCache::InvalidateAddress(uint32_t address)
     addr = address >> 8; //kick it down to the page we're talking about
     c = cache_hit(addr);
 
-    if (c != 0xFF) {
+    if (c != NOT_CACHED) {
         InvalidatePage(c);
     }
 }
@@ -197,38 +396,44 @@ void MemCache::AgeFullyAddress(uint32_t address)
     page_addr = address >> 8; //kick it down to the page we're talking about
     thisCache = cache_hit(page_addr);
 
-    if (thisCache != 0xFF) { //if we did indeed have that page in cache
+    if (thisCache != NOT_CACHED) { //if we did indeed have that page in cache
         pages[thisCache].age = MAX_AGE;
     }
 }
 
 /*
- * Write data into the memory cache instead of direct EEPROM writes
+ * Load all pages of an address range into the cache in one sequential burst.
+ * Only unused cache pages are filled so nothing that is already cached gets evicted.
+ * Returns the number of pages read from the EEPROM.
  */
-boolean MemCache::Write(uint32_t address, uint8_t valu)
+uint8_t MemCache::Prefetch(uint32_t address, uint32_t length)
 {
     uint32_t addr;
-    uint8_t c;
-
-    addr = address >> 8; //kick it down to the page we're talking about
-    c = cache_hit(addr);
-
-    if (c == 0xFF)    {
-        c = cache_findpage(); //try to free up a page
+    uint8_t count = 0;
 
-        if (c != 0xFF) {
-            c = cache_readpage(addr);    //and populate it with the existing data
-        }
+    if (length == 0) {
+        return 0;
     }
-
-    if (c != 0xFF) {
-        pages[c].data[(uint16_t)(address & 0x00FF)] = valu;
-        pages[c].dirty = true;
-        pages[c].address = addr; //set this in case we actually are setting up a new cache page
-        return true;
+    for (addr = address >> 8; addr <= (address + length - 1) >> 8; addr++) {
+        if (cache_hit(addr) != NOT_CACHED) {
+            continue;
+        }
+        if (!cache_hasfreepage()) {
+            break; //the cache is full
+        }
+        if (cache_readpage(addr) != NOT_CACHED) {
+            count++;
+        }
     }
+    return count;
+}
 
-    return false;
+/*
+ * Write data into the memory cache instead of direct EEPROM writes
+ */
+boolean MemCache::Write(uint32_t address, uint8_t valu)
+{
+    return Write(address, &valu, 1);
 }
 
 /*
@@ -253,39 +458,42 @@ boolean MemCache::Write(uint32_t address, uint32_t valu)
 
 /*
  * Write data into the memory cache instead of direct EEPROM writes
+ *
+ * The data is copied in spans which lie within one page, so there's only one
+ * cache lookup per page touched.
  */
 boolean MemCache::Write(uint32_t address, void* data, uint16_t len)
 {
-    uint32_t addr;
+    uint8_t *source = (uint8_t *) data;
+    uint16_t offset, span;
     uint8_t c;
-    uint16_t count;
 
-    for (count = 0; count < len; count++) {
-        addr = (address + count) >> 8; //kick it down to the page we're talking about
-        c = cache_hit(addr);
+    while (len > 0) {
+        offset = address & 0x00FF;
+        span = min(len, 256 - offset);
+        c = cache_hit(address >> 8);
 
-        if (c == 0xFF) {
-            c = cache_findpage(); //try to find a page that either isn't loaded or isn't dirty
+        if (c == NOT_CACHED) {
+            missCount++;
+            c = cache_readpage(address >> 8); //find a free page and populate it with the existing data
 
-            if (c != 0xFF) {
-                c = cache_readpage(addr);    //and populate it with the existing data
+            if (c == NOT_CACHED) {
+                return false; //could not find a suitable cache page to write to
             }
-        }
-
-        if (c != 0xFF) { //could we find a suitable cache page to write to?
-            pages[c].data[(uint16_t)((address + count) & 0x00FF)] = * (uint8_t *)(data + count);
-            pages[c].dirty = true;
-            pages[c].address = addr; //set this in case we actually are setting up a new cache page
         } else {
-            break;
+            hitCount++;
+            pages[c].referenced = true;
         }
-    }
 
-    if (c != 0xFF) {
-        return true;    //all ok!
+        memcpy(pages[c].data + offset, source, span);
+        pages[c].dirtyBlocks |= cache_blockmask(offset, span);
+
+        address += span;
+        source += span;
+        len -= span;
     }
 
-    return false;
+    return true; //all ok!
 }
 
 /*
@@ -294,27 +502,7 @@ boolean MemCache::Write(uint32_t address, void* data, uint16_t len)
  */
 boolean MemCache::Read(uint32_t address, uint8_t* valu)
 {
-    uint32_t addr;
-    uint8_t c;
-
-    addr = address >> 8; //kick it down to the page we're talking about
-    c = cache_hit(addr);
-
-    if (c == 0xFF) { //page isn't cached. Search the cache, potentially dump a page and bring this one in
-        c = cache_readpage(addr);
-    }
-
-    if (c != 0xFF) {
-        *valu = pages[c].data[(uint16_t)(address & 0x00FF)];
-
-        if (!pages[c].dirty) {
-            pages[c].age = 0;    //reset age since we just used it
-        }
-
-        return true; //all ok!
-    } else {
-        return false;
-    }
+    return Read(address, valu, 1);
 }
 
 /*
@@ -342,53 +530,88 @@ boolean MemCache::Read(uint32_t address, uint32_t* valu)
 /*
  * Read a value from the cache.
  * If not available in the cache, the EEPROM will be read.
+ *
+ * The data is copied in spans which lie within one page, so there's only one
+ * cache lookup per page touched.
  */
 boolean MemCache::Read(uint32_t address, void* data, uint16_t len)
 {
-    uint32_t addr;
+    uint8_t *destination = (uint8_t *) data;
+    uint16_t offset, span;
     uint8_t c;
-    uint16_t count;
-
-    for (count = 0; count < len; count++) {
-        addr = (address + count) >> 8;
-        c = cache_hit(addr);
 
-        if (c == 0xFF) { //page isn't cached. Search the cache, potentially dump a page and bring this one in
-            c = cache_readpage(addr);
-        }
+    while (len > 0) {
+        offset = address & 0x00FF;
+        span = min(len, 256 - offset);
+        c = cache_hit(address >> 8);
 
-        if (c != 0xFF) {
-            * (uint8_t *)(data + count) = pages[c].data[(uint16_t)((address + count) & 0x00FF)];
+        if (c == NOT_CACHED) { //page isn't cached. Search the cache, potentially dump a page and bring this one in
+            missCount++;
+            c = cache_readpage(address >> 8);
 
-            if (!pages[c].dirty) {
-                pages[c].age = 0;    //reset age since we just used it
+            if (c == NOT_CACHED) {
+                return false;
             }
         } else {
-            break;    //bust the for loop if we run into trouble
+            hitCount++;
+            pages[c].referenced = true;
         }
-    }
 
-    if (c != 0xFF) {
-        return true;    //all ok!
+        memcpy(destination, pages[c].data + offset, span);
+
+        if (!pages[c].dirtyBlocks) {
+            pages[c].age = 0; //reset age since we just used it
+        }
+
+        address += span;
+        destination += span;
+        len -= span;
     }
 
-    return false;
+    return true; //all ok!
 }
 
 /*
- * Find page number of an address (if present, return 0xFF otherwise)
+ * Find the cache page of an EEPROM page (if present, return NOT_CACHED otherwise)
  */
 uint8_t MemCache::cache_hit(uint32_t address)
 {
-    uint8_t c;
-
-    for (c = 0; c < NUM_CACHED_PAGES; c++) {
+#ifdef MEM_CACHE_LINEAR_SCAN // the former lookup, only built by util/MemCacheBench for comparison
+    for (uint8_t c = 0; c < NUM_CACHED_PAGES; c++) {
         if (pages[c].address == address) {
             return c;
         }
     }
+    return NOT_CACHED;
+#else
+    if (address >= NUM_EEPROM_PAGES) {
+        return NOT_CACHED;
+    }
+    return pageIndex[address];
+#endif
+}
 
-    return 0xFF;
+/*
+ * Get the bit mask of the dirty blocks which are touched by a span within a page
+ */
+uint32_t MemCache::cache_blockmask(uint16_t offset, uint16_t length)
+{
+    uint8_t first = offset / DIRTY_BLOCK_SIZE;
+    uint8_t last = (offset + length - 1) / DIRTY_BLOCK_SIZE;
+    uint32_t mask = (last == 31 ? 0xFFFFFFFF : (1ul << (last + 1)) - 1);
+
+    return mask & ~((1ul << first) - 1);
+}
+
+/*
+ * Remove a cache page from the page index and mark it unused
+ */
+void MemCache::cache_unmap(uint8_t page)
+{
+    if (pages[page].address < NUM_EEPROM_PAGES) {
+        pageIndex[pages[page].address] = NOT_CACHED;
+    }
+    pages[page].address = 0xFFFFFF;
 }
 
 /*
@@ -406,55 +629,161 @@ void MemCache::cache_age()
 }
 
 /*
- * Try to find an empty page or one that can be removed from cache
+ * Is there an unused page in the cache
+ */
+boolean MemCache::cache_hasfreepage()
+{
+    for (uint8_t c = 0; c < NUM_CACHED_PAGES; c++) {
+        if (pages[c].address == 0xFFFFFF) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Try to find an empty page or one that can be removed from cache.
+ *
+ * Clean pages are replaced with the CLOCK (second chance) algorithm: the hand sweeps over the
+ * pages and takes the first clean page which was not referenced since the last sweep. Pages
+ * which are accessed again after they were loaded (e.g. hot config pages) survive one more round.
  */
 uint8_t MemCache::cache_findpage()
 {
     uint8_t c;
-    uint8_t old_c, old_v;
 
     for (c = 0; c < NUM_CACHED_PAGES; c++) {
         if (pages[c].address == 0xFFFFFF) { //found an empty cache page so populate it and return its number
             pages[c].age = 0;
-            pages[c].dirty = false;
+            pages[c].dirtyBlocks = 0;
+            pages[c].referenced = false;
             return c;
         }
     }
 
-    //if we got here then there are no free pages so scan to find the oldest one which isn't dirty
-    old_c = 0xFF;
-    old_v = 0;
+    c = cache_clocksweep();
 
-    for (c = 0; c < NUM_CACHED_PAGES; c++) {
-        if (!pages[c].dirty && pages[c].age >= old_v) {
-            old_c = c;
-            old_v = pages[c].age;
+    if (c == NOT_CACHED) { //all pages are dirty - free one up (this should rarely happen, see cache_flushahead())
+        forcedFlushCount++;
+        //write the first queued page (or queue one) and wait until it's done
+        if (writeHead == writeTail) {
+            FlushSinglePage();
+        }
+        if (writeHead != writeTail) {
+            cache_waitforpage(writeQueue[writeTail]);
+        }
+        c = cache_clocksweep();
+
+        if (c == NOT_CACHED) {
+            return NOT_CACHED;    //if nothing worked then give up
         }
     }
 
-    if (old_c == 0xFF) { //no pages were not dirty - try to free one up
-        FlushSinglePage(); //try to free up a page
-        //now try to find the free page (if one was freed)
-        old_v = 0;
+    //If we got to this point then we have a page to use
+    evictionCount++;
+    pages[c].age = 0;
+    pages[c].dirtyBlocks = 0;
+    pages[c].referenced = false;
+    cache_unmap(c); //mark it unused
+
+    return c;
+}
+
+/*
+ * Advance the clock hand to the next clean page which was not referenced (clearing the
+ * reference bits of the pages it passes). Returns NOT_CACHED if there's no clean page.
+ */
+uint8_t MemCache::cache_clocksweep()
+{
+    uint8_t c;
+
+    for (uint8_t i = 0; i < 2 * NUM_CACHED_PAGES; i++) { // two rounds: the first may only clear reference bits
+        c = clockHand;
+        clockHand = (clockHand + 1) % NUM_CACHED_PAGES;
+
+        if (pages[c].dirtyBlocks || pages[c].queued) {
+            continue;
+        }
+        if (pages[c].referenced) {
+            pages[c].referenced = false; //second chance
+            continue;
+        }
+        return c;
+    }
+    return NOT_CACHED;
+}
+
+/*
+ * If only few clean pages are left, queue the oldest dirty pages for write-back ahead of time,
+ * so a cache miss doesn't have to wait for a flush.
+ */
+void MemCache::cache_flushahead()
+{
+    uint8_t c, clean = 0, oldest;
+
+    for (c = 0; c < NUM_CACHED_PAGES; c++) {
+        if (!pages[c].dirtyBlocks && !pages[c].queued) {
+            clean++;
+        }
+    }
 
+    while (clean < CFG_MEMCACHE_MIN_CLEAN_PAGES) {
+        oldest = NOT_CACHED;
         for (c = 0; c < NUM_CACHED_PAGES; c++) {
-            if (!pages[c].dirty && pages[c].age >= old_v) {
-                old_c = c;
-                old_v = pages[c].age;
+            if (pages[c].dirtyBlocks && !pages[c].queued && (oldest == NOT_CACHED || pages[c].age > pages[oldest].age)) {
+                oldest = c;
             }
         }
+        if (oldest == NOT_CACHED) {
+            return;
+        }
+        cache_queuepage(oldest);
+        clean++; // will be clean once written
+    }
+}
 
-        if (old_c == 0xFF) {
-            return 0xFF;    //if nothing worked then give up
+/*
+ * Check if a range is in the EEPROM: none of its pages is dirty or waiting for write-back.
+ * Pages which aren't cached are clean as only clean pages are evicted.
+ */
+boolean MemCache::cache_isclean(uint32_t start, uint16_t length)
+{
+    for (uint32_t address = start >> 8; address <= (start + length - 1) >> 8; address++) {
+        uint8_t c = cache_hit(address);
+        if (c != NOT_CACHED && (pages[c].dirtyBlocks || pages[c].queued)) {
+            return false;
         }
     }
+    return true;
+}
 
-    //If we got to this point then we have a page to use
-    pages[old_c].age = 0;
-    pages[old_c].dirty = false;
-    pages[old_c].address = 0xFFFFFF; //mark it unused
+/*
+ * Write and queue the deferred writes whose range reached the EEPROM.
+ */
+void MemCache::cache_deferredwrites()
+{
+    for (uint8_t i = 0; i < CFG_MEMCACHE_DEFERRED_WRITES; i++) {
+        DeferredWrite *deferred = &deferredWrites[i];
+        if (deferred->length && cache_isclean(deferred->start, deferred->length)) {
+            deferred->length = 0;
+            Write(deferred->address, deferred->data, deferred->size);
+            FlushAddress(deferred->address);
+        }
+    }
+}
 
-    return old_c;
+/*
+ * Print the cache statistics to the console
+ */
+void MemCache::printStatistics()
+{
+    uint32_t accesses = hitCount + missCount;
+
+    logger.console("EEPROM cache: hits=%d, misses=%d (hit rate %d%%), evictions=%d, forced flushes=%d", hitCount, missCount,
+            (accesses == 0 ? 0 : (uint32_t) ((uint64_t) hitCount * 100 / accesses)), evictionCount, forcedFlushCount);
+    logger.console("    read=%d bytes, written=%d bytes in %d page flushes (%d bytes/flush), write queue=%d, deferred=%d, write timeouts=%d, stalled=%dus",
+            byteReadCount, byteWriteCount, pageWriteCount, getBytesPerFlush(), getWriteQueueDepth(), getDeferredWriteCount(),
+            writeTimeoutCount, stallTime);
 }
 
 /*
@@ -462,64 +791,147 @@ uint8_t MemCache::cache_findpage()
  */
 uint8_t MemCache::cache_readpage(uint32_t addr)
 {
-    uint16_t c, d, e;
-    uint32_t address = addr << 8;
-    uint8_t buffer[3];
-    uint8_t i2c_id;
+    uint8_t c;
+    uint32_t start;
+
+    if (addr >= NUM_EEPROM_PAGES) {
+        return NOT_CACHED;
+    }
     c = cache_findpage();
 
-    if (c != 0xFF) {
+    if (c != NOT_CACHED) {
         logger.debug("reading page %d from eeprom address %d", c, addr);
+        start = micros();
 
-        buffer[0] = ((address & 0xFF00) >> 8);
-        //buffer[1] = (address & 0x00FF);
-        buffer[1] = 0; //the pages are 256 bytes so the start of a page is always 00 for the LSB
-        i2c_id = 0b01010000 + ((address >> 16) & 0x03);  //10100 is the chip ID then the two upper bits of the address
-        Wire.beginTransmission(i2c_id);
-        Wire.write(buffer, 2);
-        Wire.endTransmission(false);  //do NOT generate stop
-        //delayMicroseconds(50); //give TWI some time to send and chip some time to get page
-        Wire.requestFrom(i2c_id, 256);  //this will generate stop though.
-
-        for (e = 0; e < 256; e++) {
-            if (Wire.available()) {
-                d = Wire.read(); // receive a byte as character
-                pages[c].data[e] = d;
-            }
+        while (writeBusy && !cache_writecomplete()); //the chip doesn't respond while it is writing
+        writeBusy = false;
+
+        if (!backend->readPage(addr << 8, pages[c].data)) {
+            logger.error("unable to read eeprom page %d", addr);
+            stallTime += micros() - start;
+            return NOT_CACHED;
         }
+        byteReadCount += 256;
+        stallTime += micros() - start;
+        bootTimeline.add(BootTimeline::EEPROM_PAGE, addr, start);
 
         pages[c].address = addr;
         pages[c].age = 0;
-        pages[c].dirty = false;
+        pages[c].dirtyBlocks = 0;
+        pageIndex[addr] = c;
     }
 
     return c;
 }
 
 /*
- * Write a page from the memory cache directly to the EEPROM
+ * Add a cache page to the write-back queue (unless it's already in there).
+ * The queue can hold every cache page once, so it can't overflow.
  */
-boolean MemCache::cache_writepage(uint8_t page)
+void MemCache::cache_queuepage(uint8_t page)
 {
-    uint16_t d;
-    uint32_t addr;
-    uint8_t buffer[258];
-    uint8_t i2c_id;
-    addr = pages[page].address << 8;
-    buffer[0] = ((addr & 0xFF00) >> 8);
-    //buffer[1] = (addr & 0x00FF);
-    buffer[1] = 0; //pages are 256 bytes so LSB is always 0 for the start of a page
-    i2c_id = 0b01010000 + ((addr >> 16) & 0x03);  //10100 is the chip ID then the two upper bits of the address
+    if (pages[page].queued) {
+        return;
+    }
+    pages[page].queued = true;
+    writeQueue[writeHead] = page;
+    writeHead = (writeHead + 1) % WRITE_QUEUE_SIZE;
+}
+
+/*
+ * Advance the write-back of the queued pages by one step without blocking:
+ * If the EEPROM is still busy with the last write cycle, nothing is done.
+ * Otherwise the next chunk of the page at the head of the queue is sent.
+ * Returns true if there is still work to do.
+ */
+boolean MemCache::cache_writeback()
+{
+    uint8_t page;
+
+    if (writeBusy) {
+        if (!cache_writecomplete()) {
+            return true;
+        }
+        writeBusy = false;
+    }
+
+    if (writeHead == writeTail) {
+        return false;
+    }
+    page = writeQueue[writeTail];
+
+    if (!writeStarted) {
+        writeBlocks = pages[page].dirtyBlocks;
+        pages[page].dirtyBlocks = 0; //modifications from now on require another write-back
+        writeStarted = true;
+    }
 
-    logger.debug("flushing page %d to eeprom address %d", page, pages[page].address);
+    if (writeBlocks != 0) {
+        //send the next run of consecutive dirty blocks, limited to the chunk size
+        uint8_t first = __builtin_ctz(writeBlocks);
+        uint8_t count = 0;
 
-    for (d = 0; d < 256; d++) {
-        buffer[d + 2] = pages[page].data[d];
+        while (first + count < 32 && (writeBlocks & (1ul << (first + count)))
+                && count < CFG_MEMCACHE_WRITE_CHUNK_SIZE / DIRTY_BLOCK_SIZE) {
+            writeBlocks &= ~(1ul << (first + count));
+            count++;
+        }
+        cache_writechunk(page, first * DIRTY_BLOCK_SIZE, count * DIRTY_BLOCK_SIZE);
     }
 
-    Wire.beginTransmission(i2c_id);
-    Wire.write(buffer, 258);
-    Wire.endTransmission(true);
-    
+    if (writeBlocks == 0) { //all dirty blocks of the page sent
+        writeStarted = false;
+        pages[page].queued = false;
+        pages[page].age = 0; //freshly flushed!
+        pageWriteCount++;
+        writeTail = (writeTail + 1) % WRITE_QUEUE_SIZE;
+        if (pages[page].dirtyBlocks) { //modified while it was written, FlushPage() couldn't queue it again
+            cache_queuepage(page);
+        }
+    }
     return true;
 }
+
+/*
+ * Block until the given page is written to the EEPROM (NOT_CACHED = until the queue is empty).
+ * A page which is modified during its write-back is queued again, so wait for that write too.
+ */
+void MemCache::cache_waitforpage(uint8_t page)
+{
+    uint32_t start = micros();
+
+    while ((page == NOT_CACHED || pages[page].queued || pages[page].dirtyBlocks) && cache_writeback());
+    stallTime += micros() - start;
+}
+
+/*
+ * Poll the EEPROM for the completion of its internal write cycle.
+ * The chip does not acknowledge its address as long as it is busy writing.
+ */
+boolean MemCache::cache_writecomplete()
+{
+    if (backend->isWriteComplete()) {
+        return true;
+    }
+    if ((micros() - writeTimestamp) > CFG_MEMCACHE_WRITE_TIMEOUT) {
+        logger.error("EEPROM write cycle not acknowledged within %dus", CFG_MEMCACHE_WRITE_TIMEOUT);
+        writeTimeoutCount++;
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Send a chunk of a page from the memory cache to the EEPROM (it must not exceed
+ * CFG_MEMCACHE_WRITE_CHUNK_SIZE and the EEPROM page).
+ * The chip starts its internal write cycle after the stop condition, completion must be
+ * polled with cache_writecomplete() before the next chunk can be sent.
+ */
+void MemCache::cache_writechunk(uint8_t page, uint16_t offset, uint16_t length)
+{
+    backend->write((pages[page].address << 8) + offset, pages[page].data + offset, length);
+    byteWriteCount += length;
+
+    writeBusy = true;
+    writeTimestamp = micros();
+}
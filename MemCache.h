@@ -32,7 +32,7 @@
 #include <Arduino.h>
 #include "config.h"
 #include "TickHandler.h"
-#include <due_wire.h>
+#include "EepromBackend.h"
 
 //Total # of allowable pages to cache. Limits RAM usage
 #define NUM_CACHED_PAGES   20
@@ -40,30 +40,67 @@
 //maximum allowable age of a cache
 #define MAX_AGE  128
 
-/* # of system ticks per aging cycle. There are 128 aging levels total so
- // multiply 128 by this aging period and multiple that by system tick duration
+//number of ticks per aging cycle
+#define AGING_PERIOD       4
+
+//size of the blocks which are tracked as dirty (256 / 32 bits of the dirty mask)
+#define DIRTY_BLOCK_SIZE   8
+
+//size of the write-back queue (one more than the cached pages as one entry is always empty)
+#define WRITE_QUEUE_SIZE   (NUM_CACHED_PAGES + 1)
+
+//number of 256 byte pages in the EEPROM (256kB, 18 bit addresses)
+#define NUM_EEPROM_PAGES   1024
+
+//marks an EEPROM page as not cached / a cache page as unused
+#define NOT_CACHED         0xFF
+
+//max number of bytes of a deferred write (e.g. the header of a configuration copy)
+#define DEFERRED_WRITE_SIZE 4
+
+/* There are 128 aging levels total so
+ // multiply 128 by the aging period (AGING_PERIOD) and multiple that by system tick duration
  // to determine how long it will take for a page to age out fully and get written
  // if dirty. For instance, 128 levels * 500 aging period * 10ms (100Hz tick) = 640 seconds
  // EEPROM handles about 1 million write cycles. So, a flush time of 100 seconds means that
  // continuous writing would last 100M seconds which is 3.17 years
- // Another way to look at it is that 128 aging levels * 40ms tick is 5.12 seconds to flush for
- // each aging period below. Adjust accordingly.
+ // Another way to look at it is that 128 aging levels * 4 aging period * 10ms tick is 5.12 seconds
+ // to flush. Adjust accordingly.
+ // The tick is shorter than the aging period so the write-back of queued pages can proceed
+ // in small non-blocking steps.
  */
 
 class MemCache: public TickObserver
 {
 public:
+    void setBackend(EepromBackend *backend);
     void setup();
     void handleTick();
     void FlushSinglePage();
     void FlushAllPages();
     void FlushPage(uint8_t page);
     void FlushAddress(uint32_t address);
+    void WaitForAddress(uint32_t address);
     void InvalidatePage(uint8_t page);
     void InvalidateAddress(uint32_t address);
     void InvalidateAll();
     void AgeFullyPage(uint8_t page);
     void AgeFullyAddress(uint32_t address);
+    uint8_t Prefetch(uint32_t address, uint32_t length);
+    boolean WriteDeferred(uint32_t address, void* data, uint8_t len, uint32_t start, uint16_t length);
+    boolean IsWriteDeferred(uint32_t address);
+    boolean CancelDeferredWrite(uint32_t address);
+    uint8_t getWriteQueueDepth();
+    uint8_t getDeferredWriteCount();
+    uint32_t getPageWriteCount();
+    uint32_t getByteWriteCount();
+    uint16_t getBytesPerFlush();
+    uint32_t getByteReadCount();
+    uint32_t getHitCount();
+    uint32_t getMissCount();
+    uint32_t getStallTime();
+    uint32_t getWriteTimeoutCount();
+    void printStatistics();
 
     boolean Write(uint32_t address, uint8_t valu);
     boolean Write(uint32_t address, uint16_t valu);
@@ -85,15 +122,58 @@ private:
         uint8_t data[256];
         uint32_t address; //address of start of page
         uint8_t age; //
-        boolean dirty;
+        uint32_t dirtyBlocks; // bit mask of the modified blocks of the page (0 = page is not dirty)
+        boolean queued; // waiting for (or in) write-back to the EEPROM
+        boolean referenced; // accessed since the clock hand passed the last time
     } PageCache;
 
+    typedef struct
+    {
+        uint32_t address; // where the data is written to
+        uint32_t start; // start of the range which has to reach the EEPROM first
+        uint16_t length; // length of that range (0 = entry unused)
+        uint8_t size; // number of bytes in data
+        uint8_t data[DEFERRED_WRITE_SIZE];
+    } DeferredWrite;
+
     PageCache pages[NUM_CACHED_PAGES];
+    DeferredWrite deferredWrites[CFG_MEMCACHE_DEFERRED_WRITES];
+    uint8_t pageIndex[NUM_EEPROM_PAGES]; // maps an EEPROM page to its cache page (direct lookup instead of scanning the cache)
     uint8_t cache_hit(uint32_t address);
+    void cache_unmap(uint8_t page);
+    uint32_t cache_blockmask(uint16_t offset, uint16_t length);
     void cache_age();
     uint8_t cache_findpage();
+    uint8_t cache_clocksweep();
+    void cache_flushahead();
+    boolean cache_isclean(uint32_t start, uint16_t length);
+    void cache_deferredwrites();
+    boolean cache_hasfreepage();
     uint8_t cache_readpage(uint32_t addr);
-    boolean cache_writepage(uint8_t page);
+    void cache_queuepage(uint8_t page);
+    boolean cache_writeback();
+    void cache_waitforpage(uint8_t page);
+    boolean cache_writecomplete();
+    void cache_writechunk(uint8_t page, uint16_t offset, uint16_t length);
+
+    uint8_t writeQueue[WRITE_QUEUE_SIZE]; // cache pages waiting for write-back, the page at writeTail is being written
+    uint8_t writeHead, writeTail; // ring buffer pointers of writeQueue
+    boolean writeStarted; // the write-back of the page at writeTail has started
+    uint32_t writeBlocks; // dirty blocks of the page being written which still have to be sent
+    boolean writeBusy; // the EEPROM is busy with its internal write cycle
+    uint32_t writeTimestamp; // micros() when the last chunk was sent
+    uint8_t agingTicks; // ticks since the last aging cycle
+    EepromBackend *backend; // the storage medium
+    uint8_t clockHand; // next page to be checked for replacement
+    uint32_t hitCount; // number of accesses to cached pages
+    uint32_t missCount; // number of accesses which required to read a page
+    uint32_t evictionCount; // number of pages removed to make room for another page
+    uint32_t forcedFlushCount; // number of misses which had to wait for a write-back as no page was clean
+    uint32_t byteReadCount; // number of bytes read since start-up
+    uint32_t stallTime; // microseconds spent in blocking reads and write-back waits
+    uint32_t pageWriteCount; // number of pages written since start-up
+    uint32_t byteWriteCount; // number of bytes written since start-up
+    uint32_t writeTimeoutCount; // number of write cycles which were not acknowledged in time
 };
 
 extern MemCache memCache;
@@ -0,0 +1,266 @@
+/*
+ * MemoryMonitor.cpp
+ *
+ * Reports the usage of the RAM: stack high-water mark, heap usage and allocation counters
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "MemoryMonitor.h"
+#include <malloc.h>
+#include <newlib.h>
+
+extern "C" char *sbrk(int increment);
+extern char _end; // end of the static data (.data and .bss), the heap starts here
+
+#ifdef _NANO_MALLOC
+/*
+ * newlib-nano keeps the free chunks in one list, sorted by address
+ */
+struct FreeChunk {
+    long size; // bytes of the chunk incl. the size field
+    FreeChunk *next;
+};
+extern "C" FreeChunk *__malloc_free_list;
+#else
+/*
+ * newlib's malloc (Doug Lea's) keeps the free chunks in doubly linked lists (bins), each bin is a
+ * pair of pointers in __malloc_av_ which acts as the list head. Bin 0 holds the top chunk.
+ */
+struct FreeChunk {
+    size_t prevSize;
+    size_t size; // bytes of the chunk incl. the header, bit 0 = the previous chunk is in use
+    FreeChunk *fd, *bk;
+};
+#define MALLOC_BINS 128
+#define MALLOC_BIN(i) ((FreeChunk *) ((char *) &__malloc_av_[2 * (i) + 2] - 2 * sizeof(size_t)))
+extern "C" FreeChunk *__malloc_av_[MALLOC_BINS * 2 + 2];
+#endif
+
+MemoryMonitor memoryMonitor;
+
+/*
+ * Count the allocations of the C++ objects (Strings use malloc/realloc directly and are only
+ * visible in the heap usage).
+ */
+void *operator new(size_t size)
+{
+    memoryMonitor.countAllocation();
+    return malloc(size);
+}
+
+void *operator new[](size_t size)
+{
+    memoryMonitor.countAllocation();
+    return malloc(size);
+}
+
+void operator delete(void *pointer)
+{
+    memoryMonitor.countFree();
+    free(pointer);
+}
+
+void operator delete[](void *pointer)
+{
+    memoryMonitor.countFree();
+    free(pointer);
+}
+
+void operator delete(void *pointer, size_t size)
+{
+    memoryMonitor.countFree();
+    free(pointer);
+}
+
+void operator delete[](void *pointer, size_t size)
+{
+    memoryMonitor.countFree();
+    free(pointer);
+}
+
+MemoryMonitor::MemoryMonitor()
+{
+    paintStart = 0;
+    paintEnd = 0;
+    stackLow = MEMORY_RAM_END;
+    heapUsed = 0;
+    heapPeak = 0;
+    largestChunk = 0;
+    topChunk = 0;
+    // allocations and frees are not reset, global objects may allocate before this constructor runs (they're zero-initialized)
+}
+
+/*
+ * Paint the free RAM between the heap and the stack pointer. Should be called as early as
+ * possible in setup() so the stack usage of the start-up is included.
+ */
+void MemoryMonitor::setup()
+{
+    tickHandler.detach(this);
+
+    paintStart = (getHeapEnd() + 3) & ~3;
+    paintEnd = (__get_MSP() - MEMORY_STACK_MARGIN) & ~3;
+    for (uint32_t address = paintStart; address < paintEnd; address += 4) {
+        *(uint32_t *) address = MEMORY_PAINT;
+    }
+    if (paintEnd <= paintStart) { // the stack isn't above the heap, can't measure it
+        paintStart = paintEnd = 0;
+    }
+    stackLow = paintEnd;
+
+    tickHandler.attach(this, CFG_TICK_INTERVAL_MEMORY_MONITOR);
+}
+
+void MemoryMonitor::handleTick()
+{
+    sample();
+}
+
+void MemoryMonitor::countAllocation()
+{
+    allocations++;
+}
+
+void MemoryMonitor::countFree()
+{
+    frees++;
+}
+
+/*
+ * Update the stack high-water mark and the heap usage. The painted RAM is scanned upwards from
+ * the current end of the heap, the first overwritten word was written by the stack.
+ */
+void MemoryMonitor::sample()
+{
+    struct mallinfo info = mallinfo();
+
+    heapUsed = info.uordblks;
+    heapPeak = max(heapPeak, heapUsed);
+    largestChunk = findLargestChunk();
+#ifndef _NANO_MALLOC
+    topChunk = info.keepcost; // the size of the top chunk
+#endif
+
+    if (paintEnd > paintStart) {
+        uint32_t address = max(paintStart, (getHeapEnd() + 3) & ~3);
+        while (address < stackLow && *(uint32_t *) address == MEMORY_PAINT) {
+            address += 4;
+        }
+        stackLow = address;
+    }
+}
+
+/*
+ * Walk malloc's free lists and return the usable size of the largest free chunk (without the top
+ * chunk). Like malloc itself this must not be interrupted by code which allocates.
+ */
+uint32_t MemoryMonitor::findLargestChunk()
+{
+    uint32_t largest = 0;
+
+#ifdef _NANO_MALLOC
+    for (FreeChunk *chunk = __malloc_free_list; chunk != NULL; chunk = chunk->next) {
+        largest = max(largest, (uint32_t) chunk->size);
+    }
+#else
+    for (int i = 1; i < MALLOC_BINS; i++) {
+        FreeChunk *bin = MALLOC_BIN(i);
+        for (FreeChunk *chunk = bin->fd; chunk != bin; chunk = chunk->fd) {
+            largest = max(largest, (uint32_t) (chunk->size & ~1));
+        }
+    }
+#endif
+    return (largest > sizeof(size_t) ? largest - sizeof(size_t) : 0);
+}
+
+/*
+ * The current end of the heap (grows when malloc needs more memory, never shrinks)
+ */
+uint32_t MemoryMonitor::getHeapEnd()
+{
+    return (uint32_t) sbrk(0);
+}
+
+/*
+ * Max number of bytes used by the stack (high-water mark)
+ */
+uint32_t MemoryMonitor::getStackUsed()
+{
+    return MEMORY_RAM_END - stackLow;
+}
+
+/*
+ * Number of bytes currently allocated on the heap
+ */
+uint32_t MemoryMonitor::getHeapUsed()
+{
+    return heapUsed;
+}
+
+/*
+ * Number of bytes between the end of the heap and the deepest point the stack reached
+ */
+uint32_t MemoryMonitor::getGap()
+{
+    uint32_t heapEnd = getHeapEnd();
+
+    return (stackLow > heapEnd ? stackLow - heapEnd : 0);
+}
+
+/*
+ * Size of the largest block which can still be allocated: either a chunk of the free lists or
+ * the free end of the heap extended into the gap to the stack (approximately, malloc keeps a
+ * few bytes of the top chunk)
+ */
+uint32_t MemoryMonitor::getFree()
+{
+    return max(largestChunk, topChunk + getGap());
+}
+
+void MemoryMonitor::printReport(Print &printer)
+{
+    struct mallinfo info = mallinfo();
+    char buffer[80];
+
+    sample();
+    snprintf(buffer, sizeof(buffer), "RAM: %d bytes, static data: %d bytes", MEMORY_RAM_END - MEMORY_RAM_START,
+            (uint32_t) &_end - MEMORY_RAM_START);
+    printer.println(buffer);
+    snprintf(buffer, sizeof(buffer), "heap: %d bytes reserved, %d used (peak %d), %d free in %d fragments", info.arena, info.uordblks,
+            heapPeak, info.fordblks, info.ordblks);
+    printer.println(buffer);
+    snprintf(buffer, sizeof(buffer), "stack: %d bytes used (high-water mark), %d bytes now", getStackUsed(),
+            MEMORY_RAM_END - __get_MSP());
+    printer.println(buffer);
+    snprintf(buffer, sizeof(buffer), "free between heap and stack: %d bytes", getGap());
+    printer.println(buffer);
+    snprintf(buffer, sizeof(buffer), "largest free block: %d bytes (free lists: %d, end of heap: %d)", getFree(), largestChunk,
+            topChunk + getGap());
+    printer.println(buffer);
+    snprintf(buffer, sizeof(buffer), "new: %d, delete: %d, objects alive: %d", allocations, frees, allocations - frees);
+    printer.println(buffer);
+    if (paintEnd == 0) {
+        printer.println("stack painting not active, the stack values are unknown");
+    }
+}
@@ -0,0 +1,78 @@
+/*
+ * MemoryMonitor.h
+ *
+ * Reports the usage of the RAM: stack high-water mark, heap usage and allocation counters
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef MEMORY_MONITOR_H_
+#define MEMORY_MONITOR_H_
+
+#include <Arduino.h>
+#include "config.h"
+#include "TickHandler.h"
+
+#define MEMORY_RAM_START    0x20070000 // SRAM0 and SRAM1 of the SAM3X are mapped contiguously (96kB)
+#define MEMORY_RAM_END      0x20088000 // the stack starts at the end of the RAM and grows towards the heap
+#define MEMORY_PAINT        0xA5A5A5A5 // pattern painted into the free RAM to detect how deep the stack grew
+#define MEMORY_STACK_MARGIN 256 // bytes below the stack pointer which aren't painted (used by the painting itself)
+
+/*
+ * At start-up the free RAM between the heap and the stack is painted with a pattern. The lowest
+ * overwritten word marks the deepest stack usage (high-water mark). The heap usage is taken from
+ * malloc's statistics and free lists, new/delete are counted. The values are sampled every tick
+ * so they can be sent as telemetry without scanning the RAM each time.
+ */
+class MemoryMonitor: public TickObserver
+{
+public:
+    MemoryMonitor();
+    void setup();
+    void handleTick();
+    void countAllocation();
+    void countFree();
+    uint32_t getStackUsed();
+    uint32_t getHeapUsed();
+    uint32_t getFree();
+    uint32_t getGap();
+    void printReport(Print &printer);
+
+private:
+    uint32_t paintStart, paintEnd; // the painted range of the RAM
+    uint32_t stackLow; // lowest address the stack reached (high-water mark)
+    uint32_t heapUsed; // bytes allocated on the heap at the last sample
+    uint32_t heapPeak; // max bytes allocated on the heap
+    uint32_t largestChunk; // bytes of the largest chunk in malloc's free lists at the last sample
+    uint32_t topChunk; // bytes of the free chunk at the end of the heap which malloc extends with sbrk()
+    uint32_t allocations; // number of calls to new
+    uint32_t frees; // number of calls to delete
+
+    uint32_t getHeapEnd();
+    uint32_t findLargestChunk();
+    void sample();
+};
+
+extern MemoryMonitor memoryMonitor;
+
+#endif /* MEMORY_MONITOR_H_ */
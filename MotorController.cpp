@@ -27,6 +27,7 @@
  */
 
 #include "MotorController.h"
+#include "SignalRecorder.h"
 
 MotorController::MotorController() :
         Device()
@@ -447,6 +448,7 @@ void MotorController::handleTick()
     updateGear();
 
     updateStatusIndicator();
+    signalRecorder.sample();
 }
 
 void MotorController::handleCanFrame(CAN_FRAME *frame)
@@ -579,6 +581,32 @@ int16_t MotorController::getCruiseControlSpeed()
     return cruiseSpeedTarget;
 }
 
+/*
+ * Schema of the motor controller configuration (EEPROM address, member, type, default, version)
+ */
+const PrefField MotorController::configurationSchema[] = {
+    PREF_FIELD(EEMC_INVERT_DIRECTION, MotorControllerConfiguration, invertDirection, PREF_BOOL, false, 0),
+    PREF_FIELD(EEMC_MAX_RPM, MotorControllerConfiguration, speedMax, PREF_UINT16, 6000, 0),
+    PREF_FIELD(EEMC_MAX_TORQUE, MotorControllerConfiguration, torqueMax, PREF_UINT16, 3000, 0),
+    PREF_FIELD(EEMC_SLEW_RATE_REGEN, MotorControllerConfiguration, slewRateRegen, PREF_UINT16, 0, 0),
+    PREF_FIELD(EEMC_SLEW_RATE_MOTOR, MotorControllerConfiguration, slewRateMotor, PREF_UINT16, 0, 0),
+    PREF_FIELD(EEMC_MAX_MECH_POWER_MOTOR, MotorControllerConfiguration, maxMechanicalPowerMotor, PREF_UINT16, 2000, 0),
+    PREF_FIELD(EEMC_MAX_MECH_POWER_REGEN, MotorControllerConfiguration, maxMechanicalPowerRegen, PREF_UINT16, 400, 0),
+    PREF_FIELD(EEMC_REVERSE_LIMIT, MotorControllerConfiguration, reversePercent, PREF_UINT8, 50, 0),
+    PREF_FIELD(EEMC_NOMINAL_V, MotorControllerConfiguration, nominalVolt, PREF_UINT16, 3300, 0),
+    PREF_FIELD(EEMC_POWER_MODE, MotorControllerConfiguration, powerMode, PREF_ENUM, modeTorque, 0),
+    PREF_FIELD(EEMC_CREEP_LEVEL, MotorControllerConfiguration, creepLevel, PREF_UINT8, 0, 0),
+    PREF_FIELD(EEMC_CREEP_SPEED, MotorControllerConfiguration, creepSpeed, PREF_UINT16, 0, 0),
+    PREF_FIELD(EEMC_BRAKE_HOLD, MotorControllerConfiguration, brakeHold, PREF_UINT8, 0, 0),
+    PREF_FIELD(EEMC_BRAKE_HOLD_COEFF, MotorControllerConfiguration, brakeHoldForceCoefficient, PREF_UINT8, 10, 0),
+    PREF_FIELD(EEMC_CRUISE_KP, MotorControllerConfiguration, cruiseKp, PREF_MILLI, 500, 0),
+    PREF_FIELD(EEMC_CRUISE_KI, MotorControllerConfiguration, cruiseKi, PREF_MILLI, 200, 0),
+    PREF_FIELD(EEMC_CRUISE_KD, MotorControllerConfiguration, cruiseKd, PREF_MILLI, 20, 0),
+    PREF_FIELD(EEMC_CRUISE_LONG_PRESS_DELTA, MotorControllerConfiguration, cruiseLongPressDelta, PREF_UINT16, 500, 0),
+    PREF_FIELD(EEMC_CRUISE_STEP_DELTA, MotorControllerConfiguration, cruiseStepDelta, PREF_UINT16, 300, 0),
+    PREF_FIELD(EEMC_CRUISE_USE_RPM, MotorControllerConfiguration, cruiseUseRpm, PREF_BOOL, true, 0)
+};
+
 void MotorController::loadConfiguration()
 {
     MotorControllerConfiguration *config = (MotorControllerConfiguration*) getConfiguration();
@@ -586,61 +614,7 @@ void MotorController::loadConfiguration()
     Device::loadConfiguration(); // call parent
     logger.info(this, "Motor controller configuration:");
 
-#ifdef USE_HARD_CODED
-
-    if (false) {
-#else
-
-    if (prefsHandler->checksumValid()) { //checksum is good, read in the values stored in EEPROM
-#endif
-        uint8_t temp;
-        uint16_t value;
-        prefsHandler->read(EEMC_INVERT_DIRECTION, &temp);
-        config->invertDirection = temp;
-        prefsHandler->read(EEMC_MAX_RPM, &config->speedMax);
-        prefsHandler->read(EEMC_MAX_TORQUE, &config->torqueMax);
-        prefsHandler->read(EEMC_SLEW_RATE_REGEN, &config->slewRateRegen);
-        prefsHandler->read(EEMC_SLEW_RATE_MOTOR, &config->slewRateMotor);
-        prefsHandler->read(EEMC_MAX_MECH_POWER_MOTOR, &config->maxMechanicalPowerMotor);
-        prefsHandler->read(EEMC_MAX_MECH_POWER_REGEN, &config->maxMechanicalPowerRegen);
-        prefsHandler->read(EEMC_REVERSE_LIMIT, &config->reversePercent);
-        prefsHandler->read(EEMC_NOMINAL_V, &config->nominalVolt);
-        prefsHandler->read(EEMC_POWER_MODE, (uint8_t*) &config->powerMode);
-        prefsHandler->read(EEMC_CREEP_LEVEL, &config->creepLevel);
-        prefsHandler->read(EEMC_CREEP_SPEED, &config->creepSpeed);
-        prefsHandler->read(EEMC_BRAKE_HOLD, &config->brakeHold);
-        prefsHandler->read(EEMC_BRAKE_HOLD_COEFF, &config->brakeHoldForceCoefficient);
-        prefsHandler->read(EEMC_CRUISE_KP, &value);
-        config->cruiseKp = value / 1000.0f;
-        prefsHandler->read(EEMC_CRUISE_KI, &value);
-        config->cruiseKi = value / 1000.0f;
-        prefsHandler->read(EEMC_CRUISE_KD, &value);
-        config->cruiseKd = value / 1000.0f;
-        prefsHandler->read(EEMC_CRUISE_LONG_PRESS_DELTA, &config->cruiseLongPressDelta);
-        prefsHandler->read(EEMC_CRUISE_STEP_DELTA, &config->cruiseStepDelta);
-        prefsHandler->read(EEMC_CRUISE_USE_RPM, &temp);
-        config->cruiseUseRpm = temp;
-    } else { //checksum invalid. Reinitialize values and store to EEPROM
-        config->invertDirection = false;
-        config->speedMax = 6000;
-        config->torqueMax = 3000;
-        config->slewRateRegen = 0;
-        config->slewRateMotor = 0;
-        config->maxMechanicalPowerMotor = 2000;
-        config->maxMechanicalPowerRegen = 400;
-        config->reversePercent = 50;
-        config->nominalVolt = 3300;
-        config->powerMode = modeTorque;
-        config->creepLevel = 0;
-        config->creepSpeed = 0;
-        config->brakeHold = 0;
-        config->cruiseKp = .5f;
-        config->cruiseKi = .2f;
-        config->cruiseKd = .02f;
-        config->cruiseLongPressDelta = 500;
-        config->cruiseStepDelta = 300;
-        config->cruiseUseRpm = true;
-    }
+    prefsHandler->load(config, configurationSchema, sizeof(configurationSchema) / sizeof(PrefField));
 
     //TODO move to eeprom config?
     config->speedSet[0] = 1800;
@@ -668,26 +642,7 @@ void MotorController::saveConfiguration()
 
     Device::saveConfiguration(); // call parent
 
-    prefsHandler->write(EEMC_INVERT_DIRECTION, (uint8_t) (config->invertDirection ? 1 : 0));
-    prefsHandler->write(EEMC_MAX_RPM, config->speedMax);
-    prefsHandler->write(EEMC_MAX_TORQUE, config->torqueMax);
-    prefsHandler->write(EEMC_SLEW_RATE_REGEN, config->slewRateRegen);
-    prefsHandler->write(EEMC_SLEW_RATE_MOTOR, config->slewRateMotor);
-    prefsHandler->write(EEMC_MAX_MECH_POWER_MOTOR, config->maxMechanicalPowerMotor);
-    prefsHandler->write(EEMC_MAX_MECH_POWER_REGEN, config->maxMechanicalPowerRegen);
-    prefsHandler->write(EEMC_REVERSE_LIMIT, config->reversePercent);
-    prefsHandler->write(EEMC_NOMINAL_V, config->nominalVolt);
-    prefsHandler->write(EEMC_POWER_MODE, (uint8_t) config->powerMode);
-    prefsHandler->write(EEMC_CREEP_LEVEL, config->creepLevel);
-    prefsHandler->write(EEMC_CREEP_SPEED, config->creepSpeed);
-    prefsHandler->write(EEMC_BRAKE_HOLD, config->brakeHold);
-    prefsHandler->write(EEMC_BRAKE_HOLD_COEFF, config->brakeHoldForceCoefficient);
-    prefsHandler->write(EEMC_CRUISE_KP, (uint16_t) (config->cruiseKp * 1000));
-    prefsHandler->write(EEMC_CRUISE_KI, (uint16_t) (config->cruiseKi * 1000));
-    prefsHandler->write(EEMC_CRUISE_KD, (uint16_t) (config->cruiseKd * 1000));
-    prefsHandler->write(EEMC_CRUISE_LONG_PRESS_DELTA, config->cruiseLongPressDelta);
-    prefsHandler->write(EEMC_CRUISE_STEP_DELTA, config->cruiseStepDelta);
-    prefsHandler->write(EEMC_CRUISE_USE_RPM, (uint8_t) (config->cruiseUseRpm ? 1 : 0));
+    prefsHandler->save(config, configurationSchema, sizeof(configurationSchema) / sizeof(PrefField));
 
     prefsHandler->saveChecksum();
 }
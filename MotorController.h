@@ -138,6 +138,7 @@ protected:
     void reportActivity();
 
 private:
+    static const PrefField configurationSchema[];
     int16_t throttleLevel; // -1000 to 1000 (per mille of throttle level)
     int16_t torqueRequested; // in 0.1 Nm, calculated in MotorController - must not be manipulated by subclasses
     int16_t speedRequested; // in rpm, calculated in MotorController - must not be manipulated by subclasses
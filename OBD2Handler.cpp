@@ -36,6 +36,26 @@ OBD2Handler::OBD2Handler()
     accelPedal = (Throttle*) deviceManager.getAccelerator();
     brakePedal = (Throttle*) deviceManager.getBrake();
     BMS = (BatteryManager*) deviceManager.getDeviceByType(DEVICE_BMS);
+
+    extendedTimestamp = 0;
+    extendedValid = false;
+    dcVoltageMin = dcCurrentMin = INT16_MAX;
+    dcVoltageMax = dcCurrentMax = temperatureMotorMax = temperatureControllerMax = INT16_MIN;
+}
+
+/*
+ * Start tracking the min/max values, they're sampled by a tick so peaks are also seen while no
+ * tester polls the values
+ */
+void OBD2Handler::setup()
+{
+    tickHandler.detach(this);
+    tickHandler.attach(this, CFG_TICK_INTERVAL_OBD2_LIMITS);
+}
+
+void OBD2Handler::handleTick()
+{
+    updateLimits();
 }
 
 OBD2Handler *OBD2Handler::getInstance()
@@ -47,10 +67,11 @@ OBD2Handler *OBD2Handler::getInstance()
 /*
 Public method to process OBD2 requests.
     inData is whatever payload the request might need to have sent - it's OK to be NULL if this is a run of the mill PID request with no payload
-    outData should be a preallocated buffer of at least 6 bytes. The format is as follows:
-    outData[0] is the length of the data actually returned
+    outData should be a preallocated buffer of CFG_OBD2_MAX_RESPONSE_SIZE bytes. The format is as follows:
+    outData[0] is the number of bytes following (mode, PID(s) and data) - same as the ISO-TP length
     outData[1] is the returned mode (input mode + 0x40)
-    there after, the rest of the bytes are the data requested. This should be 1-5 bytes
+    there after, the PID(s) and the data requested. For mode 1 this is one PID byte and 1-4 data bytes,
+    for mode 0x22 the response may be longer than a single CAN frame (see CanOBD2).
 
     SAE standard says that this is the format for SAE requests to us:
     byte 0 = # of bytes following
@@ -81,6 +102,11 @@ Public method to process OBD2 requests.
     0x62 = Actual Torque delivered (A-125) - Percentage
     0x63 = Reference torque for engine - presumably max torque - A*256 + B - Nm
 
+    Mode 2
+    Same PIDs as mode 1 but with the values captured when a fault was raised (FaultHandler freeze frames).
+    byte 3 of the request = frame number (0 = most recent un-acknowledged fault). Supported are PID 0, 2 (DTC
+    which caused the frame) and 5, 0x0C and 0x11 if the corresponding value is part of CFG_FREEZE_FRAME_VALUES.
+
     Mode 3
     Returns DTC (diag trouble codes) - Three per frame
     bits 6-7 = DTC first character (00 = P = Powertrain, 01=C=Chassis, 10=B=Body, 11=U=Network)
@@ -92,19 +118,16 @@ Public method to process OBD2 requests.
     0x0 = Mode 9 pids supported (same scheme as mode 1)
     0x9 = How long is ECU name returned by 0x0A?
     0xA = ASCII string of ECU name. 20 characters are to be returned, I believe 4 at a time
+
+    Mode 0x22
+    Read data by identifier with two byte PIDs (see OBD2Handler::ExtendedPid). A request may contain
+    several PIDs, the response then contains each PID followed by its data. Unknown PIDs or values
+    of devices which are not available are skipped.
 */
 bool OBD2Handler::processRequest(byte *inData, byte *outData)
 {
     bool ret = false;
 
-    outData[2] = inData[2]; //copy standard PID
-    outData[0] = 2;
-
-    if (inData[1] > 0x50) {
-        outData[3] = inData[3]; //if using proprietary PIDs then copy second byte too
-        outData[0] = 3;
-    }
-
     uint8_t mode = inData[1];
     uint16_t pid;
     if (mode < 10) {
@@ -114,27 +137,38 @@ bool OBD2Handler::processRequest(byte *inData, byte *outData)
     }
 
     switch (mode) {
-        case 1: //show current data
+        case OBD2_MODE_SHOW_DATA: //show current data
             ret = processShowData(pid, inData, outData);
-            outData[1] = mode + 0x40;
+            outData[0] += 2; // add mode and pid to the data length
+            outData[1] = mode + OBD2_RESPONSE_OFFSET;
             outData[2] = pid;
             break;
 
-        case 2: //show freeze frame data - not sure we'll be supporting this
+        case OBD2_MODE_FREEZE_FRAME: //show freeze frame data - the values captured when the n-th most recent fault was raised
+            ret = processShowFreezeFrame(pid, inData[3], outData);
+            if (ret) {
+                outData[0] += 3; // add mode, pid and frame number to the data length
+                outData[1] = mode + OBD2_RESPONSE_OFFSET;
+                outData[2] = pid;
+                outData[3] = inData[3];
+            }
             break;
 
-        case 3: //show stored diagnostic codes - we can probably map our faults to some existing DTC codes or roll our own
+        case OBD2_MODE_STORED_DTC: //show stored diagnostic codes - the fault codes of FaultHandler are already in DTC format
+        case OBD2_MODE_PENDING_DTC: //show pending diag codes - we report the faults which are still ongoing
+            ret = processShowTroubleCodes(mode, outData);
             break;
 
-        case 4: //clear diagnostic trouble codes - If we get this frame we just clear all codes no questions asked.
+        case OBD2_MODE_CLEAR_DTC: //clear diagnostic trouble codes - If we get this frame we just clear all codes no questions asked.
+            faultHandler.clearFaults();
+            outData[0] = 1;
+            outData[1] = mode + OBD2_RESPONSE_OFFSET;
+            ret = true;
             break;
 
         case 6: //test results over CANBus (this replaces mode 5 from non-canbus) - I know nothing of this
             break;
 
-        case 7: //show pending diag codes (current or last driving cycle) - Might just overlap with mode 3
-            break;
-
         case 8: //control operation of on-board systems - this sounds really proprietary and dangerous. Maybe ignore this?
             break;
 
@@ -143,6 +177,10 @@ bool OBD2Handler::processRequest(byte *inData, byte *outData)
 
         case 0x20: //custom PID codes we made up for GEVCU
             break;
+
+        case OBD2_MODE_READ_DATA_BY_ID: //extended PIDs, covering all values GEVCU knows about
+            ret = processReadDataById(inData, outData);
+            break;
     }
 
     return ret;
@@ -167,15 +205,29 @@ bool OBD2Handler::processShowData(uint16_t pid, byte *inData, byte *outData)
 
         case 1: //Returns 32 bits but we really can only support the first byte which has bit 7 = Malfunction? Bits 0-6 = # of DTCs
             outData[0] = 4;
-            outData[3] = 0; //TODO: We aren't properly keeping track of faults yet but when we do fix this.
+            {
+                uint16_t codes[CFG_FAULT_HISTORY_SIZE];
+                outData[3] = faultHandler.getDiagnosticTroubleCodes(codes, CFG_FAULT_HISTORY_SIZE, false) | (faultHandler.isFaultOngoing() ? 0x80 : 0);
+            }
             outData[4] = 0; //these next three are really related to ICE diagnostics
             outData[5] = 0; //so ignore them.
             outData[6] = 0;
             return true;
             break;
 
-        case 2: //Freeze DTC
-            return false; //don't support freeze framing yet. Might be useful in the future.
+        case 2: //Freeze DTC - the code of the most recent fault with a freeze frame
+            {
+                FAULT fault;
+                int faultnum = faultHandler.getRecentFault(0);
+                outData[0] = 2;
+                outData[3] = 0;
+                outData[4] = 0;
+                if (faultnum != -1 && faultHandler.getFault(faultnum, &fault)) {
+                    outData[3] = fault.faultCode >> 8;
+                    outData[4] = fault.faultCode & 0xFF;
+                }
+            }
+            return true;
             break;
 
         case 4: //Calculated engine load (A * 100 / 255) - Percentage
@@ -318,4 +370,337 @@ bool OBD2Handler::processShowCustomData(uint16_t pid, byte *inData, byte *outDat
     return false;
 }
 
+/*
+ * Report the distinct codes of the un-acknowledged (mode 03) or ongoing (mode 07) faults.
+ * The response contains the number of DTC's followed by two bytes per DTC (as in ISO 15765-4).
+ */
+bool OBD2Handler::processShowTroubleCodes(uint8_t mode, byte *outData)
+{
+    uint16_t codes[(CFG_OBD2_MAX_RESPONSE_SIZE - 3) / 2];
+    uint8_t count = faultHandler.getDiagnosticTroubleCodes(codes, (CFG_OBD2_MAX_RESPONSE_SIZE - 3) / 2, mode == OBD2_MODE_PENDING_DTC);
+
+    outData[0] = 2 + count * 2;
+    outData[1] = mode + OBD2_RESPONSE_OFFSET;
+    outData[2] = count;
+    for (int i = 0; i < count; i++) {
+        outData[3 + i * 2] = codes[i] >> 8;
+        outData[4 + i * 2] = codes[i] & 0xFF;
+    }
+    return true;
+}
+
+/*
+ * Report a value of a freeze frame (mode 02). The frame number selects the n-th most recent
+ * un-acknowledged fault. PID 0x02 returns the DTC which caused the freeze frame, the other PIDs
+ * are encoded like in mode 01 and are only available if the value is part of CFG_FREEZE_FRAME_VALUES.
+ * The data is stored at outData[4], outData[0] receives its length.
+ */
+bool OBD2Handler::processShowFreezeFrame(uint16_t pid, uint8_t frame, byte *outData)
+{
+    FAULT fault;
+    int16_t value;
+    int temp;
+
+    int faultnum = faultHandler.getRecentFault(frame);
+    if (faultnum == -1 || !faultHandler.getFault(faultnum, &fault)) {
+        return false;
+    }
+
+    switch (pid) {
+        case 0: { //pids supported: 0x02 and those of 0x05, 0x0C, 0x11 whose value is part of the freeze frame
+            static const struct {
+                uint8_t pid;
+                FreezeFrameValue value;
+            } framePids[] = { { 0x05, FF_TEMPERATURE_CONTROLLER }, { 0x0C, FF_SPEED_ACTUAL }, { 0x11, FF_THROTTLE } };
+
+            outData[0] = 4;
+            outData[4] = 0b01000000; //pid 0x02 - starting with pid 0x01 in the MSB
+            outData[5] = 0;
+            outData[6] = 0;
+            outData[7] = 0;
+            for (uint8_t i = 0; i < sizeof(framePids) / sizeof(framePids[0]); i++) {
+                if (getFreezeFrameValue(&fault, framePids[i].value, &value)) {
+                    outData[4 + (framePids[i].pid - 1) / 8] |= 0x80 >> ((framePids[i].pid - 1) % 8);
+                }
+            }
+            return true;
+        }
+
+        case 2: //DTC that caused the freeze frame
+            outData[0] = 2;
+            outData[4] = fault.faultCode >> 8;
+            outData[5] = fault.faultCode & 0xFF;
+            return true;
+
+        case 5: //Engine Coolant Temp (A - 40) = Degrees Centigrade
+            if (!getFreezeFrameValue(&fault, FF_TEMPERATURE_CONTROLLER, &value)) {
+                return false;
+            }
+            temp = constrain(value / 10, -40, 215) + 40;
+            outData[0] = 1;
+            outData[4] = (uint8_t) temp;
+            return true;
+
+        case 0xC: //Engine RPM (A * 256 + B) / 4
+            if (!getFreezeFrameValue(&fault, FF_SPEED_ACTUAL, &value)) {
+                return false;
+            }
+            temp = value * 4;
+            outData[0] = 2;
+            outData[4] = (uint8_t)(temp / 256);
+            outData[5] = (uint8_t)(temp);
+            return true;
+
+        case 0x11: //Throttle position (A * 100 / 255) - Percentage
+            if (!getFreezeFrameValue(&fault, FF_THROTTLE, &value)) {
+                return false;
+            }
+            temp = (255 * max(value / 10, 0)) / 100;
+            outData[0] = 1;
+            outData[4] = (uint8_t)(temp);
+            return true;
+    }
+    return false;
+}
+
+/*
+ * Look up a value in the freeze frame of a fault, returns false if it's not captured
+ */
+bool OBD2Handler::getFreezeFrameValue(FAULT *fault, FreezeFrameValue value, int16_t *result)
+{
+    for (uint8_t i = 0; i < CFG_FREEZE_FRAME_SIZE; i++) {
+        if (FaultHandler::getFreezeFrameValue(i) == value) {
+            *result = fault->freezeFrame.values[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Process a mode 0x22 request which may contain multiple 2 byte PIDs (inData[0] = number of following bytes).
+ * The requested values are copied from the cache which is refreshed at most every CFG_OBD2_EXTENDED_CACHE_TIME ms,
+ * so a client polling many PIDs causes no additional load on the devices.
+ */
+bool OBD2Handler::processReadDataById(byte *inData, byte *outData)
+{
+    uint8_t length = 1; // the mode byte
+
+    if (!extendedValid || (millis() - extendedTimestamp) >= CFG_OBD2_EXTENDED_CACHE_TIME) {
+        refreshExtendedData();
+    }
+
+    outData[1] = OBD2_MODE_READ_DATA_BY_ID + OBD2_RESPONSE_OFFSET;
+    for (uint8_t i = 2; i < inData[0]; i += 2) {
+        uint16_t pid = inData[i] * 256 + inData[i + 1];
+        uint16_t index = pid - OBD2_EXT_PID_BASE;
+
+        if (pid < OBD2_EXT_PID_BASE || index >= EXT_PID_COUNT || extendedLength[index] == 0) {
+            continue;
+        }
+        if (length + 3 + extendedLength[index] > CFG_OBD2_MAX_RESPONSE_SIZE) {
+            break; // response is full, ignore remaining PIDs
+        }
+        outData[length + 1] = inData[i];
+        outData[length + 2] = inData[i + 1];
+        memcpy(outData + length + 3, extendedData[index], extendedLength[index]);
+        length += 2 + extendedLength[index];
+    }
+
+    if (length == 1) {
+        return false; // none of the requested PIDs is supported
+    }
+    outData[0] = length;
+    return true;
+}
+
+/*
+ * Encode all mode 0x22 values into the response cache. Values of devices which are not present
+ * are marked as unavailable (length 0).
+ */
+void OBD2Handler::refreshExtendedData()
+{
+    MotorController* motorController = deviceManager.getMotorController();
+    BatteryManager* batteryManager = deviceManager.getBatteryManager();
+    DcDcConverter* dcDcConverter = deviceManager.getDcDcConverter();
+    Charger* charger = deviceManager.getCharger();
+
+    memset(extendedLength, 0, sizeof(extendedLength));
+    extendedTimestamp = millis();
+    extendedValid = true;
+
+    setExtendedData(EXT_PID_SYSTEM_STATE, status.getSystemState(), 1);
+    setExtendedData(EXT_PID_TIME_RUNNING, extendedTimestamp / 1000, 4);
+    setExtendedData(EXT_PID_BITFIELD_MOTOR, status.getBitFieldMotor(), 4);
+    setExtendedData(EXT_PID_BITFIELD_BMS, status.getBitFieldBms(), 4);
+    setExtendedData(EXT_PID_BITFIELD_IO, status.getBitFieldIO(), 4);
+
+    if (motorController) {
+        int16_t dcVoltage = motorController->getDcVoltage();
+        int16_t dcCurrent = motorController->getDcCurrent();
+        if (batteryManager && batteryManager->hasPackVoltage()) {
+            dcVoltage = batteryManager->getPackVoltage();
+        }
+        if (batteryManager && batteryManager->hasPackCurrent()) {
+            dcCurrent = batteryManager->getPackCurrent();
+        }
+
+        setExtendedData(EXT_PID_THROTTLE, motorController->getThrottleLevel(), 2);
+        setExtendedData(EXT_PID_TORQUE_ACTUAL, motorController->getTorqueActual(), 2);
+        setExtendedData(EXT_PID_TORQUE_AVAILABLE, motorController->getTorqueAvailable(), 2);
+        setExtendedData(EXT_PID_SPEED_ACTUAL, motorController->getSpeedActual(), 2);
+        setExtendedData(EXT_PID_DC_VOLTAGE, dcVoltage, 2);
+        setExtendedData(EXT_PID_DC_CURRENT, dcCurrent, 2);
+        setExtendedData(EXT_PID_AC_CURRENT, motorController->getAcCurrent(), 2);
+        setExtendedData(EXT_PID_MECHANICAL_POWER, motorController->getMechanicalPower(), 2);
+        setExtendedData(EXT_PID_TEMPERATURE_MOTOR, motorController->getTemperatureMotor(), 2);
+        setExtendedData(EXT_PID_TEMPERATURE_CONTROLLER, motorController->getTemperatureController(), 2);
+        setExtendedData(EXT_PID_CRUISE_CONTROL_SPEED, motorController->getCruiseControlSpeed(), 2);
+
+        updateLimits();
+        setExtendedLimits(dcVoltageMin, dcVoltageMax, EXT_PID_DC_VOLTAGE_MIN, EXT_PID_DC_VOLTAGE_MAX);
+        setExtendedLimits(dcCurrentMin, dcCurrentMax, EXT_PID_DC_CURRENT_MIN, EXT_PID_DC_CURRENT_MAX);
+        setExtendedLimits(0, temperatureMotorMax, EXT_PID_COUNT, EXT_PID_TEMPERATURE_MOTOR_MAX);
+        setExtendedLimits(0, temperatureControllerMax, EXT_PID_COUNT, EXT_PID_TEMPERATURE_CONTROLLER_MAX);
+    }
+
+    if (batteryManager) {
+        if (batteryManager->hasSoc()) {
+            setExtendedData(EXT_PID_SOC, batteryManager->getSoc(), 1);
+        }
+        if (batteryManager->hasDischargeLimit()) {
+            setExtendedData(EXT_PID_DISCHARGE_LIMIT, batteryManager->getDischargeLimit(), 2);
+        }
+        if (batteryManager->hasChargeLimit()) {
+            setExtendedData(EXT_PID_CHARGE_LIMIT, batteryManager->getChargeLimit(), 2);
+        }
+        setExtendedData(EXT_PID_CHARGE_DISCHARGE_ALLOWED, (batteryManager->isChargeAllowed() ? 1 : 0) | (batteryManager->isDischargeAllowed() ? 2 : 0), 1);
+        if (batteryManager->hasCellTemperatures()) {
+            setExtendedData(EXT_PID_LOWEST_CELL_TEMP, batteryManager->getLowestCellTemp(), 2);
+            setExtendedData(EXT_PID_HIGHEST_CELL_TEMP, batteryManager->getHighestCellTemp(), 2);
+            setExtendedData(EXT_PID_CELL_TEMP_IDS, batteryManager->getLowestCellTempId() << 8 | batteryManager->getHighestCellTempId(), 2);
+        }
+        if (batteryManager->hasCellVoltages()) {
+            setExtendedData(EXT_PID_LOWEST_CELL_VOLTS, batteryManager->getLowestCellVolts(), 2);
+            setExtendedData(EXT_PID_HIGHEST_CELL_VOLTS, batteryManager->getHighestCellVolts(), 2);
+            setExtendedData(EXT_PID_AVERAGE_CELL_VOLTS, batteryManager->getAverageCellVolts(), 2);
+            setExtendedData(EXT_PID_CELL_VOLTS_IDS, batteryManager->getLowestCellVoltsId() << 8 | batteryManager->getHighestCellVoltsId(), 2);
+        }
+        if (batteryManager->hasCellResistance()) {
+            setExtendedData(EXT_PID_LOWEST_CELL_RESISTANCE, batteryManager->getLowestCellResistance(), 2);
+            setExtendedData(EXT_PID_HIGHEST_CELL_RESISTANCE, batteryManager->getHighestCellResistance(), 2);
+            setExtendedData(EXT_PID_AVERAGE_CELL_RESISTANCE, batteryManager->getAverageCellResistance(), 2);
+            setExtendedData(EXT_PID_CELL_RESISTANCE_IDS, batteryManager->getLowestCellResistanceId() << 8 | batteryManager->getHighestCellResistanceId(), 2);
+        }
+        if (batteryManager->hasPackResistance()) {
+            setExtendedData(EXT_PID_PACK_RESISTANCE, batteryManager->getPackResistance(), 2);
+        }
+        if (batteryManager->hasPackHealth()) {
+            setExtendedData(EXT_PID_PACK_HEALTH, batteryManager->getPackHealth(), 1);
+        }
+        if (batteryManager->hasPackCycles()) {
+            setExtendedData(EXT_PID_PACK_CYCLES, batteryManager->getPackCycles(), 2);
+        }
+        setExtendedData(EXT_PID_BMS_TEMPERATURE, batteryManager->getSystemTemperature(), 1);
+    }
+
+    if (dcDcConverter) {
+        setExtendedData(EXT_PID_DCDC_HV_VOLTAGE, dcDcConverter->getHvVoltage(), 2);
+        setExtendedData(EXT_PID_DCDC_HV_CURRENT, dcDcConverter->getHvCurrent(), 2);
+        setExtendedData(EXT_PID_DCDC_LV_VOLTAGE, dcDcConverter->getLvVoltage(), 2);
+        setExtendedData(EXT_PID_DCDC_LV_CURRENT, dcDcConverter->getLvCurrent(), 2);
+        setExtendedData(EXT_PID_DCDC_TEMPERATURE, dcDcConverter->getTemperature(), 2);
+    }
+
+    if (charger) {
+        setExtendedData(EXT_PID_CHARGER_INPUT_VOLTAGE, charger->getInputVoltage(), 2);
+        setExtendedData(EXT_PID_CHARGER_INPUT_CURRENT, charger->getInputCurrent(), 2);
+        setExtendedData(EXT_PID_CHARGER_BATTERY_VOLTAGE, charger->getBatteryVoltage(), 2);
+        setExtendedData(EXT_PID_CHARGER_BATTERY_CURRENT, charger->getBatteryCurrent(), 2);
+        setExtendedData(EXT_PID_CHARGER_TEMPERATURE, charger->getTemperature(), 2);
+        if (status.getSystemState() == Status::charging) {
+            setExtendedData(EXT_PID_CHARGER_TIME_REMAINING, charger->calculateTimeRemaining(), 2);
+            setExtendedData(EXT_PID_CHARGER_MAX_INPUT_CURRENT, charger->calculateMaximumInputCurrent(), 2);
+        }
+    }
+
+    setExtendedData(EXT_PID_HEATER_POWER, status.heaterPower, 2);
+    setExtendedData(EXT_PID_FLOW_COOLANT, status.flowCoolant, 2);
+    setExtendedData(EXT_PID_FLOW_HEATER, status.flowHeater, 2);
+    if (status.heaterTemperature != CFG_NO_TEMPERATURE_DATA) {
+        setExtendedData(EXT_PID_HEATER_TEMPERATURE, status.heaterTemperature, 2);
+    }
+    if (status.temperatureCoolant != CFG_NO_TEMPERATURE_DATA) {
+        setExtendedData(EXT_PID_TEMPERATURE_COOLANT, status.temperatureCoolant, 2);
+    }
+    if (status.temperatureExterior != CFG_NO_TEMPERATURE_DATA) {
+        setExtendedData(EXT_PID_TEMPERATURE_EXTERIOR, status.temperatureExterior, 2);
+    }
+    for (int i = 0; i < CFG_NUMBER_BATTERY_TEMPERATURE_SENSORS; i++) {
+        if (status.temperatureBattery[i] != CFG_NO_TEMPERATURE_DATA) {
+            setExtendedData((ExtendedPid) (EXT_PID_TEMPERATURE_BATTERY + i), status.temperatureBattery[i], 2);
+        }
+    }
+}
+
+/*
+ * Store a value big endian with the given length (1-4 bytes) in the response cache
+ */
+void OBD2Handler::setExtendedData(ExtendedPid pid, uint32_t value, uint8_t length)
+{
+    for (uint8_t i = 0; i < length; i++) {
+        extendedData[pid][i] = (value >> (8 * (length - 1 - i))) & 0xFF;
+    }
+    extendedLength[pid] = length;
+}
+
+/*
+ * Update the min/max values seen since start-up with the current values (the same as in
+ * refreshExtendedData()). Called from the tick and before the values are reported.
+ */
+void OBD2Handler::updateLimits()
+{
+    MotorController* motorController = deviceManager.getMotorController();
+    BatteryManager* batteryManager = deviceManager.getBatteryManager();
+
+    if (!motorController) {
+        return;
+    }
+    int16_t dcVoltage = motorController->getDcVoltage();
+    int16_t dcCurrent = motorController->getDcCurrent();
+    if (batteryManager && batteryManager->hasPackVoltage()) {
+        dcVoltage = batteryManager->getPackVoltage();
+    }
+    if (batteryManager && batteryManager->hasPackCurrent()) {
+        dcCurrent = batteryManager->getPackCurrent();
+    }
+
+    updateLimit(dcVoltage, &dcVoltageMin, &dcVoltageMax);
+    updateLimit(dcCurrent, &dcCurrentMin, &dcCurrentMax);
+    updateLimit(motorController->getTemperatureMotor(), NULL, &temperatureMotorMax);
+    updateLimit(motorController->getTemperatureController(), NULL, &temperatureControllerMax);
+}
+
+/*
+ * Update a min/max pair, if min is NULL only the maximum is tracked
+ */
+void OBD2Handler::updateLimit(int16_t value, int16_t *min, int16_t *max)
+{
+    if (min && value < *min) {
+        *min = value;
+    }
+    if (value > *max) {
+        *max = value;
+    }
+}
 
+/*
+ * Store min/max values in the response cache, if pidMin is EXT_PID_COUNT only the maximum is stored
+ */
+void OBD2Handler::setExtendedLimits(int16_t min, int16_t max, ExtendedPid pidMin, ExtendedPid pidMax)
+{
+    if (pidMin != EXT_PID_COUNT) {
+        setExtendedData(pidMin, min, 2);
+    }
+    setExtendedData(pidMax, max, 2);
+}
@@ -35,11 +35,96 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "DeviceManager.h"
 #include "TickHandler.h"
 #include "CanHandler.h"
+#include "DcDcConverter.h"
+#include "Charger.h"
+#include "Status.h"
+#include "FaultHandler.h"
 
-class OBD2Handler
+#define OBD2_MODE_SHOW_DATA          0x01 // mode 01, show current data (SAE J1979)
+#define OBD2_MODE_FREEZE_FRAME       0x02 // mode 02, show freeze frame data
+#define OBD2_MODE_STORED_DTC         0x03 // mode 03, show stored diagnostic trouble codes
+#define OBD2_MODE_CLEAR_DTC          0x04 // mode 04, clear diagnostic trouble codes
+#define OBD2_MODE_PENDING_DTC        0x07 // mode 07, show pending diagnostic trouble codes
+#define OBD2_MODE_READ_DATA_BY_ID    0x22 // mode 22, read data by identifier (2 byte PIDs, multiple PIDs per request)
+#define OBD2_RESPONSE_OFFSET         0x40 // added to the requested mode in a positive response
+#define OBD2_EXT_PID_BASE            0xE000 // first GEVCU specific mode 22 PID
+#define OBD2_EXT_MAX_DATA_LENGTH     4 // max number of data bytes of a single mode 22 PID
+
+class OBD2Handler: public TickObserver
 {
 public:
+    /*
+     * GEVCU specific mode 22 PIDs. The PID sent on the bus is OBD2_EXT_PID_BASE + the value below,
+     * the numbering has to stay without gaps as it's used as index into the response cache.
+     * All values are big endian and use the same units as the websocket (see comments).
+     */
+    enum ExtendedPid {
+        EXT_PID_SYSTEM_STATE = 0,           // E000 1 Status::SystemState
+        EXT_PID_TIME_RUNNING,               // E001 4 seconds since start-up
+        EXT_PID_BITFIELD_MOTOR,             // E002 4 Status::getBitFieldMotor()
+        EXT_PID_BITFIELD_BMS,               // E003 4 Status::getBitFieldBms()
+        EXT_PID_BITFIELD_IO,                // E004 4 Status::getBitFieldIO()
+        EXT_PID_THROTTLE,                   // E005 2 signed, 0.1%
+        EXT_PID_TORQUE_ACTUAL,              // E006 2 signed, 0.1Nm
+        EXT_PID_TORQUE_AVAILABLE,           // E007 2 signed, 0.1Nm
+        EXT_PID_SPEED_ACTUAL,               // E008 2 signed, rpm
+        EXT_PID_DC_VOLTAGE,                 // E009 2 0.1V (from BMS if available)
+        EXT_PID_DC_CURRENT,                 // E00A 2 signed, 0.1A (from BMS if available)
+        EXT_PID_AC_CURRENT,                 // E00B 2 0.1A
+        EXT_PID_MECHANICAL_POWER,           // E00C 2 signed, 0.1kW
+        EXT_PID_TEMPERATURE_MOTOR,          // E00D 2 signed, 0.1C
+        EXT_PID_TEMPERATURE_CONTROLLER,     // E00E 2 signed, 0.1C
+        EXT_PID_CRUISE_CONTROL_SPEED,       // E00F 2 signed, rpm
+        EXT_PID_SOC,                        // E010 1 0.5%
+        EXT_PID_DISCHARGE_LIMIT,            // E011 2 1A
+        EXT_PID_CHARGE_LIMIT,               // E012 2 1A
+        EXT_PID_CHARGE_DISCHARGE_ALLOWED,   // E013 1 bit 0 = charge allowed, bit 1 = discharge allowed
+        EXT_PID_LOWEST_CELL_TEMP,           // E014 2 signed, 0.1C
+        EXT_PID_HIGHEST_CELL_TEMP,          // E015 2 signed, 0.1C
+        EXT_PID_CELL_TEMP_IDS,              // E016 2 id of lowest, id of highest cell temperature
+        EXT_PID_LOWEST_CELL_VOLTS,          // E017 2 0.0001V
+        EXT_PID_HIGHEST_CELL_VOLTS,         // E018 2 0.0001V
+        EXT_PID_AVERAGE_CELL_VOLTS,         // E019 2 0.0001V
+        EXT_PID_CELL_VOLTS_IDS,             // E01A 2 id of lowest, id of highest cell voltage
+        EXT_PID_LOWEST_CELL_RESISTANCE,     // E01B 2 0.01mOhm
+        EXT_PID_HIGHEST_CELL_RESISTANCE,    // E01C 2 0.01mOhm
+        EXT_PID_AVERAGE_CELL_RESISTANCE,    // E01D 2 0.01mOhm
+        EXT_PID_CELL_RESISTANCE_IDS,        // E01E 2 id of lowest, id of highest cell resistance
+        EXT_PID_PACK_RESISTANCE,            // E01F 2 1mOhm
+        EXT_PID_PACK_HEALTH,                // E020 1 1%
+        EXT_PID_PACK_CYCLES,                // E021 2 cycles
+        EXT_PID_BMS_TEMPERATURE,            // E022 1 signed, 1C
+        EXT_PID_DCDC_HV_VOLTAGE,            // E023 2 0.1V
+        EXT_PID_DCDC_HV_CURRENT,            // E024 2 signed, 0.1A
+        EXT_PID_DCDC_LV_VOLTAGE,            // E025 2 0.1V
+        EXT_PID_DCDC_LV_CURRENT,            // E026 2 signed, 1A
+        EXT_PID_DCDC_TEMPERATURE,           // E027 2 signed, 0.1C
+        EXT_PID_CHARGER_INPUT_VOLTAGE,      // E028 2 0.1V
+        EXT_PID_CHARGER_INPUT_CURRENT,      // E029 2 0.01A
+        EXT_PID_CHARGER_BATTERY_VOLTAGE,    // E02A 2 0.1V
+        EXT_PID_CHARGER_BATTERY_CURRENT,    // E02B 2 0.01A
+        EXT_PID_CHARGER_TEMPERATURE,        // E02C 2 signed, 0.1C
+        EXT_PID_CHARGER_TIME_REMAINING,     // E02D 2 minutes
+        EXT_PID_CHARGER_MAX_INPUT_CURRENT,  // E02E 2 0.1A
+        EXT_PID_HEATER_POWER,               // E02F 2 1W
+        EXT_PID_HEATER_TEMPERATURE,         // E030 2 signed, 1C
+        EXT_PID_FLOW_COOLANT,               // E031 2 ml/s
+        EXT_PID_FLOW_HEATER,                // E032 2 ml/s
+        EXT_PID_TEMPERATURE_COOLANT,        // E033 2 signed, 0.1C
+        EXT_PID_TEMPERATURE_EXTERIOR,       // E034 2 signed, 0.1C
+        EXT_PID_TEMPERATURE_BATTERY,        // E035 2 signed, 0.1C, one PID per sensor (E035 - E03A)
+        EXT_PID_DC_VOLTAGE_MIN = EXT_PID_TEMPERATURE_BATTERY + CFG_NUMBER_BATTERY_TEMPERATURE_SENSORS, // 2 0.1V, lowest since start-up
+        EXT_PID_DC_VOLTAGE_MAX,             // 2 0.1V, highest since start-up
+        EXT_PID_DC_CURRENT_MIN,             // 2 signed, 0.1A, lowest since start-up
+        EXT_PID_DC_CURRENT_MAX,             // 2 signed, 0.1A, highest since start-up
+        EXT_PID_TEMPERATURE_MOTOR_MAX,      // 2 signed, 0.1C, highest since start-up
+        EXT_PID_TEMPERATURE_CONTROLLER_MAX, // 2 signed, 0.1C, highest since start-up
+        EXT_PID_COUNT                       // number of defined PIDs, keep last
+    };
+
     bool processRequest(byte *inData, byte *outData);
+    void setup();
+    void handleTick();
     static OBD2Handler *getInstance();
 
 protected:
@@ -48,11 +133,27 @@ private:
     OBD2Handler(); //it's not right to try to directly instantiate this class
     bool processShowData(uint16_t pid, byte *inData, byte *outData);
     bool processShowCustomData(uint16_t pid, byte *inData, byte *outData);
+    bool processShowTroubleCodes(uint8_t mode, byte *outData);
+    bool processShowFreezeFrame(uint16_t pid, uint8_t frame, byte *outData);
+    bool getFreezeFrameValue(FAULT *fault, FreezeFrameValue value, int16_t *result);
+    bool processReadDataById(byte *inData, byte *outData);
+    void refreshExtendedData();
+    void setExtendedData(ExtendedPid pid, uint32_t value, uint8_t length);
+    void updateLimits();
+    void updateLimit(int16_t value, int16_t *min, int16_t *max);
+    void setExtendedLimits(int16_t min, int16_t max, ExtendedPid pidMin, ExtendedPid pidMax);
 
     MotorController* motorController;
     Throttle* accelPedal;
     Throttle* brakePedal;
     BatteryManager *BMS;
+
+    uint8_t extendedData[EXT_PID_COUNT][OBD2_EXT_MAX_DATA_LENGTH]; // encoded (big endian) values of the mode 22 PIDs
+    uint8_t extendedLength[EXT_PID_COUNT]; // number of valid bytes in extendedData, 0 = value not available
+    uint32_t extendedTimestamp; // millis() when extendedData was last refreshed
+    bool extendedValid; // was extendedData refreshed at least once
+    int16_t dcVoltageMin, dcVoltageMax, dcCurrentMin, dcCurrentMax; // limits seen since start-up
+    int16_t temperatureMotorMax, temperatureControllerMax; // limits seen since start-up
 };
 
 #endif
@@ -118,10 +118,8 @@ void OrionBMS::processPack(uint8_t data[])
     status.bmsDtcHVIsolationFault = (flags & dtcHVIsolationFault) ? true : false;
     status.bmsDtcVoltageRedundancyFault = (flags & dtcVoltageRedundancyFault) ? true : false;
     soc = data[7]; // byte 7: temperature of BMS (1C)
-    if (logger.isDebug()) {
-        logger.debug(this, "pack current: %fA, voltage: %fV (summed: %fV), flags: %#08x, soc: %.1f", (float) packCurrent / 10.0F,
-                (float) packVoltage / 10.0F, (float) packSummedVoltage / 10.0F, flags, (float) soc / 2.0F);
-    }
+    LOG_DEBUG(this, "pack current: %fA, voltage: %fV (summed: %fV), flags: %#08x, soc: %.1f", (float) packCurrent / 10.0F,
+            (float) packVoltage / 10.0F, (float) packSummedVoltage / 10.0F, flags, (float) soc / 2.0F);
 }
 
 void OrionBMS::processLimits(uint8_t data[])
@@ -152,10 +150,8 @@ void OrionBMS::processLimits(uint8_t data[])
     chargerEnabled = (relayStatus & chagerSafety) ? true : false; // Bit #3 (0x04): Charger safety enabled
     status.bmsChagerSafety = chargerEnabled;
     status.bmsDtcPresent = (relayStatus & dtcPresent) ? true : false; // Bit #4 (0x08): Malfunction indicator active (DTC status)
-    if (logger.isDebug()) {
-        logger.debug(this, "discharge limit: %dA, charge limit: %dA, limit flags: %#08x, relay: %#08x", dischargeLimit, chargeLimit, currentLimit,
-                relayStatus);
-    }
+    LOG_DEBUG(this, "discharge limit: %dA, charge limit: %dA, limit flags: %#08x, relay: %#08x", dischargeLimit, chargeLimit, currentLimit,
+            relayStatus);
 }
 
 void OrionBMS::processCellVoltage(uint8_t data[])
@@ -166,10 +162,8 @@ void OrionBMS::processCellVoltage(uint8_t data[])
     highestCellVolts = ((data[3] << 8) | data[4]); // byte 3+4: high cell voltage (0.0001V)
     highestCellVoltsId = data[5]; // byte 5: high cell voltage ID (0-180)
     averageCellVolts = ((data[6] << 8) | data[7]); // byte 6+7: average cell voltage (0.0001V)
-    if (logger.isDebug()) {
-        logger.debug(this, "low cell: %fV (%d), high cell: %fV (%d), avg: %fV", (float) lowestCellVolts / 10000.0F, lowestCellVoltsId,
-                (float) highestCellVolts / 10000.0F, highestCellVoltsId, (float) averageCellVolts / 10000.0F);
-    }
+    LOG_DEBUG(this, "low cell: %fV (%d), high cell: %fV (%d), avg: %fV", (float) lowestCellVolts / 10000.0F, lowestCellVoltsId,
+            (float) highestCellVolts / 10000.0F, highestCellVoltsId, (float) averageCellVolts / 10000.0F);
 }
 
 void OrionBMS::processCellResistance(uint8_t data[])
@@ -180,10 +174,8 @@ void OrionBMS::processCellResistance(uint8_t data[])
     highestCellResistance = ((data[3] << 8) | data[4]); // byte 3+4: high cell resistance (0.01 mOhm)
     highestCellResistanceId = data[5]; // byte 5: high cell resistance ID (0-180)
     averageCellResistance = ((data[6] << 8) | data[7]); // byte 6+7: average cell resistance (0.01 mOhm)
-    if (logger.isDebug()) {
-        logger.debug(this, "low cell: %fmOhm (%d), high cell: %fmOhm (%d), avg: %fmOhm", (float) lowestCellResistance / 100.0F,
-                lowestCellResistanceId, (float) highestCellResistance / 100.0F, highestCellResistanceId, (float) averageCellResistance / 100.0F);
-    }
+    LOG_DEBUG(this, "low cell: %fmOhm (%d), high cell: %fmOhm (%d), avg: %fmOhm", (float) lowestCellResistance / 100.0F,
+            lowestCellResistanceId, (float) highestCellResistance / 100.0F, highestCellResistanceId, (float) averageCellResistance / 100.0F);
 }
 
 void OrionBMS::processHealth(uint8_t data[])
@@ -193,10 +185,8 @@ void OrionBMS::processHealth(uint8_t data[])
     packCycles = ((data[1] << 8) | data[2]); // byte 1+2: number of total pack cycles
     packResistance = ((data[3] << 8) | data[4]); // byte 3+4: pack resistance (1 mOhm)
     packAmphours = ((data[5] << 8) | data[6]); // byte 3+4: pack resistance (1 mOhm)
-    if (logger.isDebug()) {
-        logger.debug(this, "pack health: %d, pack cycles: %d, pack Resistance: %dmOhm, pack charge: %.1fAh", packHealth,
-                packCycles, packResistance, (float) packAmphours / 10.0F);
-    }
+    LOG_DEBUG(this, "pack health: %d, pack cycles: %d, pack Resistance: %dmOhm, pack charge: %.1fAh", packHealth,
+            packCycles, packResistance, (float) packAmphours / 10.0F);
 }
 
 void OrionBMS::processTemperature(uint8_t data[])
@@ -207,10 +197,8 @@ void OrionBMS::processTemperature(uint8_t data[])
     highestCellTemp = data[2] * 10;
     highestCellTempId = data[3];
     systemTemperature = data[4] * 10;
-    if (logger.isDebug()) {
-        logger.debug(this, "low temp: %dC (%d), high temp: %dC (%d), sys temp: %dC", lowestCellTemp, lowestCellTempId,
-        		highestCellTemp, highestCellTempId, systemTemperature);
-    }
+    LOG_DEBUG(this, "low temp: %dC (%d), high temp: %dC (%d), sys temp: %dC", lowestCellTemp, lowestCellTempId,
+    		highestCellTemp, highestCellTempId, systemTemperature);
 }
 
 DeviceId OrionBMS::getId()
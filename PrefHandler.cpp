@@ -39,7 +39,13 @@ PrefHandler::PrefHandler(DeviceId id_in)
 
     deviceId = id_in;
     enabled = false;
-    lkg_address = EE_MAIN_OFFSET;
+    copy_address = EE_MAIN_OFFSET;
+    active_address = EE_MAIN_OFFSET;
+    generation = 0;
+    editing = false;
+    committing = false;
+    checksumState = CHECKSUM_UNKNOWN;
+    schemaVersion = 0;
 
     initDeviceTable();
 
@@ -59,7 +65,6 @@ PrefHandler::PrefHandler(DeviceId id_in)
     position = findDevice(NEW);
     if (position > -1) {
         base_address = EE_DEVICES_BASE + (EE_DEVICE_SIZE * position);
-        lkg_address = EE_MAIN_OFFSET;
         memCache.Write(EE_DEVICE_TABLE + (2 * position), (uint16_t)deviceId);
         logger.debug("Device ID: %#x was placed into device table at entry: %i", (int) deviceId, position);
         return;
@@ -125,6 +130,41 @@ bool PrefHandler::setEnabled(bool en)
 	return memCache.Write(EE_DEVICE_TABLE + (2 * position), id);
 }
 
+/*
+ * Load the configuration of the device at a position of the device table into the cache:
+ * the header page of both copies (to compare their generation) and the whole newer copy.
+ * If the cache is full, the headers are not read, so nothing that was prefetched before gets evicted.
+ * Returns the number of pages read from the EEPROM.
+ */
+uint8_t PrefHandler::prefetch(int position)
+{
+    uint32_t address = EE_DEVICES_BASE + (EE_DEVICE_SIZE * position);
+    uint16_t generationMain, generationLkg;
+    uint8_t count;
+
+    count = memCache.Prefetch(address + EE_MAIN_OFFSET, EE_CONFIG_HEADER_SIZE);
+    count += memCache.Prefetch(address + EE_LKG_OFFSET, EE_CONFIG_HEADER_SIZE);
+    if (count < 2) {
+        return count;
+    }
+    memCache.Read(address + EE_MAIN_OFFSET + EE_GENERATION, &generationMain);
+    memCache.Read(address + EE_LKG_OFFSET + EE_GENERATION, &generationLkg);
+    count += memCache.Prefetch(address + getNewerCopy(generationMain, generationLkg), EE_DEVICE_SIZE);
+
+    return count;
+}
+
+/*
+ * Get the offset of the copy with the newer generation (0xFFFF = erased)
+ */
+uint32_t PrefHandler::getNewerCopy(uint16_t generationMain, uint16_t generationLkg)
+{
+    if (generationLkg != 0xFFFF && (generationMain == 0xFFFF || (int16_t) (generationLkg - generationMain) > 0)) {
+        return EE_LKG_OFFSET;
+    }
+    return EE_MAIN_OFFSET;
+}
+
 /*
  * Search the device table for a device with a given ID
  */
@@ -142,18 +182,6 @@ int8_t PrefHandler::findDevice(DeviceId deviceId)
     return -1;
 }
 
-/*
- * Enable/Disable the LKG (last known good) configuration
- */
-void PrefHandler::LKG_mode(bool mode)
-{
-    if (mode) {
-        lkg_address = EE_LKG_OFFSET;
-    } else {
-        lkg_address = EE_MAIN_OFFSET;
-    }
-}
-
 /*
  * Write one byte to an address relative to the device's base
  */
@@ -162,7 +190,8 @@ bool PrefHandler::write(uint16_t address, uint8_t val)
     if (address >= EE_DEVICE_SIZE) {
         return false;
     }
-    return memCache.Write((uint32_t) address + base_address + lkg_address, val);
+    beginEdit();
+    return memCache.Write((uint32_t) address + base_address + copy_address, val);
 }
 
 /*
@@ -173,7 +202,8 @@ bool PrefHandler::write(uint16_t address, uint16_t val)
     if (address >= EE_DEVICE_SIZE) {
         return false;
     }
-    return memCache.Write((uint32_t) address + base_address + lkg_address, val);
+    beginEdit();
+    return memCache.Write((uint32_t) address + base_address + copy_address, val);
 }
 
 /*
@@ -184,7 +214,8 @@ bool PrefHandler::write(uint16_t address, uint32_t val)
     if (address >= EE_DEVICE_SIZE) {
         return false;
     }
-    return memCache.Write((uint32_t) address + base_address + lkg_address, val);
+    beginEdit();
+    return memCache.Write((uint32_t) address + base_address + copy_address, val);
 }
 
 /*
@@ -195,7 +226,7 @@ bool PrefHandler::read(uint16_t address, uint8_t *val)
     if (address >= EE_DEVICE_SIZE) {
         return false;
     }
-    return memCache.Read((uint32_t) address + base_address + lkg_address, val);
+    return memCache.Read((uint32_t) address + base_address + copy_address, val);
 }
 
 /*
@@ -206,7 +237,7 @@ bool PrefHandler::read(uint16_t address, uint16_t *val)
     if (address >= EE_DEVICE_SIZE) {
         return false;
     }
-    return memCache.Read((uint32_t) address + base_address + lkg_address, val);
+    return memCache.Read((uint32_t) address + base_address + copy_address, val);
 }
 
 /*
@@ -217,59 +248,353 @@ bool PrefHandler::read(uint16_t address, uint32_t *val)
     if (address >= EE_DEVICE_SIZE) {
         return false;
     }
-    return memCache.Read((uint32_t) address + base_address + lkg_address, val);
+    return memCache.Read((uint32_t) address + base_address + copy_address, val);
+}
+
+/*
+ * Load the fields of a configuration class as declared in its schema.
+ * The part of the device's block which contains the fields is read in one bulk access.
+ * If the checksum is invalid, all fields get their default value. If a field was added
+ * in a newer version than the stored configuration, only this field gets its default.
+ * Returns true if stored values were used.
+ */
+bool PrefHandler::load(void *config, const PrefField *fields, uint8_t count)
+{
+    uint8_t buffer[EE_DEVICE_SIZE];
+    uint16_t start, end;
+    uint8_t storedVersion = 0;
+    bool valid = false;
+
+#ifndef USE_HARD_CODED
+    valid = checksumValid();
+#endif
+    if (valid) {
+        memCache.Read(EE_SCHEMA_VERSION + base_address + copy_address, &storedVersion);
+        if (storedVersion == 0xFF) { // saved before versions were introduced
+            storedVersion = 0;
+        }
+        if (!readRange(fields, count, buffer, &start, &end)) {
+            valid = false;
+        }
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        const PrefField *field = &fields[i];
+        uint8_t *member = (uint8_t *) config + field->member;
+        uint32_t value = field->defaultValue;
+
+        if (valid && field->version <= storedVersion) {
+            value = 0;
+            memcpy(&value, buffer + field->address - start, getSize(field->type));
+        }
+
+        switch (field->type) {
+        case PREF_UINT8:
+            *member = value;
+            break;
+        case PREF_UINT16:
+            *(uint16_t *) member = value;
+            break;
+        case PREF_UINT32:
+            *(uint32_t *) member = value;
+            break;
+        case PREF_BOOL:
+            *(bool *) member = (value != 0);
+            break;
+        case PREF_ENUM: // only the low byte, the size of enums depends on the compiler options (configs are zero-initialized)
+            *member = value;
+            break;
+        case PREF_MILLI:
+            *(double *) member = (uint16_t) value / 1000.0f;
+            break;
+        }
+    }
+    return valid;
+}
+
+/*
+ * Save the fields of a configuration class as declared in its schema with one bulk write.
+ * The checksum must be updated afterwards with saveChecksum().
+ */
+bool PrefHandler::save(void *config, const PrefField *fields, uint8_t count)
+{
+    uint8_t buffer[EE_DEVICE_SIZE];
+    uint16_t start, end;
+
+    beginEdit();
+
+    // read the range first to preserve values between the fields which aren't part of the schema
+    if (!readRange(fields, count, buffer, &start, &end)) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        const PrefField *field = &fields[i];
+        uint8_t *member = (uint8_t *) config + field->member;
+        uint32_t value = 0;
+
+        switch (field->type) {
+        case PREF_UINT8:
+            value = *member;
+            break;
+        case PREF_UINT16:
+            value = *(uint16_t *) member;
+            break;
+        case PREF_UINT32:
+            value = *(uint32_t *) member;
+            break;
+        case PREF_BOOL:
+            value = (*(bool *) member ? 1 : 0);
+            break;
+        case PREF_ENUM:
+            value = *member;
+            break;
+        case PREF_MILLI:
+            value = (uint16_t) (*(double *) member * 1000);
+            break;
+        }
+        memcpy(buffer + field->address - start, &value, getSize(field->type));
+        schemaVersion = max(schemaVersion, field->version);
+    }
+
+    return memCache.Write(start + base_address + copy_address, buffer, end - start);
+}
+
+/*
+ * Read the part of the device's block which contains all fields of a schema into a buffer
+ * (buffer[0] corresponds to the offset start).
+ */
+bool PrefHandler::readRange(const PrefField *fields, uint8_t count, uint8_t *buffer, uint16_t *start, uint16_t *end)
+{
+    *start = EE_DEVICE_SIZE;
+    *end = 0;
+
+    for (uint8_t i = 0; i < count; i++) {
+        *start = min(*start, fields[i].address);
+        *end = max(*end, fields[i].address + getSize(fields[i].type));
+    }
+    if (*start >= *end || *end > EE_DEVICE_SIZE) {
+        return false;
+    }
+    return memCache.Read(*start + base_address + copy_address, buffer, *end - *start);
+}
+
+/*
+ * Number of bytes a field type occupies in the EEPROM
+ */
+uint8_t PrefHandler::getSize(PrefType type)
+{
+    switch (type) {
+    case PREF_UINT16:
+    case PREF_MILLI:
+        return 2;
+    case PREF_UINT32:
+        return 4;
+    default:
+        return 1;
+    }
 }
 
 /*
- * Calculate the checksum for a device configuration (block of EE_DEVICE_SIZE bytes)
+ * Calculate the checksum (inverted CRC8) of the copy of the device configuration in use (block of EE_DEVICE_SIZE bytes)
  */
 uint8_t PrefHandler::calcChecksum()
 {
-    uint16_t counter;
-    uint8_t accum = 0;
-    uint8_t temp;
+    return ~calcCrc(copy_address, 1, 0, NULL);
+}
 
-    for (counter = 1; counter < EE_DEVICE_SIZE; counter++) {
-        memCache.Read((uint32_t) counter + base_address + lkg_address, &temp);
-        accum += temp;
+/*
+ * Calculate the CRC8 over a copy of the configuration from the offset "from" up to the end of
+ * the block, continuing a CRC which was calculated over the preceding bytes. If legacySum is
+ * not NULL, the additive checksum of older firmware is calculated too. The block is read
+ * in a few bulk accesses.
+ */
+uint8_t PrefHandler::calcCrc(uint32_t copy, uint16_t from, uint8_t crc, uint8_t *legacySum)
+{
+    uint8_t buffer[64];
+    uint16_t counter, length;
+
+    if (legacySum != NULL) {
+        *legacySum = 0;
+    }
+    for (counter = from; counter < EE_DEVICE_SIZE; counter += length) {
+        length = min((uint16_t) sizeof(buffer), (uint16_t) (EE_DEVICE_SIZE - counter));
+        memCache.Read((uint32_t) counter + base_address + copy, buffer, length);
+        crc = CRC8::update(crc, buffer, length);
+        for (uint16_t i = 0; legacySum != NULL && i < length; i++) {
+            *legacySum += buffer[i];
+        }
     }
 
-    return accum;
+    return crc;
 }
 
 /*
- * Calculate the current checksum and save it to the proper place within the device config (EE_CHECKSUM)
+ * Start modifying the configuration. All writes go to the inactive copy which first receives
+ * the content of the active one. The active copy stays untouched until saveChecksum() commits
+ * the changes, so an interrupted save can't corrupt the configuration.
+ * If the header of the last commit wasn't written yet, it is dropped and the same copy is edited further.
+ */
+void PrefHandler::beginEdit()
+{
+    uint8_t buffer[64];
+    uint32_t inactive;
+
+    if (editing) {
+        checksumState = CHECKSUM_UNKNOWN;
+        return;
+    }
+    if (committing) {
+        committing = false;
+        if (memCache.CancelDeferredWrite(EE_CHECKSUM + base_address + copy_address)) {
+            generation--; // saveChecksum() assigns it again
+            editing = true;
+            checksumState = CHECKSUM_UNKNOWN;
+            return;
+        }
+        active_address = copy_address; // the header was written
+    }
+    if (checksumState == CHECKSUM_UNKNOWN) {
+        checksumValid(); // select the active copy first
+    }
+    inactive = (active_address == EE_MAIN_OFFSET ? EE_LKG_OFFSET : EE_MAIN_OFFSET);
+    for (uint16_t counter = 0; counter < EE_DEVICE_SIZE; counter += sizeof(buffer)) {
+        memCache.Read((uint32_t) counter + base_address + active_address, buffer, sizeof(buffer));
+        memCache.Write((uint32_t) counter + base_address + inactive, buffer, sizeof(buffer));
+    }
+    copy_address = inactive;
+    editing = true;
+    checksumState = CHECKSUM_UNKNOWN;
+}
+
+/*
+ * Commit the modified copy: Its header (checksum, schema version and a generation number one
+ * higher than the active copy's) is written last with one single write. Until the page containing
+ * the header reaches the eeprom, the previous copy remains the newest valid one.
+ * The data of the copy is queued for write-back and the MemCache holds the header back until
+ * the data is in the eeprom, otherwise the header could be written before the data it validates.
+ * Only if the MemCache can't take the header, this waits for the data to be written.
  */
 void PrefHandler::saveChecksum()
 {
-    uint8_t csum;
-    csum = calcChecksum();
-    memCache.Write(EE_CHECKSUM + base_address + lkg_address, csum);
+    uint8_t header[EE_CONFIG_HEADER_SIZE];
+
+    beginEdit();
+
+    if (++generation == 0xFFFF) { // reserved for erased blocks
+        generation = 0;
+    }
+    header[EE_SCHEMA_VERSION] = schemaVersion;
+    header[EE_GENERATION] = generation & 0xFF;
+    header[EE_GENERATION + 1] = generation >> 8;
+    header[EE_CHECKSUM] = ~calcCrc(copy_address, EE_CONFIG_HEADER_SIZE,
+            CRC8::update(0, header + 1, EE_CONFIG_HEADER_SIZE - 1), NULL);
+
+    for (uint16_t offset = 0; offset < EE_DEVICE_SIZE; offset += 256) {
+        memCache.FlushAddress(base_address + copy_address + offset);
+    }
+    if (memCache.WriteDeferred(EE_CHECKSUM + base_address + copy_address, header, EE_CONFIG_HEADER_SIZE,
+            base_address + copy_address, EE_DEVICE_SIZE)) {
+        committing = true; // the copy becomes the active one when beginEdit() finds the header written
+    } else {
+        for (uint16_t offset = 0; offset < EE_DEVICE_SIZE; offset += 256) {
+            memCache.WaitForAddress(base_address + copy_address + offset);
+        }
+        memCache.Write(EE_CHECKSUM + base_address + copy_address, header, EE_CONFIG_HEADER_SIZE);
+        memCache.FlushAddress(EE_CHECKSUM + base_address + copy_address);
+        active_address = copy_address;
+    }
+    editing = false;
+    checksumState = CHECKSUM_VALID;
 }
 
 /*
- * Get checksum from EEPROM and calculate the current checksum to see if they match
+ * Check if the checksum of the configuration is valid. At the first call, the valid copy with
+ * the newest generation is selected. The result is cached until the configuration is written
+ * again, so the loadConfiguration() of every class in a device's hierarchy doesn't re-validate
+ * the whole block.
  */
 bool PrefHandler::checksumValid()
 {
-    uint8_t stored_chk, calc_chk;
+    uint16_t generationMain, generationLkg;
+    uint32_t newer, older;
 
-    memCache.Read(EE_CHECKSUM + base_address + lkg_address, &stored_chk);
-    calc_chk = calcChecksum();
-    if (stored_chk == calc_chk) {
-        logger.debug("%#x valid checksum, using stored config values", deviceId);
-        return true;
+    if (checksumState != CHECKSUM_UNKNOWN) {
+        return (checksumState == CHECKSUM_VALID);
+    }
+    if (editing) { // not committed yet, check the modified copy only
+        checksumState = (isCopyValid(copy_address) ? CHECKSUM_VALID : CHECKSUM_INVALID);
+        return (checksumState == CHECKSUM_VALID);
+    }
+
+    generationMain = readGeneration(EE_MAIN_OFFSET);
+    generationLkg = readGeneration(EE_LKG_OFFSET);
+    newer = getNewerCopy(generationMain, generationLkg);
+    older = (newer == EE_MAIN_OFFSET ? EE_LKG_OFFSET : EE_MAIN_OFFSET);
+
+    if (isCopyValid(newer)) {
+        active_address = newer;
+    } else if (isCopyValid(older)) {
+        logger.warn("%#x newest config copy is corrupt, using previous copy", deviceId);
+        active_address = older;
     } else {
-        logger.warn("#x invalid checksum, using hard coded config values (stored: %#x, calc: %#x", deviceId, stored_chk, calc_chk);
+        logger.warn("%#x invalid checksum, using hard coded config values", deviceId);
+        active_address = EE_MAIN_OFFSET;
+        copy_address = active_address;
+        generation = max(generationMain == 0xFFFF ? 0 : generationMain, generationLkg == 0xFFFF ? 0 : generationLkg);
+        checksumState = CHECKSUM_INVALID;
         return false;
     }
+
+    copy_address = active_address;
+    generation = readGeneration(active_address);
+    logger.debug("%#x valid checksum, using stored config values (generation %d)", deviceId, generation);
+    checksumState = CHECKSUM_VALID;
+    return true;
+}
+
+/*
+ * Verify the checksum of a copy of the configuration. A copy with generation 0xFFFF was never
+ * committed (erased or nuked). Configurations saved by older firmware (additive checksum, no
+ * generation) are accepted in the main copy as long as copy B was never written (its header
+ * still erased), older firmware didn't use it.
+ */
+bool PrefHandler::isCopyValid(uint32_t copy)
+{
+    uint8_t stored, legacySum, crc;
+    uint32_t headerLkg;
+
+    memCache.Read(EE_CHECKSUM + base_address + copy, &stored);
+    crc = ~calcCrc(copy, 1, 0, &legacySum);
+    if (readGeneration(copy) != 0xFFFF && stored == crc) {
+        return true;
+    }
+    if (copy == EE_MAIN_OFFSET && stored == legacySum) {
+        memCache.Read(base_address + EE_LKG_OFFSET, &headerLkg);
+        if (headerLkg == 0xFFFFFFFF) {
+            logger.info("%#x valid checksum of older firmware", deviceId);
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Read the generation number of a copy of the configuration (0xFFFF = erased)
+ */
+uint16_t PrefHandler::readGeneration(uint32_t copy)
+{
+    uint16_t value;
+
+    memCache.Read(EE_GENERATION + base_address + copy, &value);
+    return value;
 }
 
 /*
- * Write first dirty page of the cache to the eeprom
+ * Queue the first dirty page of the cache for writing to the eeprom
  */
 void PrefHandler::suggestCacheWrite()
 {
-    // we don't call FlushAllPages because this would kill the timing (delay(10))
+    // we don't call FlushAllPages because this would block until all pages are written
     memCache.FlushSinglePage();
 }
@@ -35,10 +35,40 @@
 #include "MemCache.h"
 #include "DeviceTypes.h"
 #include "Logger.h"
+#include "CRC8.h"
 
-//normal or Last Known Good configuration
-#define PREF_MODE_NORMAL  false
-#define PREF_MODE_LKG     true
+class DeviceConfiguration;
+
+#define CHECKSUM_UNKNOWN  0
+#define CHECKSUM_VALID    1
+#define CHECKSUM_INVALID  2
+
+/*
+ * How a configuration field is stored in the EEPROM and converted into the member of the configuration class
+ */
+enum PrefType {
+    PREF_UINT8,     // 1 byte into a uint8_t/int8_t
+    PREF_UINT16,    // 2 bytes into a uint16_t/int16_t
+    PREF_UINT32,    // 4 bytes into a uint32_t/int32_t
+    PREF_BOOL,      // 1 byte (0/1) into a bool
+    PREF_ENUM,      // 1 byte into an enum (values < 256)
+    PREF_MILLI      // 2 bytes (value * 1000) into a double
+};
+
+/*
+ * Schema entry of a configuration field. A device declares a table of these per configuration class
+ * and loads/saves all fields with one bulk access instead of single reads/writes.
+ */
+struct PrefField {
+    uint16_t address; // offset of the value in the device's EEPROM block (EE*_ constants)
+    uint16_t member; // offset of the member in the configuration class
+    PrefType type;
+    uint32_t defaultValue; // as stored in the EEPROM (e.g. 500 for 0.5 with PREF_MILLI)
+    uint8_t version; // the field is loaded from the EEPROM only if a configuration of this version or higher was saved
+};
+
+#define PREF_FIELD(address, configClass, member, type, defaultValue, version) \
+    { address, offsetof(configClass, member), type, defaultValue, version }
 
 #define SYSTEM_PROTO    1
 #define SYSTEM_DUED     2
@@ -51,29 +81,43 @@ public:
     PrefHandler();
     PrefHandler(DeviceId id);
     ~PrefHandler();
-    void LKG_mode(bool mode);
     bool write(uint16_t address, uint8_t val);
     bool write(uint16_t address, uint16_t val);
     bool write(uint16_t address, uint32_t val);
     bool read(uint16_t address, uint8_t *val);
     bool read(uint16_t address, uint16_t *val);
     bool read(uint16_t address, uint32_t *val);
+    bool load(void *config, const PrefField *fields, uint8_t count);
+    bool save(void *config, const PrefField *fields, uint8_t count);
     uint8_t calcChecksum();
     void saveChecksum();
     bool checksumValid();
     void suggestCacheWrite();
     bool isEnabled();
     bool setEnabled(bool en);
+    static uint8_t prefetch(int position);
 
 private:
     DeviceId deviceId; // the device id the handler is assigned to
     uint32_t base_address; //base address for the parent device
-    uint32_t lkg_address;
-    bool use_lkg; //use last known good config?
+    uint32_t active_address; // offset of the valid copy with the newest generation (EE_MAIN_OFFSET or EE_LKG_OFFSET)
+    uint32_t copy_address; // offset of the copy which is read/written (the inactive one while editing)
+    uint16_t generation; // generation of the active copy, incremented with every commit
+    bool editing; // true if changes were written to the inactive copy but not committed yet
+    bool committing; // the header of copy_address waits in the MemCache until the copy's data is in the eeprom
     bool enabled;
     int position; //position within the device table
+    uint8_t checksumState; // cached result of the checksum validation (CHECKSUM_UNKNOWN, _VALID, _INVALID)
+    uint8_t schemaVersion; // highest field version which was saved
     void initDeviceTable();
+    uint8_t calcCrc(uint32_t copy, uint16_t from, uint8_t crc, uint8_t *legacySum);
+    void beginEdit();
+    bool isCopyValid(uint32_t copy);
+    uint16_t readGeneration(uint32_t copy);
+    bool readRange(const PrefField *fields, uint8_t count, uint8_t *buffer, uint16_t *start, uint16_t *end);
+    uint8_t getSize(PrefType type);
     static int8_t findDevice(DeviceId);
+    static uint32_t getNewerCopy(uint16_t generationMain, uint16_t generationLkg);
 };
 
 #endif
@@ -0,0 +1,158 @@
+/*
+ * RecordStore.cpp
+ *
+ * Wear-levelled log-structured store for frequently updated values (counters)
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "RecordStore.h"
+
+RecordStore recordStore;
+
+RecordStore::RecordStore()
+{
+    head = 0;
+    sequence = 0;
+    for (uint8_t i = 0; i < CFG_RECORD_STORE_MAX_KEYS; i++) {
+        slots[i] = RECORD_STORE_NO_SLOT;
+        values[i] = 0;
+    }
+}
+
+/*
+ * Scan the record region and build the index of the latest value per key.
+ * Must be called after memCache.setup().
+ */
+void RecordStore::setup()
+{
+    RECORD record;
+    uint16_t keySequence[CFG_RECORD_STORE_MAX_KEYS];
+    uint16_t newest = 0;
+    uint16_t count = 0;
+    bool found = false;
+
+    for (uint16_t slot = 0; slot < RECORD_STORE_NUM_SLOTS; slot++) {
+        memCache.Read(EE_RECORD_STORE + slot * sizeof(RECORD), &record, sizeof(RECORD));
+
+        if (record.key >= CFG_RECORD_STORE_MAX_KEYS || record.crc != calculateCrc(&record)) {
+            continue; // empty or corrupt slot
+        }
+        count++;
+
+        // the sequence numbers wrap around but all valid records lie within one ring length,
+        // so they can be compared by their signed difference
+        if (!found || (int16_t) (record.sequence - newest) > 0) {
+            newest = record.sequence;
+            head = (slot + 1) % RECORD_STORE_NUM_SLOTS;
+            found = true;
+        }
+        if (slots[record.key] == RECORD_STORE_NO_SLOT || (int16_t) (record.sequence - keySequence[record.key]) > 0) {
+            slots[record.key] = slot;
+            keySequence[record.key] = record.sequence;
+            values[record.key] = record.value;
+        }
+    }
+    sequence = (found ? newest + 1 : 0);
+
+    // drop the scanned pages from the cache (they're clean), only the page at the head is needed again soon
+    for (uint32_t address = EE_RECORD_STORE; address < EE_RECORD_STORE + EE_RECORD_STORE_SIZE; address += 256) {
+        if ((address >> 8) != ((EE_RECORD_STORE + head * sizeof(RECORD)) >> 8)) {
+            memCache.InvalidateAddress(address);
+        }
+    }
+
+    logger.info("Record store: %d valid records, next slot %d", count, head);
+}
+
+/*
+ * Get the latest value of a key (from RAM).
+ * Returns false if no value was stored yet.
+ */
+bool RecordStore::get(RecordKey key, uint32_t *value)
+{
+    if (key >= CFG_RECORD_STORE_MAX_KEYS || slots[key] == RECORD_STORE_NO_SLOT) {
+        return false;
+    }
+    *value = values[key];
+    return true;
+}
+
+/*
+ * Store a new value of a key. Nothing is written if the value didn't change.
+ * The record is written via the MemCache, so frequent updates are combined until the page is flushed.
+ */
+void RecordStore::put(RecordKey key, uint32_t value)
+{
+    if (key >= CFG_RECORD_STORE_MAX_KEYS || (slots[key] != RECORD_STORE_NO_SLOT && values[key] == value)) {
+        return;
+    }
+    append(key, value);
+}
+
+/*
+ * Append a record at the head of the ring. If this overwrites the live record of another key,
+ * that value is re-appended (compaction), which may in turn displace another live record.
+ */
+void RecordStore::append(uint8_t key, uint32_t value)
+{
+    RECORD record;
+
+    for (uint8_t i = 0; i <= CFG_RECORD_STORE_MAX_KEYS; i++) { // bounded: each key is relocated at most once
+        uint8_t displaced = CFG_RECORD_STORE_MAX_KEYS;
+
+        for (uint8_t k = 0; k < CFG_RECORD_STORE_MAX_KEYS; k++) {
+            if (k != key && slots[k] == head) {
+                displaced = k;
+            }
+        }
+
+        record.key = key;
+        record.sequence = sequence++;
+        record.value = value;
+        record.crc = calculateCrc(&record);
+        memCache.Write(EE_RECORD_STORE + head * sizeof(RECORD), &record, sizeof(RECORD));
+
+        slots[key] = head;
+        values[key] = value;
+        head = (head + 1) % RECORD_STORE_NUM_SLOTS;
+
+        if (displaced == CFG_RECORD_STORE_MAX_KEYS) {
+            return;
+        }
+        key = displaced;
+        value = values[displaced];
+    }
+}
+
+/*
+ * Calculate the CRC8 of a record (with its crc field set to 0).
+ * The result is inverted so a zeroed slot is not mistaken for a valid record.
+ */
+uint8_t RecordStore::calculateCrc(RECORD *record)
+{
+    RECORD temp = *record;
+
+    temp.crc = 0;
+    return ~CRC8::calculate((uint8_t *) &temp, sizeof(RECORD));
+}
@@ -0,0 +1,88 @@
+/*
+ * RecordStore.h
+ *
+ * Wear-levelled log-structured store for frequently updated values (counters)
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef RECORD_STORE_H_
+#define RECORD_STORE_H_
+
+#include <Arduino.h>
+#include "config.h"
+#include "MemCache.h"
+#include "CRC8.h"
+#include "Logger.h"
+#include "eeprom_layout.h"
+
+#define RECORD_STORE_NUM_SLOTS  (EE_RECORD_STORE_SIZE / sizeof(RECORD))
+#define RECORD_STORE_NO_SLOT    0xFFFF
+
+/*
+ * The keys of the values kept in the record store (max CFG_RECORD_STORE_MAX_KEYS).
+ * Don't change the numbers of existing keys, they're stored in the EEPROM.
+ */
+enum RecordKey {
+    RECORD_RUNTIME = 0,             // total runtime of the system in 0.1s (FaultHandler)
+    RECORD_ENERGY_CONSUMPTION = 1,  // accumulated energy consumption in Ws
+    RECORD_ODOMETER = 2,            // total distance in m
+    RECORD_CHARGE_CYCLES = 3        // number of charge cycles
+};
+
+// a record in the log. 8 bytes so it matches a dirty block of the MemCache
+typedef struct {
+    uint8_t key; // the RecordKey of the value
+    uint8_t crc; // CRC8 over the record with crc = 0
+    uint16_t sequence; // incremented with every appended record (wraps around)
+    uint32_t value;
+} RECORD;
+
+/*
+ * The values are appended as sequence-numbered records to a ring buffer in the EEPROM,
+ * so every slot of the region is written equally often. At start-up the region is scanned
+ * once and the latest value of each key is kept in RAM, so reading a value never accesses
+ * the EEPROM. If appending a record overwrites the latest (live) record of another key,
+ * that value is re-appended right away so old records are compacted as the log wraps around.
+ */
+class RecordStore
+{
+public:
+    RecordStore();
+    void setup();
+    bool get(RecordKey key, uint32_t *value);
+    void put(RecordKey key, uint32_t value);
+
+private:
+    uint32_t values[CFG_RECORD_STORE_MAX_KEYS]; // the latest value of each key
+    uint16_t slots[CFG_RECORD_STORE_MAX_KEYS]; // slot of the latest record of each key (RECORD_STORE_NO_SLOT = no value)
+    uint16_t head; // the slot where the next record is appended
+    uint16_t sequence; // the sequence number of the next record
+
+    void append(uint8_t key, uint32_t value);
+    uint8_t calculateCrc(RECORD *record);
+};
+
+extern RecordStore recordStore;
+
+#endif /* RECORD_STORE_H_ */
@@ -0,0 +1,106 @@
+/*
+ * SerialBuffer.cpp
+ *
+ * Non-blocking output to a serial port via a ring buffer which is drained from the main loop
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "SerialBuffer.h"
+
+SerialBuffer serialOutput(SerialUSB);
+
+SerialBuffer::SerialBuffer(Print &port) :
+        port(port)
+{
+    head = 0;
+    tail = 0;
+    dropped = 0;
+    droppedReported = 0;
+}
+
+/*
+ * Append a byte to the ring, if it's full the oldest byte is dropped
+ */
+size_t SerialBuffer::write(uint8_t data)
+{
+    uint16_t next = (head + 1) % CFG_SERIAL_TX_BUFFER_SIZE;
+
+    if (next == tail) {
+        tail = (tail + 1) % CFG_SERIAL_TX_BUFFER_SIZE;
+        dropped++;
+    }
+    buffer[head] = data;
+    head = next;
+    return 1;
+}
+
+size_t SerialBuffer::write(const uint8_t *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        write(data[i]);
+    }
+    return size;
+}
+
+/*
+ * Send up to CFG_SERIAL_TX_CHUNK bytes of the pending output to the port (called from the main loop).
+ * A chunk fits one USB packet or the transmit buffer of a UART, so this doesn't stall the loop.
+ */
+void SerialBuffer::process()
+{
+    uint8_t chunk[CFG_SERIAL_TX_CHUNK];
+    uint16_t count = 0;
+
+    while (tail != head && count < CFG_SERIAL_TX_CHUNK) {
+        chunk[count++] = buffer[tail];
+        tail = (tail + 1) % CFG_SERIAL_TX_BUFFER_SIZE;
+    }
+    if (count > 0) {
+        port.write(chunk, count);
+    } else if (dropped != droppedReported) {
+        port.print("\r\n[serial output overflow, ");
+        port.print(dropped - droppedReported);
+        port.print(" bytes dropped]\r\n");
+        droppedReported = dropped;
+    }
+}
+
+/*
+ * Send all pending output (blocking). Only used before output which bypasses the ring, e.g.
+ * bulk dumps requested via the console, so the order of the output is kept.
+ */
+void SerialBuffer::flush()
+{
+    while (tail != head) {
+        process();
+    }
+}
+
+/*
+ * Total number of bytes which were dropped because the ring was full
+ */
+uint32_t SerialBuffer::getDroppedCount()
+{
+    return dropped;
+}
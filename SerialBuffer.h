@@ -0,0 +1,62 @@
+/*
+ * SerialBuffer.h
+ *
+ * Non-blocking output to a serial port via a ring buffer which is drained from the main loop
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef SERIAL_BUFFER_H_
+#define SERIAL_BUFFER_H_
+
+#include <Arduino.h>
+#include "config.h"
+
+/*
+ * Output which is printed to a SerialBuffer is only copied to the ring buffer, so printing never
+ * blocks, even if the host is slow or not connected. The ring is drained in chunks by process()
+ * from the main loop. If the ring is full, the oldest output is dropped and counted, a notice with
+ * the number of dropped bytes is sent as soon as the ring is empty again.
+ */
+class SerialBuffer: public Print
+{
+public:
+    SerialBuffer(Print &port);
+    size_t write(uint8_t);
+    size_t write(const uint8_t *data, size_t size);
+    using Print::write;
+    void process();
+    void flush();
+    uint32_t getDroppedCount();
+
+private:
+    Print &port; // the serial port the output is sent to
+    uint8_t buffer[CFG_SERIAL_TX_BUFFER_SIZE]; // the ring buffer with the pending output
+    uint16_t head, tail; // write and read index of buffer
+    uint32_t dropped; // total number of bytes dropped because the ring was full
+    uint32_t droppedReported; // value of dropped when the last notice was sent
+};
+
+extern SerialBuffer serialOutput;
+
+#endif /* SERIAL_BUFFER_H_ */
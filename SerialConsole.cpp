@@ -66,6 +66,15 @@ void SerialConsole::printMenu()
     logger.console("B = save brake values");
     logger.console("p = enable wifi passthrough (reboot required to resume normal operation)");
     logger.console("S = show list of devices");
+    logger.console("C = show CAN bus error statistics");
+    logger.console("R = show CAN I/O extension nodes");
+    logger.console("M = show EEPROM cache statistics");
+    logger.console("F = show faults with freeze frames");
+    logger.console("E = show persistent system log (warnings and errors)");
+    logger.console("G = show boot timeline");
+    logger.console("A = show memory usage (stack, heap, allocations)");
+    logger.console("T = show signal recorder status");
+    logger.console("Y = export signal recording (binary)");
     logger.console("w = reset wifi to factory defaults, setup GEVCU ad-hoc network");
     logger.console("W = activate wifi WPS mode for pairing");
     logger.console("s = Scan WiFi for nearby access points");
@@ -73,10 +82,15 @@ void SerialConsole::printMenu()
 
     logger.console("\nConfig Commands (enter command=newvalue)\n");
     logger.console("LOGLEVEL=[deviceId,]%d - set log level (0=debug, 1=info, 2=warn, 3=error, 4=off)", logger.getLogLevel());
+    logger.console("LOGDEFER=%d - format log messages in the main loop instead of when they're logged (0=off, 1=on)", logger.isDeferred());
     logger.console("SYSTYPE=%d - Set board revision (Dued=2, GEVCU3=3, GEVCU4=4)", systemIO.getSystemType());
     logger.console("WLAN - send a AT+i command to the wlan device");
     logger.console("NUKE=1 - Resets all device settings in EEPROM. You have been warned.");
-    logger.console("KILL=... - kill a device temporarily (until reboot)\n");
+    logger.console("KILL=... - kill a device temporarily (until reboot)");
+    logger.console("RECCH=slot,channel - signal recorder channel of slot 0-%d (0=throttle, 1=torque req, 2=torque act, 3=speed, 4=dc volt, 5=dc curr, 6=state, 7-10=analog in 0-3)", CFG_RECORDER_CHANNELS - 1);
+    logger.console("RECTRIG=type,value[,slot] - signal recorder trigger (0=manual, 1=fault code/0=any, 2=system state/-1=any, 3=slot above value, 4=slot below value)");
+    logger.console("RECPRE=%d - number of samples to keep before the trigger (0-%d)", CFG_RECORDER_SAMPLES / 4, CFG_RECORDER_SAMPLES - 1);
+    logger.console("RECARM=1 - arm the signal recorder, RECARM=2 - fire the trigger manually\n");
 
     deviceManager.printDeviceList();
 
@@ -125,6 +139,10 @@ void SerialConsole::printMenuMotorController()
             logger.console("MOOSC=%d - enable the DMC5 oscillation limiter (1=enable, 0=disable, also set DMC parameter!)",
                     dmc5Config->enableOscillationLimiter);
         }
+        if (motorController->getId() == CANOPEN_MC) {
+            CanOpenMotorControllerConfiguration *canOpenConfig = (CanOpenMotorControllerConfiguration *) config;
+            logger.console("MONODE=%d - CANopen node id of the inverter (1-127)", canOpenConfig->nodeId);
+        }
     }
 }
 
@@ -223,7 +241,7 @@ void SerialConsole::printMenuSystemIO()
         logger.console("LIMITLT=%d - Digital output to use for limitation indicator (255 to disable)", config->powerLimitationOutput);
         logger.console("SOCHG=%d - Analog output to use to indicate state of charge (255 to disable)", config->stateOfChargeOutput);
         logger.console("STLGT=%d - Analog output to use to indicate system status (255 to disable)", config->statusLightOutput);
-        logger.console("OUTPUT=<0-7> - toggles state of specified digital output");
+        logger.console("OUTPUT=<0-7> - toggles state of specified digital output (8 and up = outputs of CAN I/O extension nodes)");
     }
 }
 
@@ -462,6 +480,10 @@ bool SerialConsole::handleConfigCmdMotorController(String command, long value)
         value = constrain(value, 0, 1);
         logger.console("Setting oscillation limiter to %s", (value == 0 ? "disabled" : "enabled"));
         ((BrusaDMC5Configuration *) config)->enableOscillationLimiter = value;
+    } else if (command == String("MONODE") && (motorController->getId() == CANOPEN_MC)) {
+        value = constrain(value, 1, 127);
+        logger.console("Setting CANopen node id to %d", value);
+        ((CanOpenMotorControllerConfiguration *) config)->nodeId = value;
     } else if (command == String("CRUISEP")) {
         logger.console("Setting cruise control Kp value to %f", value / 1000.0f);
         config->cruiseKp = value / 1000.0f;
@@ -717,7 +739,7 @@ bool SerialConsole::handleConfigCmdSystemIO(String command, long value)
     } else if (command == String("STLGTMD")) {
         logger.console("Status light set to mode %s.", cmdBuffer + command.length() + 1);
         deviceManager.sendMessage(DEVICE_DISPLAY, STATUSINDICATOR, MSG_UPDATE, (void *)(cmdBuffer + command.length() + 1));
-    } else if (command == String("OUTPUT") && value < 8) {
+    } else if (command == String("OUTPUT") && value < IO_REMOTE_FIRST_OUTPUT + CFG_REMOTE_IO_MAX_NODES * CFG_REMOTE_IO_OUTPUTS_PER_NODE) {
         logger.console("DOUT%d,  STATE: %d", value, systemIO.getDigitalOut(value));
         systemIO.setDigitalOut(value, !systemIO.getDigitalOut(value));
         logger.console("DOUT0:%d, DOUT1:%d, DOUT2:%d, DOUT3:%d, DOUT4:%d, DOUT5:%d, DOUT6:%d, DOUT7:%d", systemIO.getDigitalOut(0),
@@ -903,13 +925,47 @@ bool SerialConsole::handleConfigCmdSystem(String command, long value, char *para
                 logger.setLoglevel(device, (Logger::LogLevel) value);
             }
         }
+    } else if (command == String("LOGDEFER")) {
+        logger.setDeferred(value == 1);
+        logger.console("deferred logging is %s", (value == 1 ? "on" : "off"));
+    } else if (command == String("RECCH")) {
+        uint8_t slot = atol(strtok(parameter, ","));
+        char *channel = strtok(NULL, ",");
+        if (channel == NULL || !signalRecorder.setChannel(slot, (SignalRecorder::Channel) atol(channel))) {
+            logger.console("Invalid recorder slot or channel");
+        }
+    } else if (command == String("RECTRIG")) {
+        SignalRecorder::TriggerType type = (SignalRecorder::TriggerType) atol(strtok(parameter, ","));
+        char *threshold = strtok(NULL, ",");
+        char *slot = strtok(NULL, ",");
+        if (!signalRecorder.setTrigger(type, (threshold ? strtol(threshold, NULL, 0) : 0), (slot ? atol(slot) : 0))) {
+            logger.console("Invalid recorder trigger");
+        }
+    } else if (command == String("RECPRE")) {
+        signalRecorder.setPreTriggerSamples(value);
+    } else if (command == String("RECARM")) {
+        if (value == 1) {
+            signalRecorder.arm();
+            logger.console("Signal recorder armed");
+        } else if (value == 2) {
+            signalRecorder.trigger();
+        }
     } else if (command == String("NUKE") && value == 1) {
-        // write zero to the checksum location of every device in the table.
-        uint8_t zeroVal = 0;
-        for (int j = 0; j < 64; j++) {
-            memCache.Write(EE_DEVICES_BASE + (EE_DEVICE_SIZE * j), zeroVal);
-            memCache.FlushAllPages();
+        // clear the header of both copies of every device in the table: checksum and schema version zero and
+        // generation 0xFFFF, so neither copy is accepted (nor the main copy as one of older firmware).
+        uint8_t header[EE_CONFIG_HEADER_SIZE];
+        header[EE_CHECKSUM] = 0;
+        header[EE_SCHEMA_VERSION] = 0;
+        header[EE_GENERATION] = 0xFF;
+        header[EE_GENERATION + 1] = 0xFF;
+        for (int j = 1; j <= EE_NUM_DEVICES; j++) {
+            uint32_t address = EE_DEVICES_BASE + (EE_DEVICE_SIZE * j);
+            memCache.CancelDeferredWrite(address + EE_MAIN_OFFSET + EE_CHECKSUM); // a pending commit would restore it
+            memCache.CancelDeferredWrite(address + EE_LKG_OFFSET + EE_CHECKSUM);
+            memCache.Write(address + EE_MAIN_OFFSET + EE_CHECKSUM, header, EE_CONFIG_HEADER_SIZE);
+            memCache.Write(address + EE_LKG_OFFSET + EE_CHECKSUM, header, EE_CONFIG_HEADER_SIZE);
         }
+        memCache.FlushAllPages();
         logger.console("Device settings have been nuked. Reboot to reload default settings");
     } else {
         return false;
@@ -1073,6 +1129,7 @@ void SerialConsole::handleShortCmd()
 
     case 'p':
         logger.console("PASSTHROUGH MODE - All traffic Serial3 <-> SerialUSB");
+        serialOutput.flush();
         //this never stops so basically everything dies. you will have to reboot.
         int inSerialUSB, inSerial3;
 
@@ -1094,6 +1151,48 @@ void SerialConsole::handleShortCmd()
         deviceManager.printDeviceList();
         break;
 
+    case 'C':
+        canHandlerEv.printStatistics();
+        canHandlerCar.printStatistics();
+        break;
+
+    case 'M':
+        memCache.printStatistics();
+        break;
+
+    case 'F':
+        faultHandler.printFaults();
+        break;
+
+    case 'E':
+        serialOutput.flush();
+        systemLog.print(SerialUSB);
+        break;
+
+    case 'G':
+        bootTimeline.print(serialOutput);
+        break;
+
+    case 'A':
+        memoryMonitor.printReport(serialOutput);
+        break;
+
+    case 'T':
+        signalRecorder.printStatus();
+        break;
+
+    case 'Y':
+        signalRecorder.exportSerial();
+        break;
+
+    case 'R': {
+        CanIO *canIO = (CanIO *) deviceManager.getDeviceByID(CANIO);
+        if (canIO != NULL && canIO->isEnabled()) {
+            canIO->printRemoteNodes();
+        }
+        break;
+    }
+
     case 's':
         logger.console("Finding and listing all nearby WiFi access points");
         deviceManager.sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *) "RP20");
@@ -39,10 +39,16 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "DeviceManager.h"
 #include "MotorController.h"
 #include "BrusaDMC5.h"
+#include "CanOpenMotorController.h"
 #include "BrusaBSC6.h"
 #include "ThrottleDetector.h"
 #include "CanOBD2.h"
+#include "CanIO.h"
 #include "WifiIchip2128.h"
+#include "SignalRecorder.h"
+#include "SystemLog.h"
+#include "BootTimeline.h"
+#include "MemoryMonitor.h"
 
 class SerialConsole
 {
@@ -0,0 +1,319 @@
+/*
+ * SignalRecorder.cpp
+ *
+ * Triggered recorder for signal traces around intermittent events (oscilloscope style)
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "SignalRecorder.h"
+#include "DeviceManager.h"
+#include "Status.h"
+#include "SystemIO.h"
+
+SignalRecorder::SignalRecorder()
+{
+    head = 0;
+    count = 0;
+    preTrigger = CFG_RECORDER_SAMPLES / 4;
+    postRemaining = 0;
+    triggerPosition = 0;
+    triggerType = TRIGGER_FAULT;
+    triggerValue = 0;
+    triggerSlot = 0;
+    triggerFaultCode = 0;
+    pendingFault = 0;
+    pendingTrigger = false;
+    lastState = 0;
+    triggerTime = 0;
+    sampleInterval = 0;
+    state = IDLE;
+
+    for (uint8_t i = 0; i < CFG_RECORDER_CHANNELS; i++) {
+        channels[i] = (i < REC_CHANNEL_COUNT ? i : REC_THROTTLE);
+    }
+}
+
+/*
+ * Define which value is sampled in a slot. Changing the channels clears the recording.
+ */
+bool SignalRecorder::setChannel(uint8_t slot, Channel channel)
+{
+    if (slot >= CFG_RECORDER_CHANNELS || channel >= REC_CHANNEL_COUNT) {
+        return false;
+    }
+    channels[slot] = channel;
+    count = 0;
+    if (state != ARMED) {
+        state = IDLE;
+    }
+    return true;
+}
+
+bool SignalRecorder::setTrigger(TriggerType type, int16_t value, uint8_t slot)
+{
+    if (type > TRIGGER_BELOW || slot >= CFG_RECORDER_CHANNELS) {
+        return false;
+    }
+    triggerType = type;
+    triggerValue = value;
+    triggerSlot = slot;
+    return true;
+}
+
+/*
+ * Set the size of the pre-trigger window, the rest of the buffer is used for the post-trigger window.
+ */
+void SignalRecorder::setPreTriggerSamples(uint16_t samples)
+{
+    preTrigger = min(samples, (uint16_t) (CFG_RECORDER_SAMPLES - 1));
+}
+
+/*
+ * Start recording and wait for the trigger (discards a previous recording)
+ */
+void SignalRecorder::arm()
+{
+    head = 0;
+    count = 0;
+    pendingTrigger = false;
+    pendingFault = 0;
+    triggerFaultCode = 0;
+    lastState = status.getSystemState();
+    state = ARMED;
+}
+
+/*
+ * Fire the trigger manually
+ */
+void SignalRecorder::trigger()
+{
+    pendingTrigger = true;
+}
+
+/*
+ * Called by the FaultHandler when a new fault is raised. Only a flag is set, the trigger
+ * is evaluated with the next sample, so the cost in the error path is negligible.
+ */
+void SignalRecorder::triggerFault(uint16_t code)
+{
+    if (state == ARMED && triggerType == TRIGGER_FAULT && (triggerValue == 0 || (uint16_t) triggerValue == code)) {
+        pendingFault = code;
+        pendingTrigger = true;
+    }
+}
+
+/*
+ * Take one sample of all channels (called with every tick of the motor controller)
+ */
+void SignalRecorder::sample()
+{
+    if (state != ARMED && state != TRIGGERED) {
+        return;
+    }
+
+    int16_t *values = samples[head];
+    for (uint8_t i = 0; i < CFG_RECORDER_CHANNELS; i++) {
+        values[i] = readChannel(channels[i]);
+    }
+    head = (head + 1) % CFG_RECORDER_SAMPLES;
+    if (count < CFG_RECORDER_SAMPLES) {
+        count++;
+    }
+
+    if (state == ARMED) {
+        if (checkTrigger(values)) {
+            state = TRIGGERED;
+            triggerTime = micros();
+            triggerFaultCode = pendingFault;
+            triggerPosition = min((uint16_t) (count - 1), preTrigger);
+            postRemaining = CFG_RECORDER_SAMPLES - 1 - triggerPosition;
+            logger.info("signal recorder triggered");
+        }
+    } else if (postRemaining > 0) {
+        postRemaining--;
+    }
+
+    if (state == TRIGGERED && postRemaining == 0) {
+        uint16_t post = CFG_RECORDER_SAMPLES - 1 - triggerPosition;
+        sampleInterval = (post > 0 ? (micros() - triggerTime) / post : 0);
+        state = FROZEN;
+        logger.info("signal recorder: recording complete (%d samples)", count);
+    }
+}
+
+/*
+ * Check if the trigger condition is met by the latest sample
+ */
+bool SignalRecorder::checkTrigger(int16_t *values)
+{
+    bool fire = pendingTrigger;
+
+    pendingTrigger = false;
+    switch (triggerType) {
+    case TRIGGER_STATE: {
+        uint8_t systemState = status.getSystemState();
+        if (systemState != lastState && (triggerValue == -1 || triggerValue == systemState)) {
+            fire = true;
+        }
+        lastState = systemState;
+        break;
+    }
+    case TRIGGER_ABOVE:
+        fire |= (values[triggerSlot] > triggerValue);
+        break;
+    case TRIGGER_BELOW:
+        fire |= (values[triggerSlot] < triggerValue);
+        break;
+    default:
+        break;
+    }
+    return fire;
+}
+
+/*
+ * Read the actual value of a channel. Only values the devices already hold are copied (no bus access).
+ */
+int16_t SignalRecorder::readChannel(uint8_t channel)
+{
+    MotorController *motorController = deviceManager.getMotorController();
+
+    switch (channel) {
+    case REC_THROTTLE:
+        return (motorController ? motorController->getThrottleLevel() : 0);
+    case REC_TORQUE_REQUESTED:
+        return (motorController ? motorController->getTorqueRequested() : 0);
+    case REC_TORQUE_ACTUAL:
+        return (motorController ? motorController->getTorqueActual() : 0);
+    case REC_SPEED_ACTUAL:
+        return (motorController ? motorController->getSpeedActual() : 0);
+    case REC_DC_VOLTAGE:
+        return (motorController ? motorController->getDcVoltage() : 0);
+    case REC_DC_CURRENT:
+        return (motorController ? motorController->getDcCurrent() : 0);
+    case REC_SYSTEM_STATE:
+        return status.getSystemState();
+    case REC_ANALOG_IN_0:
+    case REC_ANALOG_IN_1:
+    case REC_ANALOG_IN_2:
+    case REC_ANALOG_IN_3:
+        return systemIO.getAnalogIn(channel - REC_ANALOG_IN_0);
+    }
+    return 0;
+}
+
+SignalRecorder::State SignalRecorder::getState()
+{
+    return state;
+}
+
+/*
+ * Size of the exported recording in bytes (header + samples), 0 if no recording is frozen
+ */
+uint16_t SignalRecorder::getExportSize()
+{
+    if (state != FROZEN) {
+        return 0;
+    }
+    return sizeof(RECORDER_HEADER) + count * sizeof(samples[0]);
+}
+
+void SignalRecorder::fillHeader(RECORDER_HEADER *header)
+{
+    header->magic = RECORDER_MAGIC;
+    header->version = RECORDER_VERSION;
+    header->channelCount = CFG_RECORDER_CHANNELS;
+    header->sampleCount = count;
+    header->triggerPosition = triggerPosition;
+    header->triggerType = triggerType;
+    header->triggerSlot = triggerSlot;
+    header->triggerValue = triggerValue;
+    header->triggerFault = triggerFaultCode;
+    header->sampleInterval = sampleInterval;
+    memcpy(header->channels, channels, sizeof(channels));
+}
+
+/*
+ * Copy a part of the exported recording (header followed by the samples, oldest first) into a buffer.
+ * Returns the number of bytes copied, so the recording can be transferred in chunks.
+ */
+uint16_t SignalRecorder::exportData(uint16_t offset, uint8_t *buffer, uint16_t length)
+{
+    RECORDER_HEADER header;
+    uint16_t size = getExportSize();
+    uint16_t copied = 0;
+
+    if (offset >= size) {
+        return 0;
+    }
+    length = min(length, (uint16_t) (size - offset));
+    fillHeader(&header);
+
+    while (copied < length) {
+        uint16_t position = offset + copied;
+        if (position < sizeof(RECORDER_HEADER)) {
+            buffer[copied++] = ((uint8_t *) &header)[position];
+        } else {
+            position -= sizeof(RECORDER_HEADER);
+            uint16_t index = (head + CFG_RECORDER_SAMPLES - count + position / sizeof(samples[0])) % CFG_RECORDER_SAMPLES;
+            buffer[copied++] = ((uint8_t *) samples[index])[position % sizeof(samples[0])];
+        }
+    }
+    return copied;
+}
+
+/*
+ * Send the frozen recording in binary format to the serial port
+ */
+void SignalRecorder::exportSerial()
+{
+    RECORDER_HEADER header;
+
+    if (state != FROZEN) {
+        logger.console("no recording available");
+        return;
+    }
+    fillHeader(&header);
+    serialOutput.flush(); // the binary data bypasses the buffer (it's larger), send the pending text first
+    SerialUSB.write((uint8_t *) &header, sizeof(header));
+    for (uint16_t i = 0; i < count; i++) {
+        SerialUSB.write((uint8_t *) samples[(head + CFG_RECORDER_SAMPLES - count + i) % CFG_RECORDER_SAMPLES], sizeof(samples[0]));
+    }
+}
+
+void SignalRecorder::printStatus()
+{
+    const char *stateNames[] = { "idle", "armed", "triggered", "frozen" };
+
+    logger.console("Signal recorder: %s, %d of %d samples, pre-trigger=%d, trigger type=%d value=%d slot=%d", stateNames[state], count,
+            CFG_RECORDER_SAMPLES, preTrigger, triggerType, triggerValue, triggerSlot);
+    for (uint8_t i = 0; i < CFG_RECORDER_CHANNELS; i++) {
+        logger.console("    slot %d: channel %d", i, channels[i]);
+    }
+    if (state == FROZEN) {
+        logger.console("    trigger at sample %d, fault %#x, sample interval %dus, export size %d bytes", triggerPosition, triggerFaultCode,
+                sampleInterval, getExportSize());
+    }
+}
+
+SignalRecorder signalRecorder;
@@ -0,0 +1,138 @@
+/*
+ * SignalRecorder.h
+ *
+ * Triggered recorder for signal traces around intermittent events (oscilloscope style)
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef SIGNAL_RECORDER_H_
+#define SIGNAL_RECORDER_H_
+
+#include <Arduino.h>
+#include "config.h"
+#include "Logger.h"
+
+#define RECORDER_MAGIC      0x43455247 // "GREC" at the start of an exported recording
+#define RECORDER_VERSION    1
+
+/*
+ * Header of an exported recording, followed by sampleCount samples (oldest first) of
+ * channelCount int16_t values each (little endian)
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic; // RECORDER_MAGIC
+    uint8_t version; // RECORDER_VERSION
+    uint8_t channelCount; // CFG_RECORDER_CHANNELS
+    uint16_t sampleCount; // number of samples in the recording
+    uint16_t triggerPosition; // index of the sample at which the trigger fired
+    uint8_t triggerType; // SignalRecorder::TriggerType
+    uint8_t triggerSlot; // channel slot of a threshold trigger
+    int16_t triggerValue; // threshold, fault code or system state of the trigger
+    uint16_t triggerFault; // the fault code which fired the trigger (0 = other trigger)
+    uint32_t sampleInterval; // average time between two samples in us
+    uint8_t channels[CFG_RECORDER_CHANNELS]; // the SignalRecorder::Channel of each slot
+} RECORDER_HEADER;
+
+/*
+ * Samples the configured channels with every tick of the motor controller into a ring buffer.
+ * Once armed, it keeps the last samples before the trigger (pre-trigger window) and continues
+ * until the buffer is filled with the post-trigger samples, then the recording is frozen until
+ * it's armed again. Triggers are fault codes, system state changes or thresholds of a channel.
+ * The memory is allocated statically and a sample only copies a few values which the devices
+ * already hold in memory.
+ */
+class SignalRecorder
+{
+public:
+    enum Channel {
+        REC_THROTTLE,           // 0.1%
+        REC_TORQUE_REQUESTED,   // 0.1Nm
+        REC_TORQUE_ACTUAL,      // 0.1Nm
+        REC_SPEED_ACTUAL,       // rpm
+        REC_DC_VOLTAGE,         // 0.1V
+        REC_DC_CURRENT,         // 0.1A
+        REC_SYSTEM_STATE,       // Status::SystemState
+        REC_ANALOG_IN_0,        // raw ADC value of analog input 0 (1-3 follow)
+        REC_ANALOG_IN_1,
+        REC_ANALOG_IN_2,
+        REC_ANALOG_IN_3,
+        REC_CHANNEL_COUNT       // keep last
+    };
+
+    enum TriggerType {
+        TRIGGER_MANUAL,         // only via trigger()
+        TRIGGER_FAULT,          // a new fault is raised (value = fault code, 0 = any fault)
+        TRIGGER_STATE,          // the system state changes (value = new state, -1 = any change)
+        TRIGGER_ABOVE,          // the channel in slot rises above the threshold value
+        TRIGGER_BELOW           // the channel in slot falls below the threshold value
+    };
+
+    enum State {
+        IDLE,                   // not recording
+        ARMED,                  // recording, waiting for the trigger
+        TRIGGERED,              // recording the post-trigger samples
+        FROZEN                  // recording complete, ready for export
+    };
+
+    SignalRecorder();
+    bool setChannel(uint8_t slot, Channel channel);
+    bool setTrigger(TriggerType type, int16_t value, uint8_t slot);
+    void setPreTriggerSamples(uint16_t samples);
+    void arm();
+    void trigger();
+    void triggerFault(uint16_t code);
+    void sample();
+    State getState();
+    uint16_t getExportSize();
+    uint16_t exportData(uint16_t offset, uint8_t *buffer, uint16_t length);
+    void exportSerial();
+    void printStatus();
+
+private:
+    int16_t samples[CFG_RECORDER_SAMPLES][CFG_RECORDER_CHANNELS]; // ring buffer of the samples
+    uint8_t channels[CFG_RECORDER_CHANNELS]; // the Channel sampled in each slot
+    uint16_t head; // index where the next sample is stored
+    uint16_t count; // number of valid samples in the buffer
+    uint16_t preTrigger; // number of samples to keep before the trigger
+    uint16_t postRemaining; // samples still to be taken after the trigger
+    uint16_t triggerPosition; // index of the trigger sample within the frozen recording
+    TriggerType triggerType;
+    int16_t triggerValue;
+    uint8_t triggerSlot;
+    uint16_t triggerFaultCode; // fault code which fired the trigger
+    volatile uint16_t pendingFault; // fault code reported via triggerFault(), processed with the next sample
+    volatile bool pendingTrigger; // manual or fault trigger, processed with the next sample
+    uint8_t lastState; // system state of the last sample (for TRIGGER_STATE)
+    uint32_t triggerTime; // micros() of the trigger sample
+    uint32_t sampleInterval; // average time between samples after freezing
+    State state;
+
+    int16_t readChannel(uint8_t channel);
+    bool checkTrigger(int16_t *values);
+    void fillHeader(RECORDER_HEADER *header);
+};
+
+extern SignalRecorder signalRecorder;
+
+#endif /* SIGNAL_RECORDER_H_ */
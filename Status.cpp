@@ -26,6 +26,7 @@
 
 #include "Status.h"
 #include "DeviceManager.h"
+#include "BootTimeline.h"
 
 Status status;
 
@@ -229,7 +230,11 @@ Status::SystemState Status::setSystemState(SystemState newSystemState)
     }
 
     SystemState params[] = { oldSystemState, systemState };
+    bootTimeline.add(BootTimeline::STATE, systemState, micros());
     deviceManager.sendMessage(DEVICE_ANY, INVALID, MSG_STATE_CHANGE, params);
+    if (systemState == ready || systemState == error) {
+        bootTimeline.stop(); // time from reset until the system is ready to drive
+    }
 
     return systemState;
 }
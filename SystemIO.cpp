@@ -32,6 +32,7 @@
 
 #include "SystemIO.h"
 #include "DeviceManager.h"
+#include "CanIO.h"
 
 #undef HID_ENABLED
 
@@ -43,6 +44,7 @@ SystemIO systemIO;
 SystemIO::SystemIO() {
     configuration = new SystemIOConfiguration();
     prefsHandler = NULL;
+    remoteIO = NULL;
     preChargeStart = 0;
     useRawADC = false;
     deactivatedPowerSteering =  false;
@@ -690,6 +692,9 @@ void SystemIO::ADCPoll() {
  * then a separate polled step.
  */
 uint16_t SystemIO::getAnalogIn(uint8_t which) {
+    if (which >= CFG_NUMBER_ANALOG_INPUTS && remoteIO != NULL && remoteIO->isRemoteAnalogInput(which)) {
+        return remoteIO->getRemoteAnalogIn(which);
+    }
     if (which >= CFG_NUMBER_ANALOG_INPUTS) {
         which = 0;
     }
@@ -697,12 +702,12 @@ uint16_t SystemIO::getAnalogIn(uint8_t which) {
 }
 
 /*
- * Get value of one of the 4 digital inputs.
+ * Get value of one of the 4 digital inputs (or of a remote input of a CAN I/O extension node).
  * If input is not configured, false is returned.
  */
 bool SystemIO::getDigitalIn(uint8_t which) {
     if (which >= CFG_NUMBER_DIGITAL_INPUTS) {
-        return false;
+        return (remoteIO != NULL && remoteIO->getRemoteDigitalIn(which));
     }
     if (dig[which] == CFG_OUTPUT_NONE) {
         return false;
@@ -716,6 +721,9 @@ bool SystemIO::getDigitalIn(uint8_t which) {
  */
 void SystemIO::setDigitalOut(uint8_t which, boolean active) {
     if (which >= CFG_NUMBER_DIGITAL_OUTPUTS) {
+        if (remoteIO != NULL) {
+            remoteIO->setRemoteOutput(which, active ? 255 : 0);
+        }
         return;
     }
     if (out[which] == CFG_OUTPUT_NONE) {
@@ -732,7 +740,7 @@ void SystemIO::setDigitalOut(uint8_t which, boolean active) {
  */
 bool SystemIO::getDigitalOut(uint8_t which) {
     if (which >= CFG_NUMBER_DIGITAL_OUTPUTS) {
-        return false;
+        return (remoteIO != NULL && remoteIO->getRemoteOutput(which) != 0);
     }
     if (out[which] == 255) {
         return false;
@@ -746,6 +754,9 @@ bool SystemIO::getDigitalOut(uint8_t which) {
  */
 void SystemIO::setAnalogOut(uint8_t which, uint8_t value) {
     if (which >= CFG_NUMBER_DIGITAL_OUTPUTS) {
+        if (remoteIO != NULL) {
+            remoteIO->setRemoteOutput(which, value);
+        }
         return;
     }
     if (out[which] == CFG_OUTPUT_NONE) {
@@ -1053,6 +1064,14 @@ void SystemIO::printIOStatus() {
     }
 }
 
+/*
+ * Register the provider of remote I/O channels (or NULL to remove it).
+ * Channels beyond the local ones are forwarded to it.
+ */
+void SystemIO::setRemoteIO(CanIO *canIO) {
+    remoteIO = canIO;
+}
+
 /*
  * Move DMA pointers to next buffer.
  */
@@ -1136,96 +1155,53 @@ SystemIOConfiguration *SystemIO::getConfiguration() {
     return configuration;
 }
 
+/*
+ * Schema of the system I/O configuration (EEPROM address, member, type, default, version)
+ */
+const PrefField SystemIO::configurationSchema[] = {
+    PREF_FIELD(EESIO_SYSTEM_TYPE, SystemIOConfiguration, systemType, PREF_ENUM, SystemIOConfiguration::GEVCU4, 0),
+    PREF_FIELD(EESIO_LOG_LEVEL, SystemIOConfiguration, logLevel, PREF_ENUM, Logger::Info, 0),
+    PREF_FIELD(EESIO_ENABLE_INPUT, SystemIOConfiguration, enableInput, PREF_UINT8, 0, 0),
+    PREF_FIELD(EESIO_PRECHARGE_MILLIS, SystemIOConfiguration, prechargeMillis, PREF_UINT16, 3000, 0),
+    PREF_FIELD(EESIO_SECONDARY_CONTACTOR_OUTPUT, SystemIOConfiguration, secondaryContactorOutput, PREF_UINT8, 2, 0),
+    PREF_FIELD(EESIO_PRECHARGE_RELAY_OUTPUT, SystemIOConfiguration, prechargeRelayOutput, PREF_UINT8, 4, 0),
+    PREF_FIELD(EESIO_MAIN_CONTACTOR_OUTPUT, SystemIOConfiguration, mainContactorOutput, PREF_UINT8, 5, 0),
+    PREF_FIELD(EESIO_ENABLE_MOTOR_OUTPUT, SystemIOConfiguration, enableMotorOutput, PREF_UINT8, 3, 0),
+    PREF_FIELD(EESIO_COOLING_FAN_OUTPUT, SystemIOConfiguration, coolingFanOutput, PREF_UINT8, CFG_OUTPUT_NONE, 0),
+    PREF_FIELD(EESIO_COOLING_TEMP_ON, SystemIOConfiguration, coolingTempOn, PREF_UINT8, 40, 0),
+    PREF_FIELD(EESIO_COOLING_TEMP_OFF, SystemIOConfiguration, coolingTempOff, PREF_UINT8, 35, 0),
+    PREF_FIELD(EESIO_BRAKE_LIGHT_OUTPUT, SystemIOConfiguration, brakeLightOutput, PREF_UINT8, CFG_OUTPUT_NONE, 0),
+    PREF_FIELD(EESIO_REVERSE_LIGHT_OUTPUT, SystemIOConfiguration, reverseLightOutput, PREF_UINT8, CFG_OUTPUT_NONE, 0),
+    PREF_FIELD(EESIO_INTERLOCK_INPUT, SystemIOConfiguration, interlockInput, PREF_UINT8, CFG_OUTPUT_NONE, 0),
+    PREF_FIELD(EESIO_CHARGE_POWER_AVAILABLE_INPUT, SystemIOConfiguration, chargePowerAvailableInput, PREF_UINT8, 1, 0),
+    PREF_FIELD(EESIO_FAST_CHARGE_CONTACTOR_OUTPUT, SystemIOConfiguration, fastChargeContactorOutput, PREF_UINT8, CFG_OUTPUT_NONE, 0),
+    PREF_FIELD(EESIO_ENABLE_CHARGER_OUTPUT, SystemIOConfiguration, enableChargerOutput, PREF_UINT8, CFG_OUTPUT_NONE, 0),
+    PREF_FIELD(EESIO_ENABLE_DCDC_OUTPUT, SystemIOConfiguration, enableDcDcOutput, PREF_UINT8, CFG_OUTPUT_NONE, 0),
+    PREF_FIELD(EESIO_ENABLE_HEATER_OUTPUT, SystemIOConfiguration, enableHeaterOutput, PREF_UINT8, CFG_OUTPUT_NONE, 0),
+    PREF_FIELD(EESIO_HEATER_VALVE_OUTPUT, SystemIOConfiguration, heaterValveOutput, PREF_UINT8, CFG_OUTPUT_NONE, 0),
+    PREF_FIELD(EESIO_HEATER_PUMP_OUTPUT, SystemIOConfiguration, heaterPumpOutput, PREF_UINT8, CFG_OUTPUT_NONE, 0),
+    PREF_FIELD(EESIO_COOLING_PUMP_OUTPUT, SystemIOConfiguration, coolingPumpOutput, PREF_UINT8, CFG_OUTPUT_NONE, 0),
+    PREF_FIELD(EESIO_WARNING_OUTPUT, SystemIOConfiguration, warningOutput, PREF_UINT8, CFG_OUTPUT_NONE, 0),
+    PREF_FIELD(EESIO_POWER_LIMITATION_OUTPUT, SystemIOConfiguration, powerLimitationOutput, PREF_UINT8, CFG_OUTPUT_NONE, 0),
+    PREF_FIELD(EESIO_REVERSE_INPUT, SystemIOConfiguration, reverseInput, PREF_UINT8, CFG_OUTPUT_NONE, 0),
+    PREF_FIELD(EESIO_POWER_STEERING_OUTPUT, SystemIOConfiguration, powerSteeringOutput, PREF_UINT8, CFG_OUTPUT_NONE, 0),
+    PREF_FIELD(EESIO_CAR_TYPE, SystemIOConfiguration, carType, PREF_ENUM, SystemIOConfiguration::OBD2, 0),
+    PREF_FIELD(EESIO_STATE_OF_CHARGE_OUTPUT, SystemIOConfiguration, stateOfChargeOutput, PREF_UINT8, CFG_OUTPUT_NONE, 0),
+    PREF_FIELD(EESIO_GEAR_CHANGE_INPUT, SystemIOConfiguration, gearChangeInput, PREF_UINT8, CFG_OUTPUT_NONE, 0),
+    PREF_FIELD(EESIO_STATUS_LIGHT_OUTPUT, SystemIOConfiguration, statusLightOutput, PREF_UINT8, CFG_OUTPUT_NONE, 0),
+    PREF_FIELD(EESIO_HEATER_TEMPERATURE_ON, SystemIOConfiguration, heaterTemperatureOn, PREF_UINT8, 3, 0),
+    PREF_FIELD(EESIO_ABS_INPUT, SystemIOConfiguration, absInput, PREF_UINT8, CFG_OUTPUT_NONE, 0)
+};
+
 void SystemIO::loadConfiguration() {
     logger.info("System I/O configuration:");
 
-#ifdef USE_HARD_CODED
-    if (false) {
-#else
-    if (prefsHandler->checksumValid()) { //checksum is good, read in the values stored in EEPROM
-#endif
-        prefsHandler->read(EESIO_ENABLE_INPUT, &configuration->enableInput);
-        prefsHandler->read(EESIO_CHARGE_POWER_AVAILABLE_INPUT, &configuration->chargePowerAvailableInput);
-        prefsHandler->read(EESIO_INTERLOCK_INPUT, &configuration->interlockInput);
-        prefsHandler->read(EESIO_REVERSE_INPUT, &configuration->reverseInput);
-        prefsHandler->read(EESIO_GEAR_CHANGE_INPUT, &configuration->gearChangeInput);
-        prefsHandler->read(EESIO_ABS_INPUT, &configuration->absInput);
-
-        prefsHandler->read(EESIO_PRECHARGE_MILLIS, &configuration->prechargeMillis);
-        prefsHandler->read(EESIO_PRECHARGE_RELAY_OUTPUT, &configuration->prechargeRelayOutput);
-        prefsHandler->read(EESIO_MAIN_CONTACTOR_OUTPUT, &configuration->mainContactorOutput);
-        prefsHandler->read(EESIO_SECONDARY_CONTACTOR_OUTPUT, &configuration->secondaryContactorOutput);
-        prefsHandler->read(EESIO_FAST_CHARGE_CONTACTOR_OUTPUT, &configuration->fastChargeContactorOutput);
-
-        prefsHandler->read(EESIO_ENABLE_MOTOR_OUTPUT, &configuration->enableMotorOutput);
-        prefsHandler->read(EESIO_ENABLE_CHARGER_OUTPUT, &configuration->enableChargerOutput);
-        prefsHandler->read(EESIO_ENABLE_DCDC_OUTPUT, &configuration->enableDcDcOutput);
-        prefsHandler->read(EESIO_ENABLE_HEATER_OUTPUT, &configuration->enableHeaterOutput);
-        prefsHandler->read(EESIO_HEATER_TEMPERATURE_ON, &configuration->heaterTemperatureOn);
-
-        prefsHandler->read(EESIO_HEATER_VALVE_OUTPUT, &configuration->heaterValveOutput);
-        prefsHandler->read(EESIO_HEATER_PUMP_OUTPUT, &configuration->heaterPumpOutput);
-        prefsHandler->read(EESIO_COOLING_PUMP_OUTPUT, &configuration->coolingPumpOutput);
-        prefsHandler->read(EESIO_COOLING_FAN_OUTPUT, &configuration->coolingFanOutput);
-        prefsHandler->read(EESIO_COOLING_TEMP_ON, &configuration->coolingTempOn);
-        prefsHandler->read(EESIO_COOLING_TEMP_OFF, &configuration->coolingTempOff);
-
-        prefsHandler->read(EESIO_BRAKE_LIGHT_OUTPUT, &configuration->brakeLightOutput);
-        prefsHandler->read(EESIO_REVERSE_LIGHT_OUTPUT, &configuration->reverseLightOutput);
-        prefsHandler->read(EESIO_POWER_STEERING_OUTPUT, &configuration->powerSteeringOutput);
-
-        prefsHandler->read(EESIO_WARNING_OUTPUT, &configuration->warningOutput);
-        prefsHandler->read(EESIO_POWER_LIMITATION_OUTPUT, &configuration->powerLimitationOutput);
-        prefsHandler->read(EESIO_STATE_OF_CHARGE_OUTPUT, &configuration->stateOfChargeOutput);
-        prefsHandler->read(EESIO_STATUS_LIGHT_OUTPUT, &configuration->statusLightOutput);
-
-        prefsHandler->read(EESIO_SYSTEM_TYPE, (uint8_t *) &configuration->systemType);
-        prefsHandler->read(EESIO_CAR_TYPE, (uint8_t *) &configuration->carType);
-        prefsHandler->read(EESIO_LOG_LEVEL, (uint8_t *) &configuration->logLevel);
-        logger.setLoglevel((Logger::LogLevel) configuration->logLevel);
-    } else { //checksum invalid. Reinitialize values and store to EEPROM
-        configuration->enableInput = 0;
-        configuration->chargePowerAvailableInput = 1;
-        configuration->interlockInput = CFG_OUTPUT_NONE;
-        configuration->reverseInput = CFG_OUTPUT_NONE;
-        configuration->absInput = CFG_OUTPUT_NONE;
-        configuration->gearChangeInput = CFG_OUTPUT_NONE;
-
-        configuration->prechargeMillis = 3000;
-        configuration->prechargeRelayOutput = 4;
-        configuration->mainContactorOutput = 5;
-        configuration->secondaryContactorOutput = 2;
-        configuration->fastChargeContactorOutput = CFG_OUTPUT_NONE;
-
-        configuration->enableMotorOutput = 3;
-        configuration->enableChargerOutput = CFG_OUTPUT_NONE;
-        configuration->enableDcDcOutput = CFG_OUTPUT_NONE;
-        configuration->enableHeaterOutput = CFG_OUTPUT_NONE;
-        configuration->heaterTemperatureOn = 3;
-
-        configuration->heaterValveOutput = CFG_OUTPUT_NONE;
-        configuration->heaterPumpOutput = CFG_OUTPUT_NONE;
-        configuration->coolingPumpOutput = CFG_OUTPUT_NONE;
-        configuration->coolingFanOutput = CFG_OUTPUT_NONE;
-        configuration->coolingTempOn = 40;
-        configuration->coolingTempOff = 35;
-
-        configuration->brakeLightOutput = CFG_OUTPUT_NONE;
-        configuration->reverseLightOutput = CFG_OUTPUT_NONE;
-        configuration->powerSteeringOutput = CFG_OUTPUT_NONE;
-        configuration->unusedOutput = CFG_OUTPUT_NONE;
-
-        configuration->warningOutput = CFG_OUTPUT_NONE;
-        configuration->powerLimitationOutput = CFG_OUTPUT_NONE;
-        configuration->stateOfChargeOutput = CFG_OUTPUT_NONE;
-        configuration->statusLightOutput = CFG_OUTPUT_NONE;
-
-        configuration->systemType = SystemIOConfiguration::GEVCU4;
-        configuration->carType = SystemIOConfiguration::OBD2;
-        configuration->logLevel = logger.Info;
-
-        saveConfiguration();
+    if (!prefsHandler->load(configuration, configurationSchema, sizeof(configurationSchema) / sizeof(PrefField))) {
+        saveConfiguration(); // checksum invalid, store the defaults
     }
+    configuration->unusedOutput = CFG_OUTPUT_NONE; // not stored
+    logger.setLoglevel((Logger::LogLevel) configuration->logLevel);
+
     logger.info("enable input: %d, charge power avail input: %d, interlock input: %d, reverse input: %d, abs input: %d", configuration->enableInput, configuration->chargePowerAvailableInput, configuration->interlockInput, configuration->reverseInput, configuration->absInput);
     logger.info("pre-charge milliseconds: %d, pre-charge relay: %d, main contactor: %d, gear change input: %d", configuration->prechargeMillis, configuration->prechargeRelayOutput, configuration->mainContactorOutput, configuration->gearChangeInput);
     logger.info("secondary contactor: %d, fast charge contactor: %d", configuration->secondaryContactorOutput, configuration->fastChargeContactorOutput);
@@ -1238,44 +1214,6 @@ void SystemIO::loadConfiguration() {
 }
 
 void SystemIO::saveConfiguration() {
-    prefsHandler->write(EESIO_ENABLE_INPUT, configuration->enableInput);
-    prefsHandler->write(EESIO_CHARGE_POWER_AVAILABLE_INPUT, configuration->chargePowerAvailableInput);
-    prefsHandler->write(EESIO_INTERLOCK_INPUT, configuration->interlockInput);
-    prefsHandler->write(EESIO_REVERSE_INPUT, configuration->reverseInput);
-    prefsHandler->write(EESIO_GEAR_CHANGE_INPUT, configuration->gearChangeInput);
-    prefsHandler->write(EESIO_ABS_INPUT, configuration->absInput);
-
-    prefsHandler->write(EESIO_PRECHARGE_MILLIS, configuration->prechargeMillis);
-    prefsHandler->write(EESIO_PRECHARGE_RELAY_OUTPUT, configuration->prechargeRelayOutput);
-    prefsHandler->write(EESIO_MAIN_CONTACTOR_OUTPUT, configuration->mainContactorOutput);
-    prefsHandler->write(EESIO_SECONDARY_CONTACTOR_OUTPUT, configuration->secondaryContactorOutput);
-    prefsHandler->write(EESIO_FAST_CHARGE_CONTACTOR_OUTPUT, configuration->fastChargeContactorOutput);
-
-    prefsHandler->write(EESIO_ENABLE_MOTOR_OUTPUT, configuration->enableMotorOutput);
-    prefsHandler->write(EESIO_ENABLE_CHARGER_OUTPUT, configuration->enableChargerOutput);
-    prefsHandler->write(EESIO_ENABLE_DCDC_OUTPUT, configuration->enableDcDcOutput);
-    prefsHandler->write(EESIO_ENABLE_HEATER_OUTPUT, configuration->enableHeaterOutput);
-    prefsHandler->write(EESIO_HEATER_TEMPERATURE_ON, configuration->heaterTemperatureOn);
-
-    prefsHandler->write(EESIO_HEATER_VALVE_OUTPUT, configuration->heaterValveOutput);
-    prefsHandler->write(EESIO_HEATER_PUMP_OUTPUT, configuration->heaterPumpOutput);
-    prefsHandler->write(EESIO_COOLING_PUMP_OUTPUT, configuration->coolingPumpOutput);
-    prefsHandler->write(EESIO_COOLING_FAN_OUTPUT, configuration->coolingFanOutput);
-    prefsHandler->write(EESIO_COOLING_TEMP_ON, configuration->coolingTempOn);
-    prefsHandler->write(EESIO_COOLING_TEMP_OFF, configuration->coolingTempOff);
-
-    prefsHandler->write(EESIO_BRAKE_LIGHT_OUTPUT, configuration->brakeLightOutput);
-    prefsHandler->write(EESIO_REVERSE_LIGHT_OUTPUT, configuration->reverseLightOutput);
-    prefsHandler->write(EESIO_POWER_STEERING_OUTPUT, configuration->powerSteeringOutput);
-
-    prefsHandler->write(EESIO_WARNING_OUTPUT, configuration->warningOutput);
-    prefsHandler->write(EESIO_POWER_LIMITATION_OUTPUT, configuration->powerLimitationOutput);
-    prefsHandler->write(EESIO_STATE_OF_CHARGE_OUTPUT, configuration->stateOfChargeOutput);
-    prefsHandler->write(EESIO_STATUS_LIGHT_OUTPUT, configuration->statusLightOutput);
-
-    prefsHandler->write(EESIO_SYSTEM_TYPE, (uint8_t) configuration->systemType);
-    prefsHandler->write(EESIO_CAR_TYPE, (uint8_t) configuration->carType);
-    prefsHandler->write(EESIO_LOG_LEVEL, (uint8_t) configuration->logLevel);
-
+    prefsHandler->save(configuration, configurationSchema, sizeof(configurationSchema) / sizeof(PrefField));
     prefsHandler->saveChecksum();
 }
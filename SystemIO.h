@@ -39,6 +39,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Status.h"
 
 class Status;
+class CanIO;
 
 class SystemIOConfiguration
 {
@@ -143,6 +144,7 @@ public:
     void ADCPoll();
     uint32_t getNextADCBuffer();
     void printIOStatus();
+    void setRemoteIO(CanIO *);
 
     void setSystemType(SystemIOConfiguration::SystemType);
     SystemIOConfiguration::SystemType getSystemType();
@@ -155,6 +157,8 @@ public:
 protected:
 
 private:
+    static const PrefField configurationSchema[];
+
     typedef struct {
         uint16_t offset;
         uint16_t gain;
@@ -179,6 +183,7 @@ private:
     uint32_t preChargeStart; // time-stamp when pre-charge cycle has started
     SystemIOConfiguration *configuration;
     PrefHandler *prefsHandler;
+    CanIO *remoteIO; // provides the channels beyond the local ones (CAN I/O extension nodes)
     bool deactivatedPowerSteering, deactivatedHeater;
 
     void initializePinTables();
@@ -0,0 +1,258 @@
+/*
+ * SystemLog.cpp
+ *
+ * Persistent log of warnings and errors in the EEPROM which survives a reset
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "SystemLog.h"
+#include "FaultHandler.h"
+#include "DeviceManager.h"
+
+SystemLog systemLog;
+
+SystemLog::SystemLog()
+{
+    queueHead = 0;
+    queueTail = 0;
+    dropped = 0;
+    head = 0;
+    sequence = 0;
+    ready = false;
+}
+
+/*
+ * Find the head of the ring. The records from slot 0 up to the head carry consecutive
+ * sequence numbers, so the first slot which breaks the sequence is found by a binary search.
+ * Must be called after memCache.setup(). Messages logged before are kept in the queue.
+ */
+void SystemLog::setup()
+{
+    SYSLOG_RECORD record;
+
+    tickHandler.detach(this);
+
+    head = 0;
+    sequence = 0;
+    if (readRecord(0, &record)) {
+        uint16_t first = record.sequence;
+        uint16_t low = 1, high = SYSLOG_NUM_SLOTS;
+
+        while (low < high) {
+            uint16_t middle = (low + high) / 2;
+            if (isSuccessor(middle, first)) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        head = low % SYSLOG_NUM_SLOTS;
+        sequence = first + low;
+    }
+    ready = true;
+
+    tickHandler.attach(this, CFG_TICK_INTERVAL_SYSTEM_LOG);
+    logger.info("System log: next slot %d", head);
+}
+
+/*
+ * Write the queued records to the cache and flush the affected pages, so the
+ * records are in the EEPROM even if the power is cut right after.
+ */
+void SystemLog::handleTick()
+{
+    uint32_t page = 0, lastPage = 0;
+    bool written = false;
+
+    if (!ready) {
+        return;
+    }
+    while (queueTail != queueHead) {
+        SYSLOG_RECORD *record = &queue[queueTail];
+        uint32_t address = EE_SYS_LOG + head * sizeof(SYSLOG_RECORD);
+
+        record->sequence = sequence++;
+        record->crc = calculateCrc(record);
+        memCache.Write(address, record, sizeof(SYSLOG_RECORD));
+
+        page = address >> 8;
+        if (written && page != lastPage) {
+            memCache.FlushAddress(lastPage << 8);
+        }
+        lastPage = page;
+        written = true;
+
+        head = (head + 1) % SYSLOG_NUM_SLOTS;
+        queueTail = (queueTail + 1) % CFG_SYSLOG_QUEUE_SIZE;
+    }
+    if (written) {
+        memCache.FlushAddress(lastPage << 8);
+    }
+    if (dropped > 0) {
+        logger.warn("%d system log records dropped", dropped);
+        dropped = 0;
+    }
+}
+
+/*
+ * Queue a log message (called by the Logger). Formats in the flash with up to SYSLOG_MAX_ARGS
+ * argument words (argCount) are stored as format id and arguments, all others as the beginning
+ * of the formatted text.
+ */
+void SystemLog::add(uint16_t deviceId, Logger::LogLevel level, const char *format, uint8_t argCount, va_list args)
+{
+    uint8_t next = (queueHead + 1) % CFG_SYSLOG_QUEUE_SIZE;
+
+    if (next == queueTail) {
+        if (dropped < 0xFFFF) {
+            dropped++;
+        }
+        return;
+    }
+
+    SYSLOG_RECORD *record = &queue[queueHead];
+    record->time = faultHandler.getRuntime();
+    record->deviceId = deviceId;
+    record->build = CFG_BUILD_NUM;
+    record->format = 0;
+    if (LOG_IS_CONSTANT(format) && ((uintptr_t) format & ~SYSLOG_FORMAT_ADDRESS) == 0) {
+        record->format = (uint32_t) (uintptr_t) format | ((uint32_t) calculateFormatCrc(format) << 24);
+    }
+    memset(record->args, 0, sizeof(record->args));
+    if (record->format != 0 && argCount <= SYSLOG_MAX_ARGS) {
+        for (uint8_t i = 0; i < argCount; i++) {
+            record->args[i] = va_arg(args, uint32_t);
+        }
+    } else {
+        vsnprintf(record->text, sizeof(record->text), format, args);
+        argCount = SYSLOG_TEXT;
+    }
+    record->level = level | (argCount << 4);
+    queueHead = next;
+}
+
+/*
+ * Print all records of the ring, oldest first. The messages can only be formatted if they
+ * were written by the same firmware build and the format is verified, otherwise the format id
+ * and arguments are shown.
+ */
+void SystemLog::print(Print &printer)
+{
+    SYSLOG_RECORD record;
+    char buffer[LOG_BUFFER_SIZE];
+    const char *format;
+
+    handleTick(); // include the queued records
+
+    printer.println("SYSTEM LOG START");
+    for (uint16_t i = 0; i < SYSLOG_NUM_SLOTS; i++) {
+        if (!readRecord((head + i) % SYSLOG_NUM_SLOTS, &record)) {
+            continue;
+        }
+
+        uint8_t argCount = record.level >> 4;
+        if (argCount == SYSLOG_TEXT) {
+            record.text[sizeof(record.text) - 1] = 0;
+            snprintf(buffer, LOG_BUFFER_SIZE, "%s...", record.text);
+        } else if ((format = getFormat(&record)) != NULL) {
+            snprintf(buffer, LOG_BUFFER_SIZE, format, record.args[0], record.args[1], record.args[2], record.args[3]);
+        } else {
+            snprintf(buffer, LOG_BUFFER_SIZE, "format %#x of build %d: %#x, %#x, %#x, %#x", record.format, record.build, record.args[0],
+                    record.args[1], record.args[2], record.args[3]);
+        }
+
+        Device *device = (record.deviceId != NEW ? deviceManager.getDeviceByID((DeviceId) record.deviceId) : NULL);
+        printer.print(record.time / 10);
+        printer.print(".");
+        printer.print(record.time % 10);
+        printer.print("s - ");
+        printer.print(logger.logLevelToString((Logger::LogLevel) (record.level & 0x0F)));
+        printer.print(": ");
+        if (device != NULL) {
+            printer.print(device->getCommonName());
+            printer.print(" - ");
+        }
+        printer.println(buffer);
+        logger.handOff();
+    }
+    printer.println("SYSTEM LOG END");
+}
+
+/*
+ * Get the format string of a record if it can be used: written by this build, the address in the
+ * flash and the string there has the CRC8 stored with it (e.g. not a different build with the
+ * same build number). Returns NULL otherwise.
+ */
+const char *SystemLog::getFormat(SYSLOG_RECORD *record)
+{
+    uint32_t address = record->format & SYSLOG_FORMAT_ADDRESS;
+
+    if (record->build != CFG_BUILD_NUM || address < SYSLOG_FLASH_START || address >= SYSLOG_FLASH_END) {
+        return NULL;
+    }
+    const char *format = (const char *) (uintptr_t) address;
+    if (calculateFormatCrc(format) != (record->format >> 24)) {
+        return NULL;
+    }
+    return format;
+}
+
+/*
+ * Calculate the CRC8 of a format string (at most LOG_BUFFER_SIZE characters, fits the byte length of CRC8)
+ */
+uint8_t SystemLog::calculateFormatCrc(const char *format)
+{
+    return CRC8::calculate((byte *) format, strnlen(format, LOG_BUFFER_SIZE));
+}
+
+/*
+ * Read a record from the EEPROM, returns false if the slot is empty or corrupt
+ */
+bool SystemLog::readRecord(uint16_t slot, SYSLOG_RECORD *record)
+{
+    memCache.Read(EE_SYS_LOG + slot * sizeof(SYSLOG_RECORD), record, sizeof(SYSLOG_RECORD));
+    return record->crc == calculateCrc(record);
+}
+
+/*
+ * Is the record in a slot valid and was it written right after the one in slot 0 (in the same round)
+ */
+bool SystemLog::isSuccessor(uint16_t slot, uint16_t firstSequence)
+{
+    SYSLOG_RECORD record;
+
+    return readRecord(slot, &record) && record.sequence == (uint16_t) (firstSequence + slot);
+}
+
+/*
+ * Calculate the CRC8 of a record (with its crc field set to 0).
+ * The result is inverted so a zeroed slot is not mistaken for a valid record.
+ */
+uint8_t SystemLog::calculateCrc(SYSLOG_RECORD *record)
+{
+    SYSLOG_RECORD temp = *record;
+
+    temp.crc = 0;
+    return ~CRC8::calculate((uint8_t *) &temp, sizeof(SYSLOG_RECORD));
+}
@@ -0,0 +1,99 @@
+/*
+ * SystemLog.h
+ *
+ * Persistent log of warnings and errors in the EEPROM which survives a reset
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef SYSTEM_LOG_H_
+#define SYSTEM_LOG_H_
+
+#include <Arduino.h>
+#include "config.h"
+#include "MemCache.h"
+#include "CRC8.h"
+#include "Logger.h"
+#include "TickHandler.h"
+#include "eeprom_layout.h"
+
+#define SYSLOG_NUM_SLOTS    (EE_SYS_LOG_SIZE / sizeof(SYSLOG_RECORD))
+#define SYSLOG_MAX_ARGS     4 // number of argument words stored with a record
+#define SYSLOG_TEXT         0x0F // argument count of a record which holds the beginning of the message text instead of arguments
+#define SYSLOG_FLASH_START  0x00080000 // start of the flash of the SAM3X, format ids below can't be valid
+#define SYSLOG_FLASH_END    0x00100000 // end of the flash of the SAM3X (512kB), format ids above can't be valid
+#define SYSLOG_FORMAT_ADDRESS 0x00FFFFFF // bits of the format id which hold the address, the top byte holds the CRC8 of the format
+
+/*
+ * A log message in the EEPROM. Instead of the text, the address of the format string in the flash
+ * (format id) and the raw argument words are stored. The text is only formatted when the log is
+ * read, which is only possible with the same firmware build and if the string at the address still
+ * has the CRC8 stored with the format id. 32 bytes so 8 records fit a page.
+ */
+typedef struct {
+    uint16_t sequence; // incremented with every appended record (wraps around)
+    uint8_t crc; // CRC8 over the record with crc = 0
+    uint8_t level; // LogLevel (bits 0-3) and number of arguments or SYSLOG_TEXT (bits 4-7)
+    uint32_t time; // total runtime of the system in 0.1s (see FaultHandler)
+    uint32_t format; // address of the format string (bits 0-23) and its CRC8 (bits 24-31), 0 = unknown (text only)
+    uint16_t deviceId; // the DeviceId of the device which logged the message, NEW = none
+    uint16_t build; // CFG_BUILD_NUM of the firmware which wrote the record
+    union {
+        uint32_t args[SYSLOG_MAX_ARGS]; // the raw argument words
+        char text[SYSLOG_MAX_ARGS * 4]; // the beginning of the formatted message (incl. terminating zero)
+    };
+} SYSLOG_RECORD;
+
+/*
+ * Warnings and errors are appended as sequence-numbered records to a ring in the EEPROM.
+ * Logging only queues the record in RAM, the queue is written in one batch via the MemCache
+ * and flushed every tick, so the log survives a power cycle. At start-up the head of the
+ * ring is found with a binary search over the sequence numbers.
+ */
+class SystemLog: public TickObserver
+{
+public:
+    SystemLog();
+    void setup();
+    void handleTick();
+    void add(uint16_t deviceId, Logger::LogLevel level, const char *format, uint8_t argCount, va_list args);
+    void print(Print &printer);
+
+private:
+    SYSLOG_RECORD queue[CFG_SYSLOG_QUEUE_SIZE]; // records which are not written to the EEPROM yet
+    uint8_t queueHead, queueTail; // write and read index of queue
+    uint16_t dropped; // number of records dropped because the queue was full
+    uint16_t head; // the slot where the next record is written
+    uint16_t sequence; // the sequence number of the next record
+    bool ready; // the head was determined, records may be written
+
+    bool readRecord(uint16_t slot, SYSLOG_RECORD *record);
+    bool isSuccessor(uint16_t slot, uint16_t firstSequence);
+    uint8_t calculateCrc(SYSLOG_RECORD *record);
+    uint8_t calculateFormatCrc(const char *format);
+    const char *getFormat(SYSLOG_RECORD *record);
+};
+
+extern SystemLog systemLog;
+
+#endif /* SYSTEM_LOG_H_ */
@@ -65,9 +65,7 @@ void Throttle::handleTick()
         level = 0;
         running = false;
     }
-    if(logger.isDebug()) {
-        logger.debug(this, "raw: %d, level: %d, running: %d", rawSignals->input1, level, running);
-    }
+    LOG_DEBUG(this, "raw: %d, level: %d, running: %d", rawSignals->input1, level, running);
 }
 
 /*
@@ -212,8 +210,20 @@ uint16_t Throttle::calculatePedalPosition(RawSignalData*)
 }
 
 /*
- * Load the config parameters which are required by all throttles
+ * Schema of the config parameters which are required by all throttles
+ * (EEPROM address, member, type, default, version)
  */
+const PrefField Throttle::configurationSchema[] = {
+    PREF_FIELD(EETH_LEVEL_MIN, ThrottleConfiguration, minimumLevel, PREF_UINT16, 95, 0),
+    PREF_FIELD(EETH_LEVEL_MAX, ThrottleConfiguration, maximumLevel, PREF_UINT16, 3150, 0),
+    PREF_FIELD(EETH_REGEN_MIN, ThrottleConfiguration, positionRegenMinimum, PREF_UINT16, 270, 0),
+    PREF_FIELD(EETH_REGEN_MAX, ThrottleConfiguration, positionRegenMaximum, PREF_UINT16, 30, 0),
+    PREF_FIELD(EETH_FWD, ThrottleConfiguration, positionForwardMotionStart, PREF_UINT16, 300, 0),
+    PREF_FIELD(EETH_MAP, ThrottleConfiguration, positionHalfPower, PREF_UINT16, 750, 0),
+    PREF_FIELD(EETH_MIN_ACCEL_REGEN, ThrottleConfiguration, minimumRegen, PREF_UINT8, 0, 0),
+    PREF_FIELD(EETH_MAX_ACCEL_REGEN, ThrottleConfiguration, maximumRegen, PREF_UINT8, 50, 0)
+};
+
 void Throttle::loadConfiguration()
 {
     ThrottleConfiguration *config = (ThrottleConfiguration *) getConfiguration();
@@ -221,31 +231,8 @@ void Throttle::loadConfiguration()
     Device::loadConfiguration(); // call parent
     logger.info(this, "Throttle configuration:");
 
-#ifdef USE_HARD_CODED
-
-    if (false) {
-#else
-
-    if (prefsHandler->checksumValid()) { //checksum is good, read in the values stored in EEPROM
-#endif
-        prefsHandler->read(EETH_LEVEL_MIN, &config->minimumLevel);
-        prefsHandler->read(EETH_LEVEL_MAX, &config->maximumLevel);
-        prefsHandler->read(EETH_REGEN_MIN, &config->positionRegenMinimum);
-        prefsHandler->read(EETH_REGEN_MAX, &config->positionRegenMaximum);
-        prefsHandler->read(EETH_FWD, &config->positionForwardMotionStart);
-        prefsHandler->read(EETH_MAP, &config->positionHalfPower);
-        prefsHandler->read(EETH_MIN_ACCEL_REGEN, &config->minimumRegen);
-        prefsHandler->read(EETH_MAX_ACCEL_REGEN, &config->maximumRegen);
-    } else { //checksum invalid. Reinitialize values, leave storing them to the subclasses
-        config->minimumLevel = 95;
-        config->maximumLevel = 3150;
-        config->positionRegenMinimum = 270;
-        config->positionRegenMaximum = 30;
-        config->positionForwardMotionStart = 300;
-        config->positionHalfPower = 750;
-        config->minimumRegen = 0;
-        config->maximumRegen = 50;
-    }
+    // if the checksum is invalid, the defaults are applied, leave storing them to the subclasses
+    prefsHandler->load(config, configurationSchema, sizeof(configurationSchema) / sizeof(PrefField));
 
     logger.info(this, "RegenMax: %ld RegenMin: %ld Fwd: %ld Map: %ld", config->positionRegenMaximum, config->positionRegenMinimum,
                   config->positionForwardMotionStart, config->positionHalfPower);
@@ -262,13 +249,6 @@ void Throttle::saveConfiguration()
 
     Device::saveConfiguration(); // call parent
 
-    prefsHandler->write(EETH_LEVEL_MIN, config->minimumLevel);
-    prefsHandler->write(EETH_LEVEL_MAX, config->maximumLevel);
-    prefsHandler->write(EETH_REGEN_MIN, config->positionRegenMinimum);
-    prefsHandler->write(EETH_REGEN_MAX, config->positionRegenMaximum);
-    prefsHandler->write(EETH_FWD, config->positionForwardMotionStart);
-    prefsHandler->write(EETH_MAP, config->positionHalfPower);
-    prefsHandler->write(EETH_MIN_ACCEL_REGEN, config->minimumRegen);
-    prefsHandler->write(EETH_MAX_ACCEL_REGEN, config->maximumRegen);
+    prefsHandler->save(config, configurationSchema, sizeof(configurationSchema) / sizeof(PrefField));
     prefsHandler->saveChecksum();
 }
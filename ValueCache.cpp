@@ -75,6 +75,9 @@ void ValueCache::clear()
     enableRegen = false;
     enableHeater = false;
     enableCreep = false;
+    memoryFree = 0;
+    heapUsed = 0;
+    stackUsed = 0;
     cruiseControlSpeed = 0;
     enableCruiseControl = false;
 
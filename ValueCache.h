@@ -75,6 +75,9 @@ public:
     bool enableRegen;
     bool enableHeater;
     bool enableCreep;
+    uint32_t memoryFree;
+    uint32_t heapUsed;
+    uint32_t stackUsed;
     int16_t cruiseControlSpeed;
     bool enableCruiseControl;
 
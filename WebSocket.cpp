@@ -26,6 +26,7 @@
  */
 
 #include "WebSocket.h"
+#include "MemoryMonitor.h"
 
 static const char *webSocketKeyName = "Sec-WebSocket-Key";
 static const String websocketUid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
@@ -221,6 +222,10 @@ String WebSocket::processData(char *input)
         } else if (strstr(text, "chargeInput=")) {
             logger.debug("Setting charge level to %d Amps", value);
             deviceManager.getCharger()->overrideMaximumInputCurrent(value * 10);
+        } else if (strstr(text, "freezeFrames")) {
+            return generateFreezeFrames();
+        } else if (strstr(text, "recording=")) {
+            return generateRecording(value);
         }
         break;
     }
@@ -298,6 +303,9 @@ String WebSocket::generateUpdate()
         valueCache.timeRunning = timeStamp;
         addValue(timeRunning, getTimeRunning(), false);
         processValue(&valueCache.systemState, (int16_t) status.getSystemState(), systemState);
+        processValue(&valueCache.memoryFree, memoryMonitor.getFree(), memoryFree);
+        processValue(&valueCache.heapUsed, memoryMonitor.getHeapUsed(), heapUsed);
+        processValue(&valueCache.stackUsed, memoryMonitor.getStackUsed(), stackUsed);
 
         if (batteryManager && checkTime()) {
             if (batteryManager->hasSoc())
@@ -429,7 +437,7 @@ String WebSocket::generateUpdate()
  * \return the prepared log message which can be sent to the socket
  *
  */
-String WebSocket::generateLogEntry(String logLevel, String deviceName, String message)
+String WebSocket::generateLogEntry(const char *logLevel, const char *deviceName, const char *message)
 {
     data = String();
 
@@ -439,7 +447,7 @@ String WebSocket::generateLogEntry(String logLevel, String deviceName, String me
     data.concat("{\"logMessage\": {\"level\": \"");
     data.concat(logLevel);
     data.concat("\",\"message\": \"");
-    if (deviceName != NULL) {
+    if (deviceName[0] != 0) {
         data.concat(deviceName);
         data.concat(": ");
     }
@@ -449,6 +457,76 @@ String WebSocket::generateLogEntry(String logLevel, String deviceName, String me
     return prepareWebSocketFrame(OPCODE_TEXT, data);
 }
 
+/**
+ * \brief Prepare a JSON object with the un-acknowledged faults and their freeze frames (most recent first)
+ *
+ * \return the web socket frame to be sent to the client
+ */
+String WebSocket::generateFreezeFrames()
+{
+    FAULT fault;
+    int faultnum;
+
+    data = String();
+    data.concat("{\"freezeFrames\": [");
+    for (uint8_t number = 0; (faultnum = faultHandler.getRecentFault(number)) != -1 && faultHandler.getFault(faultnum, &fault); number++) {
+        if (number > 0) {
+            data.concat(",");
+        }
+        data.concat("{\"code\": ");
+        data.concat(fault.faultCode);
+        data.concat(",\"device\": ");
+        data.concat(fault.device);
+        data.concat(",\"occurrences\": ");
+        data.concat(fault.occurrences);
+        data.concat(",\"firstTime\": ");
+        data.concat(fault.timeStamp);
+        data.concat(",\"lastTime\": ");
+        data.concat(fault.lastTimeStamp);
+        data.concat(",\"ongoing\": ");
+        data.concat(fault.ongoing ? "true" : "false");
+        for (uint8_t i = 0; i < CFG_FREEZE_FRAME_SIZE; i++) {
+            data.concat(",\"");
+            data.concat(FaultHandler::getFreezeFrameValueName(FaultHandler::getFreezeFrameValue(i)));
+            data.concat("\": ");
+            data.concat(fault.freezeFrame.values[i]);
+        }
+        data.concat("}");
+    }
+    data.concat("]}");
+
+    return prepareWebSocketFrame(OPCODE_TEXT, data);
+}
+
+/**
+ * \brief Prepare a JSON object with a chunk of the frozen signal recording (binary, base64 encoded)
+ *
+ * The client requests the chunks with increasing offsets until offset + length reaches size.
+ *
+ * \param offset the offset within the exported recording
+ * \return the web socket frame to be sent to the client
+ */
+String WebSocket::generateRecording(uint16_t offset)
+{
+    uint8_t chunk[CFG_RECORDER_EXPORT_CHUNK];
+    char encoded[CFG_RECORDER_EXPORT_CHUNK * 4 / 3 + 4];
+    uint16_t length = signalRecorder.exportData(offset, chunk, sizeof(chunk));
+
+    base64_encode(encoded, (char *) chunk, length);
+    data = String();
+    data.concat("{\"recording\": {\"size\": ");
+    data.concat(signalRecorder.getExportSize());
+    data.concat(",\"offset\": ");
+    data.concat(offset);
+    data.concat(",\"length\": ");
+    data.concat(length);
+    data.concat(",\"data\": \"");
+    data.concat(encoded);
+    data.concat("\"}}");
+
+    return prepareWebSocketFrame(OPCODE_TEXT, data);
+}
+
 /**
  * \brief Wrap data into a web socket frame with the necessary header information (see Rfc 6455)
  *
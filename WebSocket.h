@@ -15,13 +15,17 @@
 #include "Base64.h"
 #include "Sha1.h"
 #include "ValueCache.h"
+#include "FaultHandler.h"
+#include "SignalRecorder.h"
 
 class WebSocket: public SocketProcessor
 {
 public:
     WebSocket();
     String generateUpdate();
-    String generateLogEntry(String logLevel, String deviceName, String message);
+    String generateLogEntry(const char *logLevel, const char *deviceName, const char *message);
+    String generateFreezeFrames();
+    String generateRecording(uint16_t offset);
     String processInput(char *input);
 
 private:
@@ -121,6 +125,9 @@ private:
     const String enableRegen = "enableRegen";
     const String enableHeater = "enableHeater";
     const String enableCreep = "enableCreep";
+    const String memoryFree = "memoryFree";
+    const String heapUsed = "heapUsed";
+    const String stackUsed = "stackUsed";
     const String cruiseControlSpeed = "cruiseSpeed";
     const String enableCruiseControl = "enableCruiseControl";
 
@@ -63,9 +63,7 @@ void Wifi::processParameterChange(String key, String value)
                 processParameterChangeMotor(key, value) || processParameterChangeCharger(key, value) ||
                 processParameterChangeDcDc(key, value) || processParameterChangeDevices(key, value) ||
                 processParameterChangeSystemIO(key, value)) {
-            if (logger.isDebug()) {
-                logger.debug(this, "parameter change: %s = %s", key.c_str(), value.c_str());
-            }
+            LOG_DEBUG(this, "parameter change: %s = %s", key.c_str(), value.c_str());
         }
     }
 }
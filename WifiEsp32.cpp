@@ -27,6 +27,8 @@
  */
 
 #include "WifiEsp32.h"
+#include "SystemLog.h"
+#include "MemoryMonitor.h"
 
 WifiEsp32::WifiEsp32() : Wifi()
 {
@@ -93,9 +95,7 @@ void WifiEsp32::tearDown()
  */
 void WifiEsp32::sendCmd(String cmd)
 {
-    if (logger.isDebug()) {
-        logger.debug(this, "buffer: %s\n", cmd.c_str());
-    }
+    LOG_DEBUG(this, "buffer: %s\n", cmd.c_str());
     sendBuffer[psWritePtr++] = cmd;
     if (psWritePtr >= CFG_SERIAL_SEND_BUFFER_SIZE) {
         psWritePtr = 0;
@@ -171,7 +171,7 @@ void WifiEsp32::handleMessage(uint32_t messageType, void* message)
         break;
 
     case MSG_LOG:
-        String *params = (String *) message;
+        const char **params = (const char **) message;
         sendLogMessage(params[0], params[1], params[2]);
         break;
     }
@@ -211,9 +211,7 @@ void WifiEsp32::process()
             inBuffer[inPos] = 0;
             inPos = 0;
 
-            if (logger.isDebug()) {
-                logger.debug(this, "incoming: '%s'", inBuffer);
-            }
+            LOG_DEBUG(this, "incoming: '%s'", inBuffer);
             String input = inBuffer;
             if (input.startsWith("cfg:")) {
                 processParameterChange(input.substring(4));
@@ -288,6 +286,8 @@ void WifiEsp32::processIncomingSocketCommand(String input)
             didParamLoad = false;
         } else if (input.equals("getLog")) {
             logger.printHistory(*serialInterface);
+        } else if (input.equals("getSysLog")) {
+            systemLog.print(*serialInterface);
         }
     }
 }
@@ -300,9 +300,7 @@ void WifiEsp32::processIncomingSocketCommand(String input)
  */
 void WifiEsp32::setParam(String paramName, String value)
 {
-    if (logger.isDebug()) {
-        logger.debug(this, "setParam: cfg:%s=%s", paramName.c_str(), value.c_str());
-    }
+    LOG_DEBUG(this, "setParam: cfg:%s=%s", paramName.c_str(), value.c_str());
     sendCmd("cfg:" + paramName + "=" + value);
 }
 
@@ -315,12 +313,12 @@ void WifiEsp32::setParam(String paramName, String value)
  * \return the prepared log message which can be sent to the socket
  *
  */
-void WifiEsp32::sendLogMessage(String logLevel, String deviceName, String message)
+void WifiEsp32::sendLogMessage(const char *logLevel, const char *deviceName, const char *message)
 {
     String data = "json:{\"logMessage\": {\"level\": \"";
     data.concat(logLevel);
     data.concat("\",\"message\": \"");
-    if (deviceName.length() > 0) {
+    if (deviceName[0] != 0) {
         data.concat(deviceName);
         data.concat(": ");
     }
@@ -444,6 +442,10 @@ void WifiEsp32::prepareSystemData() {
     processValue(&valueCache.enableRegen, status.enableRegen, enableRegen);
     processValue(&valueCache.enableHeater, status.enableHeater, enableHeater);
     processValue(&valueCache.enableCreep, status.enableCreep, enableCreep);
+
+    processValue(&valueCache.memoryFree, memoryMonitor.getFree(), memoryFree);
+    processValue(&valueCache.heapUsed, memoryMonitor.getHeapUsed(), heapUsed);
+    processValue(&valueCache.stackUsed, memoryMonitor.getStackUsed(), stackUsed);
 }
 
 void WifiEsp32::prepareBatteryManagerData() {
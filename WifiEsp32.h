@@ -136,14 +136,17 @@ public:
         packResistance = 101,
         packHealth = 102,
         packCycles = 103,
-        bmsTemperature = 104
+        bmsTemperature = 104,
+        memoryFree = 105,
+        heapUsed = 106,
+        stackUsed = 107
     };
 
 private:
     void requestNextParam(); //get next changed parameter
     void requestParamValue(String paramName);  //try to retrieve the value of the given parameter
     void setParam(String paramName, String value);  //set the given parameter with the given string
-    void sendLogMessage(String logLevel, String deviceName, String message);
+    void sendLogMessage(const char *logLevel, const char *deviceName, const char *message);
     void sendCmd(String cmd);
     void sendBufferedCommand();
     void sendSocketUpdate();
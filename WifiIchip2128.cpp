@@ -146,9 +146,7 @@ void WifiIchip2128::sendCmd(String cmd, ICHIP_COMM_STATE cmdstate, Socket *socke
         if (psWritePtr >= CFG_SERIAL_SEND_BUFFER_SIZE) {
             psWritePtr = 0;
         }
-        if (logger.isDebug()) {
-            logger.debug(this, "Buffer cmd: %s", cmd.c_str());
-        }
+        LOG_DEBUG(this, "Buffer cmd: %s", cmd.c_str());
     } else { //otherwise, go ahead and blast away
         serialInterface->print(ichipCommandPrefix);
         serialInterface->print(cmd);
@@ -156,9 +154,7 @@ void WifiIchip2128::sendCmd(String cmd, ICHIP_COMM_STATE cmdstate, Socket *socke
         state = cmdstate;
         lastSendSocket = socket;
         lastSendTime = millis();
-        if (logger.isDebug()) {
-            logger.debug(this, "Send cmd: %s", cmd.c_str());
-        }
+        LOG_DEBUG(this, "Send cmd: %s", cmd.c_str());
     }
 }
 
@@ -325,7 +321,7 @@ void WifiIchip2128::handleMessage(uint32_t messageType, void* message)
         break;
 
     case MSG_LOG:
-        char **params = (char **) message;
+        const char **params = (const char **) message;
         for (int i = 0; i < CFG_WIFI_NUM_SOCKETS; i++) {
             if (socket[i].handle != -1 && socket[i].processor != NULL) {
                 String data = socket[i].processor->generateLogEntry(params[0], params[1], params[2]);
@@ -384,9 +380,7 @@ void WifiIchip2128::process()
             incomingBuffer[ibWritePtr] = 0; //null terminate the string
             ibWritePtr = 0; //reset the write pointer
 
-            if (logger.isDebug()) {
-                logger.debug(this, "incoming: '%s', state: %d", incomingBuffer, state);
-            }
+            LOG_DEBUG(this, "incoming: '%s', state: %d", incomingBuffer, state);
 
             //The ichip echoes our commands back at us. The safer option might be to verify that the command
             //we think we're about to process is really proper by validating the echo here. But, for now
@@ -457,9 +451,7 @@ void WifiIchip2128::processStartSocketListenerRepsonse()
         if (socketListenerHandle < 10 || socketListenerHandle > 11) {
             socketListenerHandle = 0;
         }
-        if (logger.isDebug()) {
-            logger.debug(this, "socket listener handle: %i", socketListenerHandle);
-        }
+        LOG_DEBUG(this, "socket listener handle: %i", socketListenerHandle);
     }
     sendBufferedCommand();
 }
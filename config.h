@@ -35,6 +35,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define CFG_BUILD_NUM	1070        //increment this every time a git commit is done.
 #define CFG_VERSION "GEVCU 2020-04-11"
 #define CFG_DEFAULT_LOGLEVEL Logger::Info
+#define CFG_LOG_MIN_LEVEL 0 // lowest log level which is compiled in (0=debug, 1=info, 2=warn, 3=error), the LOG_* macros of lower levels are removed
 
 //define this to add in latency and efficiency calculations. Comment it out for builds you're going to 
 //use in an actual car. No need to waste cycles for 99% of everyone using the code.
@@ -61,7 +62,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define CFG_TICK_INTERVAL_MOTOR_CONTROLLER_DMOC     40000
 #define CFG_TICK_INTERVAL_MOTOR_CONTROLLER_CODAUQM  10000
 #define CFG_TICK_INTERVAL_MOTOR_CONTROLLER_BRUSA    30000
-#define CFG_TICK_INTERVAL_MEM_CACHE                 40000
+#define CFG_TICK_INTERVAL_MOTOR_CONTROLLER_CANOPEN  10000 // also the CANopen SYNC period
+#define CFG_TICK_INTERVAL_MEM_CACHE                 10000
 #define CFG_TICK_INTERVAL_STATUS                    40000
 #define CFG_TICK_INTERVAL_BMS_THINK                 500000
 #define CFG_TICK_INTERVAL_BMS_ORION                 500000
@@ -70,6 +72,9 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define CFG_TICK_INTERVAL_WIFI                      100000
 #define CFG_TICK_INTERVAL_SYSTEM_IO                 200000
 #define CFG_TICK_INTERVAL_CAN_IO                    200000
+#define CFG_TICK_INTERVAL_SYSTEM_LOG                1000000
+#define CFG_TICK_INTERVAL_MEMORY_MONITOR            1000000
+#define CFG_TICK_INTERVAL_OBD2_LIMITS               100000
 
 /*
  * CAN BUS CONFIGURATION
@@ -80,6 +85,12 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define CFG_CAN1_NUM_TX_MAILBOXES 3 // how many of 8 mailboxes are used for TX for CAN1, rest is used for RX
 #define CFG_CANTHROTTLE_MAX_NUM_LOST_MSG 5 // maximum number of lost messages allowed (max 255)
 #define CFG_MOTORCTRL_MAX_NUM_LOST_MSG 20 // maximum number of ticks the controller may not send messages (max 255)
+#define CFG_CAN_BUS_OFF_RECOVERY_DELAY 5 // ms to wait before re-initializing a CAN controller after bus-off
+#define CFG_CAN_BUS_OFF_RECOVERY_MAX_DELAY 1000 // max ms the recovery delay is increased to when bus-off occurs repeatedly
+#define CFG_CAN_BUS_OFF_STABLE_TIME 2000 // ms the bus has to stay error active after a recovery before the recovery delay is reset
+#define CFG_CANOPEN_SDO_TIMEOUT 100 // ms to wait for the response to a CANopen SDO request
+#define CFG_CANOPEN_HEARTBEAT_TIME 100 // ms heartbeat producer time configured in CANopen nodes
+#define CFG_CANOPEN_HEARTBEAT_TIMEOUT 350 // ms without heartbeat after which a CANopen node is considered lost
 
 /*
  * MISCELLANEOUS
@@ -100,6 +111,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define CFG_THROTTLE_MAX_ERROR 150 //tenths of percentage allowable deviation between pedals
 #define CFG_WEBSOCKET_MAX_TIME 25 // maximum processing time when assembling websocket message (in ms) - prevents interruptions when sending messages to controller
 #define CFG_CHARGED_SHUTDOWN_TIME 600000 // ms after status changed to charged when shutting-down the system
+#define CFG_OBD2_EXTENDED_CACHE_TIME 100 // ms during which the encoded mode 22 OBD2 values are re-used for further requests
 
 /*
  * HARD CODED PARAMETERS
@@ -116,15 +128,47 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 #define CFG_DEV_MGR_MAX_DEVICES 20 // the maximum number of devices supported by the DeviceManager
 #define CFG_CAN_NUM_OBSERVERS 10 // maximum number of device subscriptions per CAN bus
+#define CFG_CANOPEN_SDO_QUEUE_SIZE 32 // maximum number of queued SDO transfers per CANopen node
+#define CFG_CANOPEN_MAX_PDO_MAPPINGS 10 // maximum number of mapped values per direction and CANopen node
 #define CFG_TIMER_NUM_OBSERVERS 9 // the maximum number of supported observers per timer
 #define CFG_TIMER_BUFFER_SIZE 100 // the size of the queuing buffer for TickHandler
 #define CFG_SERIAL_SEND_BUFFER_SIZE 140
+#define CFG_MEMCACHE_WRITE_CHUNK_SIZE 64 // max bytes sent to the EEPROM per write-back step (multiple of 8, max 256)
+#define CFG_MEMCACHE_MIN_CLEAN_PAGES 4 // dirty pages are written ahead of time when fewer clean cache pages are left
+#define CFG_MEMCACHE_WRITE_TIMEOUT 10000 // us after which an unacknowledged EEPROM write cycle is considered failed
+#define CFG_MEMCACHE_DEFERRED_WRITES 4 // writes which wait until the data they depend on is in the EEPROM (e.g. config headers)
+#define CFG_RECORD_STORE_MAX_KEYS 16 // max number of different values in the record store
 #define CFG_FAULT_HISTORY_SIZE	50 //number of faults to store in eeprom. A circular buffer so the last 50 faults are always stored.
+#define CFG_FAULT_INDEX_SIZE 16 //number of hash buckets to look up un-ack'd faults by device and code (power of 2)
+#define CFG_RECORDER_CHANNELS 4 //number of channels the signal recorder samples simultaneously
+#define CFG_RECORDER_SAMPLES 256 //number of samples per channel in the signal recorder's ring buffer (4 * 256 * 2 bytes = 2kB)
+#define CFG_RECORDER_EXPORT_CHUNK 192 //max bytes of a recording sent in one websocket message (multiple of 3 for base64)
+#define CFG_FREEZE_FRAME_SIZE 8 //number of values captured with each fault, must match the number of entries in CFG_FREEZE_FRAME_VALUES
+#define CFG_FREEZE_FRAME_VALUES FF_SYSTEM_STATE, FF_THROTTLE, FF_TORQUE_REQUESTED, FF_SPEED_ACTUAL, FF_DC_VOLTAGE, FF_DC_CURRENT, \
+        FF_TEMPERATURE_MOTOR, FF_TEMPERATURE_CONTROLLER //the values captured with each fault (see FreezeFrameValue in FaultHandler.h)
+#define CFG_OBD2_MAX_RESPONSE_SIZE 64 // max size of an OBD2 response incl. length byte (multi-PID mode 22 responses)
 #define CFG_WEBSOCKET_BUFFER_SIZE 50 // number of characters an incoming socket frame may contain
 #define CFG_WIFI_NUM_SOCKETS 4 // max number of websocket connections
 #define CFG_WIFI_BUFFER_SIZE 1025 // size of buffer for incoming data from wifi
+#define CFG_BOOT_TIMELINE_SIZE 96 // number of start-up events which are recorded (phases, device set-ups, EEPROM page loads)
+#define CFG_SERIAL_TX_BUFFER_SIZE 8192 // bytes of output to SerialUSB which are buffered (large enough for the console menu)
+#define CFG_SERIAL_TX_CHUNK 63 // max bytes sent to SerialUSB per main loop (one USB packet)
 #define LOG_BUFFER_SIZE 120 // size of log output messages
+#define CFG_LOG_HISTORY_ARENA_SIZE 4096 // bytes of the log history (variable length records, multiple of 4)
 #define CFG_LOG_REPEAT_MSG_TIME 10000 // ms while a repeated message is suppressed to be sent to the wifi
+#define CFG_LOG_DEFERRED true // store log messages unformatted and format/output them from the main loop (can be changed with LOGDEFER)
+#define CFG_LOG_DEFERRED_SIZE 32 // number of unformatted log messages which can be queued
+#define CFG_LOG_DEFERRED_MAX_ARGS 6 // max number of argument words of a deferred log message
+#define CFG_LOG_DEFERRED_TEXT_SIZE 512 // bytes for already formatted messages queued behind deferred ones (e.g. with %s)
+#define CFG_LOG_DEFERRED_PER_LOOP 2 // max number of deferred log messages formatted and sent per main loop
+#define CFG_LOG_RATE_SLOTS 16 // number of call sites (format strings) which are rate limited at the same time (power of 2)
+#define CFG_LOG_RATE_WAYS 4 // number of slots a call site can use, the least recently used one is taken over (power of 2, <= CFG_LOG_RATE_SLOTS)
+#define CFG_LOG_RATE_BURST 5 // number of messages a call site may log in a burst
+#define CFG_LOG_RATE_REFILL_TIME 1000 // ms after which a call site may log one more message
+#define CFG_LOG_RATE_SUMMARY_TIME 10000 // ms between the summaries of suppressed messages
+#define CFG_SYSLOG_LEVEL Logger::Warn // lowest level of messages which are stored in the persistent system log (EEPROM)
+#define CFG_SYSLOG_QUEUE_SIZE 8 // number of system log records which can be queued until they are written to the EEPROM
+#define CFG_LOG_FORMAT_CACHE_SIZE 32 // number of analyzed format strings which are cached (power of 2)
 #define CFG_CRUISE_SPEED_BUFFER_SIZE 10 // size of the buffer for actual speed when using cruise buffer
 #define CFG_CRUISE_BUTTON_LONG_PRESS 1000 // ms after which a button press is considered a long press (for plus/minus)
 #define CFG_CRUISE_SIZE_SPEED_SET 8 // max number of speed set entries (cruise speed buttons in dashboard)
@@ -142,6 +186,12 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define CFG_NUMBER_ANALOG_INPUTS  4
 #define CFG_NUMBER_DIGITAL_INPUTS 4
 #define CFG_NUMBER_DIGITAL_OUTPUTS  8
+#define CFG_REMOTE_IO_MAX_NODES 4 // maximum number of CAN I/O extension nodes (max 8)
+#define CFG_REMOTE_IO_DIGITAL_INPUTS_PER_NODE 16 // digital input channels reserved per extension node (max 16)
+#define CFG_REMOTE_IO_ANALOG_INPUTS_PER_NODE 4 // analog input channels reserved per extension node (max 4)
+#define CFG_REMOTE_IO_OUTPUTS_PER_NODE 8 // digital/PWM output channels reserved per extension node (max 8)
+#define CFG_REMOTE_IO_TIMEOUT 1000 // ms after which an extension node which did not send data is considered offline
+#define CFG_REMOTE_IO_DISCOVERY_TICKS 25 // number of CAN I/O ticks between discovery requests (to find late nodes)
 #define CFG_NUMBER_BATTERY_TEMPERATURE_SENSORS 6 // the maximum supported external temperature sensors for battery
 
 #endif /* CONFIG_H_ */
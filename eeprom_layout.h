@@ -57,24 +57,29 @@ Range EE_DEVICES_TABLE to EE_DEVICES_TABLE + (EE_NUM_DEVICES + 1) * 2 - 1
 Range EE_DEVICES_TABLE + (EE_NUM_DEVICES + 1) * 2 to EE_DEVICES_BASE - 1
  0128-1023 : unused
 
-Range EE_DEVICES_BASE to EE_DEVICES_BASE + EE_NUM_DEVICES * EE_DEVICE_SIZE - 1
- 1024-1535 : config device 1 (first byte = checksum)
- 1536-2047 : config device 2 (first byte = checksum)
- 2048-2559 : config device 3 (first byte = checksum)
+Range EE_DEVICES_BASE to EE_DEVICES_BASE + (EE_NUM_DEVICES + 1) * EE_DEVICE_SIZE - 1 (position n at EE_DEVICES_BASE + n * EE_DEVICE_SIZE)
+ 1024-1535 : unused (position 0 is the GEVCU marker in the device table)
+ 1536-2047 : config device 1, copy A (first 4 bytes = header: checksum, schema version, generation)
+ 2048-2559 : config device 2, copy A
+ 2560-3071 : config device 3, copy A
  ...
- 32768-33279 : config device 63 (first byte = checksum)
+ 33280-33791 : config device 63, copy A
+
+Range EE_DEVICES_BASE + EE_LKG_OFFSET to EE_DEVICES_BASE + EE_LKG_OFFSET + (EE_NUM_DEVICES + 1) * EE_DEVICE_SIZE - 1
+ 33792-34303 : unused (position 0)
+ 34304-34815 : config device 1, copy B (the valid copy with the newer generation is used, see PrefHandler)
+ 34816-35327 : config device 2, copy B
+ ...
+ 66048-66559 : config device 63, copy B
 
 Range
- 33280-34815 : unused
+ 66560-67071 : unused
 
-Range EE_LKG_OFFSET to LGK_OFFSET + EE_NUM_DEVICES * EE_DEVICE_SIZE - 1
- 34816-35327 : lkg config device 1 (first byte = checksum)
- 35328-35839 : lkg config device 2 (first byte = checksum)
- ...
- 66560-67071 : lkg config device 63 (first byte = checksum)
+Range EE_RECORD_STORE to EE_RECORD_STORE + EE_RECORD_STORE_SIZE - 1
+ 67072-69631 : record store (ring of 8 byte records for frequently updated values, see RecordStore.h)
 
 Range EE_SYS_LOG to EE_FAULT_LOG - 1
- 69632-102399 : system log
+ 69632-102399 : system log (ring of 32 byte warning/error records, see SystemLog.h)
 
 Range EE_FAULT_LOG to eeprom size - 1 ?
  102400-...
@@ -87,11 +92,16 @@ Range EE_FAULT_LOG to eeprom size - 1 ?
 #define EE_DEVICE_SIZE      512 //# of bytes allocated to each device
 #define EE_DEVICES_BASE     1024 //start of where devices in the table can use
 
-#define EE_MAIN_OFFSET          0 //offset from start of EEPROM where main config is
-#define EE_LKG_OFFSET           34816  //start EEPROM addr where last known good config is
+#define EE_MAIN_OFFSET          0 //offset of copy A of the device configurations
+#define EE_LKG_OFFSET           32768 //offset of copy B of the device configurations
 
-//start EEPROM addr where the system log starts. <SYS LOG YET TO BE DEFINED>
+//start EEPROM addr and size of the wear-levelled record store (Used by RecordStore)
+#define EE_RECORD_STORE         67072
+#define EE_RECORD_STORE_SIZE    2560
+
+//start EEPROM addr and size of the persistent system log (Used by SystemLog)
 #define EE_SYS_LOG              69632
+#define EE_SYS_LOG_SIZE         32768
 
 //start EEPROM addr for fault log (Used by fault_handler)
 #define EE_FAULT_LOG            102400
@@ -102,7 +112,10 @@ the end of the stardard data. The below numbers are offsets from the device's ee
 */
 
 //first, things in common to all devices - leave 20 bytes for this
-#define EE_CHECKSUM                         0 //1 byte - checksum for this section of EEPROM to makesure it is valid
+#define EE_CHECKSUM                         0 //1 byte - checksum (CRC8) for this section of EEPROM to makesure it is valid
+#define EE_SCHEMA_VERSION                   1 //1 byte - highest version of the configuration fields which were saved (see PrefField)
+#define EE_GENERATION                       2 //2 bytes - generation of this copy of the configuration, the newest valid copy is used
+#define EE_CONFIG_HEADER_SIZE               4 //checksum, schema version and generation are written together when committing a copy
 
 // Motor controller data
 #define EEMC_MAX_RPM                        20 //2 bytes, unsigned int for maximum allowable RPM
@@ -131,6 +144,7 @@ the end of the stardard data. The below numbers are offsets from the device's ee
 #define EEMC_CRUISE_LONG_PRESS_DELTA        81 // 2 byte - delta to target speed when pressing +/- button long (kph/rpm)
 #define EEMC_CRUISE_STEP_DELTA              83 // 2 byte - delta to actual speen wehn pressing +/- button a short time
 #define EEMC_CRUISE_USE_RPM                 85 // 1 byte - flag if true, cruise control uses rpm, if false kph to control vehicle speed
+#define EEMC_CANOPEN_NODE_ID                86 // 1 byte - CANopen node id of the inverter
 
 // Throttle data
 #define EETH_LEVEL_MIN                      20 //2 bytes - ADC value of minimum value for first channel
@@ -220,6 +234,9 @@ the end of the stardard data. The below numbers are offsets from the device's ee
 #define EESIO_HEATER_TEMPERATURE_ON         74 // 1 byte - temp in deg C where heater is enabled
 #define EESIO_ABS_INPUT                     75 // 1 byte - digital input for ABS signal (255 = no output)
 
+// CAN I/O
+#define EECANIO_NODE_IDS                    20 // 4 bytes per node (max 8 nodes) - unique id of the extension node assigned to the node number (0 = unused)
+
 // CanOBD2
 #define EEOBD2_CAN_BUS_RESPOND              10 // 1 byte - which can bus should we respond to OBD2 requests (0=ev, 1=car, 255=ignore)
 #define EEOBD2_CAN_ID_OFFSET_RESPOND        11 // 1 byte - offset for can id on wich we listen to incoming requests (0-7)
@@ -227,7 +244,7 @@ the end of the stardard data. The below numbers are offsets from the device's ee
 #define EEOBD2_CAN_ID_OFFSET_POLL           13 // 1 byte - offset for can id on which we will request OBD2 data from (0-7, 255=broadcast)
 
 // Fault Handler
-#define EEFAULT_VALID                       0 //1 byte - Set to value of 0xB2 if fault data has been initialized
+#define EEFAULT_VALID                       0 //1 byte - Set to value of 0xB4 if fault data has been initialized (0xB2/0xB3 = older record formats)
 #define EEFAULT_READPTR                     1 //2 bytes - index where reading should start (first unacknowledged fault)
 #define EEFAULT_WRITEPTR                    3 //2 bytes - index where writing should occur for new faults
 #define EEFAULT_RUNTIME                     5 //4 bytes - stores the number of seconds (in tenths) that the system has been turned on for - total time ever
@@ -0,0 +1,258 @@
+/*
+ * LogSoak.cpp
+ *
+ * Heap soak of the log history: logs a long random mix of messages through the Logger
+ * (deferred, formatted right away, with and without device, wifi output) while the rest of
+ * the firmware is modelled as short lived heap allocations of the wifi/web socket Strings.
+ * The heap statistics are printed as the soak proceeds. With -r the same messages are
+ * stored in a model of the former history (100 entries with two heap Strings each) instead.
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include <malloc.h>
+#include <unistd.h>
+#include "Logger.h"
+#include "Device.h"
+#include "DeviceManager.h"
+#include "SystemLog.h"
+
+#define SOAK_DEVICES        6 // devices which log messages
+#define SOAK_FORMER_HISTORY 100 // entries of the former history (CFG_LOG_HISTORY_SIZE)
+#define SOAK_MAX_TRANSIENT  512 // max size of a String which is built and released (e.g. a web socket frame)
+
+static uint32_t hostTime = 0; // simulated millis()
+
+uint32_t millis()
+{
+    return hostTime;
+}
+
+void hostDelay(uint32_t milliseconds)
+{
+    hostTime += milliseconds;
+}
+
+/*
+ * The serial port, counts the bytes which are sent
+ */
+class HostSerial: public Print
+{
+public:
+    size_t write(uint8_t)
+    {
+        bytes++;
+        return 1;
+    }
+    uint64_t bytes;
+};
+
+static HostSerial hostSerial;
+Print &SerialUSB = hostSerial;
+
+static Device devices[SOAK_DEVICES] = { Device(BRUSA_DMC5, "Brusa DMC5"), Device(ESP32WIFI, "WIFI (ESP32)"),
+        Device(NEW, "Pot Throttle"), Device(NEW, "CAN I/O"), Device(NEW, "Orion BMS"), Device(NEW, "Brusa NLG5") };
+
+DeviceManager deviceManager;
+HostHandler tickHandler, canHandlerEv, canHandlerCar;
+SystemLog systemLog;
+static uint32_t wifiMessages;
+
+/*
+ * The wifi builds a String from the parameters of MSG_LOG and releases it after sending
+ */
+bool DeviceManager::sendMessage(DeviceType, DeviceId, uint32_t msgType, void *message)
+{
+    if (msgType == MSG_LOG) {
+        const char **params = (const char **) message;
+        const char *format = "{\"logMessage\": {\"level\": \"%s\",\"message\": \"%s: %s\"}}";
+        size_t size = strlen(format) + strlen(params[0]) + strlen(params[1]) + strlen(params[2]);
+        char *data = (char *) malloc(size);
+        snprintf(data, size, format, params[0], params[1], params[2]);
+        free(data);
+        wifiMessages++;
+    }
+    return true;
+}
+
+Device *DeviceManager::getDeviceByID(DeviceId id)
+{
+    for (int i = 0; i < SOAK_DEVICES; i++) {
+        if (devices[i].getId() == id) {
+            return &devices[i];
+        }
+    }
+    return NULL;
+}
+
+void DeviceManager::setLogLevel(Logger::LogLevel)
+{
+}
+
+bool DeviceManager::isAnyDeviceAtLogLevel(Logger::LogLevel level)
+{
+    for (int i = 0; i < SOAK_DEVICES; i++) {
+        if (devices[i].getLogLevel() == level) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SystemLog::add(uint16_t, Logger::LogLevel, const char *, uint8_t, va_list)
+{
+    count++;
+}
+
+/*
+ * The former history: the device name and the message were assigned to Strings, which keep
+ * their buffer and re-allocate it when a longer text is assigned.
+ */
+struct FormerString {
+    char *buffer;
+    size_t capacity;
+
+    void assign(const char *text)
+    {
+        size_t length = strlen(text);
+        if (buffer == NULL || capacity < length) {
+            buffer = (char *) realloc(buffer, length + 1);
+            capacity = length;
+        }
+        memcpy(buffer, text, length + 1);
+    }
+};
+
+struct FormerEntry {
+    FormerString device, message;
+};
+
+static FormerEntry formerHistory[SOAK_FORMER_HISTORY];
+static int formerPtr;
+
+static void logFormer(Device *device, const char *format, ...)
+{
+    char message[LOG_BUFFER_SIZE];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+
+    char *name = strdup(device ? device->getCommonName().c_str() : ""); // getCommonName() returned a copy
+    formerHistory[formerPtr].device.assign(name);
+    formerHistory[formerPtr].message.assign(message);
+    formerPtr = (formerPtr + 1) % SOAK_FORMER_HISTORY;
+    free(name);
+
+    const char *params[] = { "INFO", device ? device->getCommonName().c_str() : "", message };
+    deviceManager.sendMessage(DEVICE_WIFI, INVALID, MSG_LOG, params);
+}
+
+/*
+ * Print the heap statistics, free chunks below the top of the heap are holes which a larger
+ * allocation might not fit into
+ */
+static void report(uint32_t messages)
+{
+    struct mallinfo2 info = mallinfo2();
+
+    printf("%10u %10zu %10zu %10zu %10zu %10zu\n", messages, info.arena, info.uordblks, info.fordblks - info.keepcost,
+            info.ordblks - 1, info.keepcost);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t total = 1000000;
+    bool former = false;
+    char text[LOG_BUFFER_SIZE];
+    void *transient[8] = { NULL };
+    int option;
+
+    srand(1);
+    while ((option = getopt(argc, argv, "n:s:r")) != -1) {
+        switch (option) {
+        case 'n':
+            total = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            srand(strtoul(optarg, NULL, 0));
+            break;
+        case 'r':
+            former = true;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n messages] [-s seed] [-r (former history)]\n", argv[0]);
+            return 1;
+        }
+    }
+    for (int i = 0; i < SOAK_DEVICES; i++) {
+        devices[i].setLogLevel(Logger::Debug);
+    }
+
+    printf("%s history, %u messages\n", (former ? "former String" : "arena"), total);
+    printf("%10s %10s %10s %10s %10s %10s\n", "messages", "heap", "in use", "holes", "hole count", "top");
+    report(0);
+    uint32_t messages = 0;
+    for (uint32_t nextReport = total / 10; messages < total; ) {
+        Device *device = &devices[rand() % SOAK_DEVICES];
+        int length = rand() % (LOG_BUFFER_SIZE - 20);
+
+        // a main loop: a few messages, other heap users with different life times, deferred output
+        for (int i = 0; i < length; i++) {
+            text[i] = 'a' + (i + messages) % 26;
+        }
+        text[length] = 0;
+        if (former) {
+            logFormer(device, "%s", text);
+            logFormer(device, "status %d, current %d", rand() % 16, rand() % 400);
+            logFormer(NULL, "loop %u", messages);
+        } else {
+            LOG_INFO(device, "%s", text);
+            LOG_INFO(device, "status %d, current %d", rand() % 16, rand() % 400);
+            logger.warn("loop %u", messages);
+        }
+        messages += 3;
+
+        int slot = rand() % 8;
+        free(transient[slot]);
+        transient[slot] = malloc(16 + rand() % SOAK_MAX_TRANSIENT);
+
+        for (int i = 0; i < 3; i++) {
+            logger.process();
+            serialOutput.process();
+        }
+        hostDelay(CFG_LOG_RATE_REFILL_TIME); // no call site is rate limited
+
+        if (messages >= nextReport) {
+            report(messages);
+            nextReport += total / 10;
+        }
+    }
+    for (int i = 0; i < 8; i++) {
+        free(transient[i]);
+    }
+    report(messages);
+    printf("serial %llu bytes, wifi %u messages, system log %u messages\n", (unsigned long long) hostSerial.bytes, wifiMessages,
+            systemLog.count);
+    return 0;
+}
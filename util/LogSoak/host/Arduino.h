@@ -0,0 +1,89 @@
+/*
+ * Arduino.h
+ *
+ * Minimal replacement of the Arduino core for running the Logger on a PC.
+ * Time is simulated: millis() only advances when the soak calls hostDelay().
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef HOST_ARDUINO_H_
+#define HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+
+uint32_t millis();
+void hostDelay(uint32_t milliseconds); // advance the simulated time
+
+class String
+{
+public:
+    String(const char *text = "") : text(text) {}
+    const char *c_str() const { return text; }
+private:
+    const char *text;
+};
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t *data, size_t size)
+    {
+        size_t n = 0;
+        while (size--) {
+            n += write(*data++);
+        }
+        return n;
+    }
+    size_t print(const char *text)
+    {
+        return write((const uint8_t *) text, strlen(text));
+    }
+    size_t print(uint32_t value)
+    {
+        char buffer[12];
+        snprintf(buffer, sizeof(buffer), "%u", value);
+        return print(buffer);
+    }
+    size_t println(const char *text)
+    {
+        return print(text) + print("\r\n");
+    }
+};
+
+extern Print &SerialUSB;
+
+#endif /* HOST_ARDUINO_H_ */
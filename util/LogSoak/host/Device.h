@@ -0,0 +1,51 @@
+/*
+ * Device.h
+ *
+ * Stand-in for the Device class, the Logger only needs the id, name and log level.
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef HOST_DEVICE_H_
+#define HOST_DEVICE_H_
+
+#include <Arduino.h>
+#include "config.h"
+#include "DeviceTypes.h"
+#include "Logger.h"
+
+class Device
+{
+public:
+    Device(DeviceId id, const char *name) : id(id), commonName(name), logLevel(Logger::Info) {}
+    DeviceId getId() { return id; }
+    const String &getCommonName() { return commonName; }
+    Logger::LogLevel getLogLevel() { return logLevel; }
+    void setLogLevel(Logger::LogLevel level) { logLevel = level; }
+private:
+    DeviceId id;
+    String commonName;
+    Logger::LogLevel logLevel;
+};
+
+#endif /* HOST_DEVICE_H_ */
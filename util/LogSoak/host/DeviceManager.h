@@ -0,0 +1,56 @@
+/*
+ * DeviceManager.h
+ *
+ * Stand-in for the DeviceManager and the handlers the Logger hands off to while
+ * printing the history.
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef HOST_DEVICE_MANAGER_H_
+#define HOST_DEVICE_MANAGER_H_
+
+#include "config.h"
+#include "Device.h"
+#include "Sys_Messages.h"
+#include "DeviceTypes.h"
+
+class DeviceManager
+{
+public:
+    bool sendMessage(DeviceType deviceType, DeviceId deviceId, uint32_t msgType, void *message);
+    Device *getDeviceByID(DeviceId);
+    void setLogLevel(Logger::LogLevel);
+    bool isAnyDeviceAtLogLevel(Logger::LogLevel);
+};
+
+class HostHandler
+{
+public:
+    void process() {}
+};
+
+extern DeviceManager deviceManager;
+extern HostHandler tickHandler, canHandlerEv, canHandlerCar;
+
+#endif /* HOST_DEVICE_MANAGER_H_ */
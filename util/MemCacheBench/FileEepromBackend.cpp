@@ -0,0 +1,161 @@
+/*
+ * FileEepromBackend.cpp
+ *
+ * EEPROM backend for host builds which keeps the EEPROM image in a memory mapped file
+ * and simulates the timing of the I2C EEPROM.
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "FileEepromBackend.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+FileEepromBackend::FileEepromBackend(const char *fileName, uint32_t size)
+{
+    this->fileName = fileName;
+    this->size = size;
+    image = NULL;
+    byteTime = 23;
+    writeCycleTime = 5000;
+    writeDone = 0;
+    busBytes = 0;
+    writeCount = 0;
+}
+
+FileEepromBackend::~FileEepromBackend()
+{
+    if (image != NULL) {
+        msync(image, size, MS_SYNC);
+        munmap(image, size);
+    }
+}
+
+/*
+ * Change the simulated timing (both in microseconds)
+ */
+void FileEepromBackend::setLatency(uint32_t byteTime, uint32_t writeCycleTime)
+{
+    this->byteTime = byteTime;
+    this->writeCycleTime = writeCycleTime;
+}
+
+/*
+ * Map the image file, a new file is filled with 0xFF like an erased EEPROM.
+ * The image stays mapped if it's called again (MemCache::setup() after a simulated reset).
+ */
+void FileEepromBackend::setup()
+{
+    struct stat info;
+
+    if (image != NULL) {
+        return;
+    }
+    int fd = open(fileName, O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        perror(fileName);
+        exit(1);
+    }
+    bool erase = ((uint32_t) info.st_size != size);
+    if (erase && ftruncate(fd, size) != 0) {
+        perror(fileName);
+        exit(1);
+    }
+    image = (uint8_t *) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        perror(fileName);
+        exit(1);
+    }
+    if (erase) {
+        memset(image, 0xFF, size);
+    }
+}
+
+/*
+ * Read a page: control byte + 2 address bytes, repeated start with control byte, 256 data bytes
+ */
+bool FileEepromBackend::readPage(uint32_t address, uint8_t *data)
+{
+    if (address + 256 > size) {
+        return false;
+    }
+    if ((int32_t) (micros() - writeDone) < 0) {
+        transfer(1);
+        return false; // the chip doesn't acknowledge while it is writing
+    }
+    transfer(4 + 256);
+    memcpy(data, image + address, 256);
+    return true;
+}
+
+/*
+ * Write data: control byte + 2 address bytes + data, the write cycle starts with the stop condition
+ */
+void FileEepromBackend::write(uint32_t address, uint8_t *data, uint16_t length)
+{
+    if (length > CFG_MEMCACHE_WRITE_CHUNK_SIZE) {
+        length = CFG_MEMCACHE_WRITE_CHUNK_SIZE;
+    }
+    if (address + length > size) {
+        return;
+    }
+    transfer(3 + length);
+    memcpy(image + address, data, length);
+    writeDone = micros() + writeCycleTime;
+    writeCount++;
+}
+
+/*
+ * Ack polling: the control byte is sent, the chip acknowledges once the write cycle is done
+ */
+bool FileEepromBackend::isWriteComplete()
+{
+    transfer(1);
+    return (int32_t) (micros() - writeDone) >= 0;
+}
+
+/*
+ * Number of bytes transferred on the I2C bus
+ */
+uint32_t FileEepromBackend::getBusBytes()
+{
+    return busBytes;
+}
+
+/*
+ * Number of write cycles of the EEPROM
+ */
+uint32_t FileEepromBackend::getWriteCount()
+{
+    return writeCount;
+}
+
+void FileEepromBackend::transfer(uint32_t bytes)
+{
+    busBytes += bytes;
+    hostDelay(bytes * byteTime);
+}
@@ -0,0 +1,66 @@
+/*
+ * FileEepromBackend.h
+ *
+ * EEPROM backend for host builds which keeps the EEPROM image in a memory mapped file
+ * and simulates the timing of the I2C EEPROM.
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef FILE_EEPROM_BACKEND_H_
+#define FILE_EEPROM_BACKEND_H_
+
+#include "EepromBackend.h"
+
+/*
+ * The image file is created (erased to 0xFF) if it doesn't exist. Every I2C transfer advances
+ * the simulated time by byteTime per byte (a byte plus ack is 9 clocks, 23us at 400kHz), a write
+ * is acknowledged writeCycleTime after it was sent (the 24LC256 specifies max 5ms).
+ */
+class FileEepromBackend: public EepromBackend
+{
+public:
+    FileEepromBackend(const char *fileName, uint32_t size);
+    ~FileEepromBackend();
+    void setLatency(uint32_t byteTime, uint32_t writeCycleTime);
+    void setup();
+    bool readPage(uint32_t address, uint8_t *data);
+    void write(uint32_t address, uint8_t *data, uint16_t length);
+    bool isWriteComplete();
+    uint32_t getBusBytes();
+    uint32_t getWriteCount();
+
+private:
+    const char *fileName; // path of the image file
+    uint32_t size; // size of the image in bytes
+    uint8_t *image; // the mapped image file
+    uint32_t byteTime; // simulated duration of one byte on the I2C bus in us
+    uint32_t writeCycleTime; // simulated duration of the internal write cycle in us
+    uint32_t writeDone; // micros() when the last write cycle completes
+    uint32_t busBytes; // number of bytes transferred on the I2C bus (incl. addressing and ack polling)
+    uint32_t writeCount; // number of write cycles
+
+    void transfer(uint32_t bytes);
+};
+
+#endif /* FILE_EEPROM_BACKEND_H_ */
@@ -0,0 +1,378 @@
+/*
+ * MemCacheBench.cpp
+ *
+ * Replays the EEPROM access patterns of the firmware (boot, saving a configuration and a
+ * fault storm) against the MemCache on a PC and reports hit rate, I2C traffic and stall time.
+ * The lookup scenario measures the host CPU time the page lookup costs when the devices load
+ * their configuration from a warm cache (build MemCacheBenchLinear for the former linear scan).
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include <unistd.h>
+#include <time.h>
+#include "MemCache.h"
+#include "eeprom_layout.h"
+#include "FileEepromBackend.h"
+
+#define BENCH_DEVICES       12 // number of enabled devices in the replayed configuration
+#define BENCH_STORM_FAULTS  500 // faults raised during the fault storm, one per tick
+#define FAULT_SIZE          (16 + 2 * CFG_FREEZE_FRAME_SIZE) // sizeof(FAULT) on the Due
+#define SYSLOG_RECORD_SIZE  32 // sizeof(SYSLOG_RECORD)
+#define RECORD_SIZE         8 // sizeof(RECORD) of the RecordStore
+#define LOOKUP_DEVICES      6 // devices replayed in the lookup scenario, their 3 pages each fit the cache
+#define LOOKUP_REPLAYS      20000 // configuration loads of all LOOKUP_DEVICES timed in the lookup scenario
+#define LOOKUP_FIELDS       30 // configuration fields a device reads one by one
+
+struct Snapshot {
+    uint32_t hits, misses, busBytes, writes, stall, time;
+};
+
+static FileEepromBackend *eeprom;
+
+static Snapshot snapshot()
+{
+    Snapshot s = { memCache.getHitCount(), memCache.getMissCount(), eeprom->getBusBytes(), eeprom->getWriteCount(),
+            memCache.getStallTime(), micros() };
+    return s;
+}
+
+/*
+ * Let the main loop run: the cache gets a tick every CFG_TICK_INTERVAL_MEM_CACHE
+ */
+static void tick(uint32_t count)
+{
+    while (count--) {
+        hostDelay(CFG_TICK_INTERVAL_MEM_CACHE);
+        memCache.handleTick();
+    }
+}
+
+/*
+ * Tick until all queued and aged pages and the deferred writes are written
+ */
+static void drain()
+{
+    for (int i = 0; i < MAX_AGE * AGING_PERIOD + 100
+            && (memCache.getWriteQueueDepth() > 0 || memCache.getDeferredWriteCount() > 0); i++) {
+        tick(1);
+    }
+}
+
+static void report(const char *name, Snapshot &before)
+{
+    Snapshot after = snapshot();
+    uint32_t accesses = (after.hits - before.hits) + (after.misses - before.misses);
+
+    printf("%-14s %8u %6u %6u %7.1f%% %10u %7u %10u %10u\n", name, accesses, after.hits - before.hits,
+            after.misses - before.misses, (accesses == 0 ? 0.0 : 100.0 * (after.hits - before.hits) / accesses),
+            after.busBytes - before.busBytes, after.writes - before.writes, after.stall - before.stall,
+            (after.time - before.time) / 1000);
+}
+
+static uint32_t deviceAddress(int position, uint32_t copy)
+{
+    return EE_DEVICES_BASE + EE_DEVICE_SIZE * position + copy;
+}
+
+/*
+ * Write a device table with BENCH_DEVICES enabled devices and two copies of their configuration
+ * (copy B is the newer one), like the EEPROM of a configured car.
+ */
+static void format()
+{
+    uint8_t config[EE_DEVICE_SIZE];
+
+    memCache.Write(EE_DEVICE_TABLE, (uint16_t) EE_GEVCU_MARKER);
+    for (int pos = 1; pos <= EE_NUM_DEVICES; pos++) {
+        memCache.Write(EE_DEVICE_TABLE + 2 * pos, (uint16_t) (pos <= BENCH_DEVICES ? 0x8000 | (0x1000 + pos) : 0));
+        if (pos > BENCH_DEVICES) {
+            continue;
+        }
+        for (int copy = 0; copy < 2; copy++) {
+            for (int i = 0; i < EE_DEVICE_SIZE; i++) {
+                config[i] = pos + i;
+            }
+            config[EE_GENERATION] = copy + 1;
+            config[EE_GENERATION + 1] = 0;
+            memCache.Write(deviceAddress(pos, copy ? EE_LKG_OFFSET : EE_MAIN_OFFSET), config, EE_DEVICE_SIZE);
+            memCache.FlushAllPages();
+        }
+    }
+    memCache.Write(EE_FAULT_LOG + EEFAULT_VALID, (uint8_t) 0xB4);
+    memCache.Write(EE_FAULT_LOG + EEFAULT_READPTR, (uint16_t) 0);
+    memCache.Write(EE_FAULT_LOG + EEFAULT_WRITEPTR, (uint16_t) 0);
+    memCache.FlushAllPages();
+}
+
+/*
+ * Read a configuration like PrefHandler::checksumValid() and load(): the generation of both
+ * copies, the CRC over the whole newer copy and the range of the configuration fields.
+ */
+static void loadConfiguration(int position)
+{
+    uint8_t buffer[64];
+    uint16_t generationMain, generationLkg;
+
+    memCache.Read(deviceAddress(position, EE_MAIN_OFFSET) + EE_GENERATION, &generationMain);
+    memCache.Read(deviceAddress(position, EE_LKG_OFFSET) + EE_GENERATION, &generationLkg);
+    uint32_t newer = ((int16_t) (generationLkg - generationMain) > 0 ? EE_LKG_OFFSET : EE_MAIN_OFFSET);
+
+    for (int offset = 0; offset < EE_DEVICE_SIZE; offset += sizeof(buffer)) {
+        memCache.Read(deviceAddress(position, newer) + offset, buffer, sizeof(buffer));
+    }
+    memCache.Read(deviceAddress(position, newer) + 20, buffer, 60);
+}
+
+/*
+ * Read the configuration fields of a device one by one like the typed PrefHandler::read()
+ * calls of the devices which don't read a range.
+ */
+static void loadFields(int position)
+{
+    uint32_t address = deviceAddress(position, EE_MAIN_OFFSET) + 20;
+    uint32_t value32;
+    uint16_t value16;
+    uint8_t value8;
+
+    for (int field = 0; field < LOOKUP_FIELDS; field++) {
+        switch (field % 3) {
+        case 0:
+            memCache.Read(address, &value8);
+            address += 1;
+            break;
+        case 1:
+            memCache.Read(address, &value16);
+            address += 2;
+            break;
+        default:
+            memCache.Read(address, &value32);
+            address += 4;
+            break;
+        }
+    }
+}
+
+/*
+ * Host CPU time of the configuration loads, in ns per load of all LOOKUP_DEVICES. The pages
+ * are cached before the clock starts so this measures the lookups and copying, not the EEPROM.
+ */
+static double lookupTime()
+{
+    struct timespec start, end;
+
+    for (int pos = 1; pos <= LOOKUP_DEVICES; pos++) {
+        loadConfiguration(pos);
+        loadFields(pos);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int replay = 0; replay < LOOKUP_REPLAYS; replay++) {
+        for (int pos = 1; pos <= LOOKUP_DEVICES; pos++) {
+            loadConfiguration(pos);
+            loadFields(pos);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / LOOKUP_REPLAYS;
+}
+
+/*
+ * setup() of GEVCU.ino: record store and system log scan, prefetchConfiguration(), fault
+ * handler and the devices loading their configuration.
+ */
+static void boot()
+{
+    uint8_t buffer[FAULT_SIZE];
+    uint16_t id;
+
+    memCache.setup(); // cold cache, like after a reset
+
+    for (int slot = 0; slot < EE_RECORD_STORE_SIZE / RECORD_SIZE; slot++) {
+        memCache.Read(EE_RECORD_STORE + slot * RECORD_SIZE, buffer, RECORD_SIZE);
+    }
+    for (uint32_t low = 0, high = EE_SYS_LOG_SIZE / SYSLOG_RECORD_SIZE; low < high; ) { // binary search for the head
+        uint32_t middle = (low + high) / 2;
+        memCache.Read(EE_SYS_LOG + middle * SYSLOG_RECORD_SIZE, buffer, SYSLOG_RECORD_SIZE);
+        high = middle;
+    }
+
+    // prefetchConfiguration()
+    memCache.Prefetch(EE_DEVICE_TABLE, (EE_NUM_DEVICES + 1) * 2);
+    memCache.Prefetch(EE_FAULT_LOG, EEFAULT_FAULTS_START + FAULT_SIZE * CFG_FAULT_HISTORY_SIZE);
+    for (int pos = 1; pos <= EE_NUM_DEVICES; pos++) {
+        memCache.Read(EE_DEVICE_TABLE + (2 * pos), &id);
+        if (id & 0x8000) { // PrefHandler::prefetch()
+            uint16_t generationMain, generationLkg;
+            if (memCache.Prefetch(deviceAddress(pos, EE_MAIN_OFFSET), EE_CONFIG_HEADER_SIZE)
+                    + memCache.Prefetch(deviceAddress(pos, EE_LKG_OFFSET), EE_CONFIG_HEADER_SIZE) < 2) {
+                continue;
+            }
+            memCache.Read(deviceAddress(pos, EE_MAIN_OFFSET) + EE_GENERATION, &generationMain);
+            memCache.Read(deviceAddress(pos, EE_LKG_OFFSET) + EE_GENERATION, &generationLkg);
+            memCache.Prefetch(deviceAddress(pos, (int16_t) (generationLkg - generationMain) > 0 ? EE_LKG_OFFSET : EE_MAIN_OFFSET),
+                    EE_DEVICE_SIZE);
+        }
+    }
+
+    // faultHandler.setup()
+    memCache.Read(EE_FAULT_LOG + EEFAULT_READPTR, &id);
+    memCache.Read(EE_FAULT_LOG + EEFAULT_WRITEPTR, &id);
+    for (int i = 0; i < CFG_FAULT_HISTORY_SIZE; i++) {
+        memCache.Read(EE_FAULT_LOG + EEFAULT_FAULTS_START + FAULT_SIZE * i, buffer, FAULT_SIZE);
+    }
+
+    // the devices look up their position in the device table and load their configuration
+    for (int device = 1; device <= BENCH_DEVICES; device++) {
+        for (int pos = 1; pos <= EE_NUM_DEVICES; pos++) {
+            memCache.Read(EE_DEVICE_TABLE + (2 * pos), &id);
+            if ((id & 0x7FFF) == 0x1000 + device) {
+                loadConfiguration(pos);
+                break;
+            }
+        }
+    }
+}
+
+/*
+ * PrefHandler::beginEdit(), a few modified fields and saveChecksum() of one device
+ */
+static void saveConfiguration(int position)
+{
+    uint8_t buffer[64];
+    uint16_t generationMain, generationLkg;
+
+    memCache.Read(deviceAddress(position, EE_MAIN_OFFSET) + EE_GENERATION, &generationMain);
+    memCache.Read(deviceAddress(position, EE_LKG_OFFSET) + EE_GENERATION, &generationLkg);
+    bool lkgActive = ((int16_t) (generationLkg - generationMain) > 0);
+    uint32_t active = deviceAddress(position, lkgActive ? EE_LKG_OFFSET : EE_MAIN_OFFSET);
+    uint32_t inactive = deviceAddress(position, lkgActive ? EE_MAIN_OFFSET : EE_LKG_OFFSET);
+
+    for (int offset = 0; offset < EE_DEVICE_SIZE; offset += sizeof(buffer)) {
+        memCache.Read(active + offset, buffer, sizeof(buffer));
+        memCache.Write(inactive + offset, buffer, sizeof(buffer));
+    }
+    memCache.Write(inactive + 20, buffer, 40);
+    for (int offset = EE_CONFIG_HEADER_SIZE; offset < EE_DEVICE_SIZE; offset += sizeof(buffer)) { // CRC
+        memCache.Read(inactive + offset, buffer, min((int) sizeof(buffer), EE_DEVICE_SIZE - offset));
+    }
+    for (int offset = 0; offset < EE_DEVICE_SIZE; offset += 256) {
+        memCache.FlushAddress(inactive + offset);
+    }
+    uint16_t generation = max(generationMain, generationLkg) + 1;
+    uint8_t header[EE_CONFIG_HEADER_SIZE] = { 0, 0, (uint8_t) generation, (uint8_t) (generation >> 8) };
+    memCache.WriteDeferred(inactive + EE_CHECKSUM, header, EE_CONFIG_HEADER_SIZE, inactive, EE_DEVICE_SIZE); // after the data
+}
+
+/*
+ * A fault every tick: FaultHandler::writeDirtyFaults() and SystemLog::handleTick() write
+ * and flush their records, the RecordStore updates a counter now and then.
+ */
+static void faultStorm()
+{
+    uint8_t record[SYSLOG_RECORD_SIZE];
+    uint16_t writePointer = 0, recordHead = 0;
+    uint32_t sysLogHead = 0;
+
+    memset(record, 0x5A, sizeof(record));
+    for (int i = 0; i < BENCH_STORM_FAULTS; i++) {
+        uint32_t address = EE_FAULT_LOG + EEFAULT_FAULTS_START + FAULT_SIZE * writePointer;
+        memCache.Write(address, record, FAULT_SIZE);
+        memCache.FlushAddress(address);
+        writePointer = (writePointer + 1) % CFG_FAULT_HISTORY_SIZE;
+        memCache.Write(EE_FAULT_LOG + EEFAULT_WRITEPTR, writePointer);
+        memCache.FlushAddress(EE_FAULT_LOG + EEFAULT_WRITEPTR);
+
+        address = EE_SYS_LOG + sysLogHead * SYSLOG_RECORD_SIZE;
+        memCache.Write(address, record, SYSLOG_RECORD_SIZE);
+        memCache.FlushAddress(address);
+        sysLogHead = (sysLogHead + 1) % (EE_SYS_LOG_SIZE / SYSLOG_RECORD_SIZE);
+
+        if (i % 100 == 0) {
+            memCache.Write(EE_RECORD_STORE + recordHead * RECORD_SIZE, record, RECORD_SIZE);
+            recordHead = (recordHead + 1) % (EE_RECORD_STORE_SIZE / RECORD_SIZE);
+        }
+        tick(1);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *fileName = "eeprom.img";
+    uint32_t byteTime = 23, writeCycleTime = 5000;
+    int option;
+
+    while ((option = getopt(argc, argv, "f:b:w:")) != -1) {
+        switch (option) {
+        case 'f':
+            fileName = optarg;
+            break;
+        case 'b':
+            byteTime = atol(optarg);
+            break;
+        case 'w':
+            writeCycleTime = atol(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-f image file] [-b us per I2C byte] [-w us per write cycle]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    FileEepromBackend backend(fileName, NUM_EEPROM_PAGES * 256);
+    eeprom = &backend;
+    eeprom->setLatency(byteTime, writeCycleTime);
+    memCache.setBackend(eeprom);
+    memCache.setup();
+    format();
+
+    printf("%d cached pages, %dus per I2C byte, %dus per write cycle\n\n", NUM_CACHED_PAGES, byteTime, writeCycleTime);
+    printf("%-14s %8s %6s %6s %8s %10s %7s %10s %10s\n", "scenario", "accesses", "hits", "misses", "hit rate", "I2C bytes",
+            "writes", "stall(us)", "time(ms)");
+
+    Snapshot before = snapshot();
+    boot();
+    report("boot", before);
+
+    before = snapshot();
+    saveConfiguration(3);
+    drain();
+    report("config save", before);
+
+    before = snapshot();
+    faultStorm();
+    drain();
+    report("fault storm", before);
+
+    before = snapshot();
+    double nanos = lookupTime();
+    report("lookup", before);
+#ifdef MEM_CACHE_LINEAR_SCAN
+    printf("\n%.0fns per configuration load of %d devices (linear scan)\n", nanos, LOOKUP_DEVICES);
+#else
+    printf("\n%.0fns per configuration load of %d devices (page index)\n", nanos, LOOKUP_DEVICES);
+#endif
+
+    printf("\n");
+    memCache.printStatistics();
+    return 0;
+}
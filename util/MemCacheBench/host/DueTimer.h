@@ -0,0 +1 @@
+// empty on the host, the timers are not used by the MemCache
@@ -0,0 +1,132 @@
+/*
+ * HostStubs.cpp
+ *
+ * Stand-ins for the parts of the firmware the MemCache uses (logger, tick handler, boot
+ * timeline, I2C backend) and the simulated clock.
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "Logger.h"
+#include "TickHandler.h"
+#include "BootTimeline.h"
+#include "EepromBackend.h"
+
+static uint32_t hostTime = 0; // simulated micros()
+
+uint32_t micros()
+{
+    return hostTime;
+}
+
+uint32_t millis()
+{
+    return hostTime / 1000;
+}
+
+void hostDelay(uint32_t microseconds)
+{
+    hostTime += microseconds;
+}
+
+Logger logger;
+
+Logger::Logger()
+{
+}
+
+void Logger::debug(const char *, ...)
+{
+}
+
+void Logger::error(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    fputs("ERROR: ", stderr);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+void Logger::console(String format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vprintf(format.c_str(), args);
+    putchar('\n');
+    va_end(args);
+}
+
+TickHandler tickHandler;
+
+TickHandler::TickHandler()
+{
+}
+
+void TickHandler::attach(TickObserver *, uint32_t)
+{
+}
+
+void TickHandler::detach(TickObserver *)
+{
+}
+
+void TickObserver::handleTick()
+{
+}
+
+BootTimeline bootTimeline;
+
+BootTimeline::BootTimeline()
+{
+}
+
+void BootTimeline::add(EventType, uint16_t, uint32_t)
+{
+}
+
+I2cEepromBackend i2cEepromBackend;
+
+I2cEepromBackend::I2cEepromBackend()
+{
+    writeI2cId = 0;
+}
+
+void I2cEepromBackend::setup()
+{
+}
+
+bool I2cEepromBackend::readPage(uint32_t, uint8_t *)
+{
+    return false;
+}
+
+void I2cEepromBackend::write(uint32_t, uint8_t *, uint16_t)
+{
+}
+
+bool I2cEepromBackend::isWriteComplete()
+{
+    return true;
+}
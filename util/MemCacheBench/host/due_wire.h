@@ -0,0 +1 @@
+// empty on the host, the I2C EEPROM is replaced by the FileEepromBackend